@@ -0,0 +1,223 @@
+#ifndef BATCH_SOLVER_H
+#define BATCH_SOLVER_H
+
+#include<atomic>
+#include<condition_variable>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include "max_flow.h"
+#include "graph_builder.h"
+#include "solver_workspace.h"
+
+/*
+ * Workspace handed to the engines for a graph type. Graphs with a compile
+ * time node count keep every buffer on the stack and get none.
+ */
+template<int N>
+struct batchWorkspace{
+    static solverWorkspace<N>* get(solverWorkspace<>* workspace){(void)workspace; return NULL;}
+};
+
+template<>
+struct batchWorkspace<DYNAMIC_NODE_COUNT>{
+    static solverWorkspace<>* get(solverWorkspace<>* workspace){return workspace;}
+};
+
+/*
+ * @brief    Solves many independent max flow instances on a fixed pool of
+ *          worker threads.
+ *
+ *          The threads are started once by the constructor and sleep between
+ *          batches; the thread calling solve() works on the batch too. Each
+ *          thread claims the next unsolved instance from a shared counter
+ *          and runs a serial engine on it with its own solver workspace, so
+ *          once the workspaces have grown to the largest instance the solves
+ *          do not allocate at all. Starting and finishing a batch only takes a
+ *          mutex and two condition variables.
+ *
+ *          solveGenerated() builds the instances on the threads as well,
+ *          each thread into its own graph builder and graph, which are reused
+ *          from instance to instance just like the workspaces.
+ *
+ *          The instances must be distinct objects, every one is solved by a
+ *          single thread. solve() must not be called from several threads
+ *          at the same time.
+ */
+class maxFlowBatchSolver{
+public:
+    /*
+     * @param[in] thread_count  Threads solving a batch, including the caller of
+     *                          solve(). 0 means one per hardware thread.
+     */
+    maxFlowBatchSolver(int thread_count = 0) : stop_(false), generation_(0), running_(0){
+        thread_count_ = thread_count > 0 ? thread_count : (int)std::thread::hardware_concurrency();
+        if(thread_count_ < 1){
+            thread_count_ = 1;
+        }
+        threads_.reset(new batchThread[thread_count_]);
+        for(int i = 1; i < thread_count_; i++){
+            workers_.push_back(std::thread(&maxFlowBatchSolver::worker, this, i));
+        }
+    }
+
+    ~maxFlowBatchSolver(){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for(size_t i = 0; i < workers_.size(); i++){
+            workers_[i].join();
+        }
+    }
+
+    /*
+     * @brief   Compute the maximum flow of every graph of a batch. Each graph
+     *          is left holding its flow, as after solveMaxFlow().
+     *
+     * @param [in]  graphs          First graph of the batch
+     * @param [in]  graph_count     Number of graphs in the batch
+     * @param [out] max_flows       Receives the maximum flow of graphs[i] at index i, best
+     *                              in the flowType of the graph so it can not overflow
+     * @param [in]  engine          One of the MAX_FLOW_* engine ids. Every instance runs
+     *                              on one thread, MAX_FLOW_PARALLEL_PUSH_RELABEL too, and
+     *                              that engine allocates its buffers on every solve. The
+     *                              default value is MAX_FLOW_DINIC.
+     */
+    template<class Graph, class Flow>
+    void solve(Graph* graphs, int graph_count, Flow* max_flows, int engine = MAX_FLOW_DINIC){
+        batchContext<Graph, Flow> context = {graphs, max_flows, engine};
+        runBatch(&solveInstance<Graph, Flow>, &context, graph_count);
+    }
+
+    /*
+     * @brief   Build and solve a batch of instances. build(index, builder)
+     *          must reset() the builder for instance index and add its edges.
+     *          It is called from every thread at once, for different instances.
+     *
+     * @param [in]  instance_count  Number of instances in the batch
+     * @param [in]  build           Builds instance index into the builder
+     * @param [out] max_flows       Receives the maximum flow of instance i at index i, as for solve()
+     * @param [in]  engine          One of the MAX_FLOW_* engine ids, as for solve().
+     *                              The default value is MAX_FLOW_DINIC.
+     */
+    template<class Build, class Flow>
+    void solveGenerated(int instance_count, Build build, Flow* max_flows, int engine = MAX_FLOW_DINIC){
+        generatedContext<Build, Flow> context = {&build, max_flows, engine};
+        runBatch(&solveGeneratedInstance<Build, Flow>, &context, instance_count);
+    }
+
+    int getThreadCount(){return thread_count_;}
+private:
+    /* What each thread keeps from one instance to the next */
+    struct batchThread{
+        batchThread() : graph(0, 0, 0){}
+
+        solverWorkspace<> workspace;
+        residualGraphBuilder<> builder;
+        residualGraph<> graph;
+    };
+
+    typedef void (*batchJob)(void* context, int index, batchThread* thread);
+
+    template<class Graph, class Flow>
+    struct batchContext{
+        Graph* graphs;
+        Flow* max_flows;
+        int engine;
+    };
+
+    template<class Graph, class Flow>
+    static void solveInstance(void* context, int index, batchThread* thread){
+        batchContext<Graph, Flow>* batch = static_cast<batchContext<Graph, Flow>*>(context);
+        batch->max_flows[index] = solveMaxFlow(batch->graphs[index], batch->engine, 1,
+            batchWorkspace<Graph::STATIC_NODE_COUNT>::get(&thread->workspace));
+    }
+
+    template<class Build, class Flow>
+    struct generatedContext{
+        Build* build;
+        Flow* max_flows;
+        int engine;
+    };
+
+    template<class Build, class Flow>
+    static void solveGeneratedInstance(void* context, int index, batchThread* thread){
+        generatedContext<Build, Flow>* batch = static_cast<generatedContext<Build, Flow>*>(context);
+        (*batch->build)(index, thread->builder);
+        thread->builder.finalize(thread->graph);
+        batch->max_flows[index] = solveMaxFlow(thread->graph, batch->engine, 1, &thread->workspace);
+    }
+
+    /* Run job on every index below job_size, on the pool and on the calling thread */
+    void runBatch(batchJob job, void* context, int job_size){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = job;
+            context_ = context;
+            job_size_ = job_size;
+            next_job_.store(0, std::memory_order_relaxed);
+            running_ = thread_count_ - 1;
+            generation_++;
+        }
+        start_.notify_all();
+        runJobs(&threads_[0]);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        while(running_ > 0){
+            finish_.wait(lock);
+        }
+    }
+
+    void runJobs(batchThread* thread){
+        while(true){
+            int index = next_job_.fetch_add(1, std::memory_order_relaxed);
+            if(index >= job_size_){
+                return;
+            }
+            job_(context_, index, thread);
+        }
+    }
+
+    void worker(int thread_id){
+        unsigned generation = 0;
+        while(true){
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                while(!stop_ && generation_ == generation){
+                    start_.wait(lock);
+                }
+                if(stop_){
+                    return;
+                }
+                generation = generation_;
+            }
+            runJobs(&threads_[thread_id]);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(--running_ == 0){
+                finish_.notify_one();
+            }
+        }
+    }
+
+    int thread_count_;
+    std::vector<std::thread> workers_; /* Pool threads, the caller of solve() is thread 0 */
+    std::unique_ptr<batchThread[]> threads_; /* State of each thread, only used by that thread */
+
+    std::mutex mutex_; /* Guards the batch description and the counters below */
+    std::condition_variable start_; /* Signalled when a batch starts or the pool stops */
+    std::condition_variable finish_; /* Signalled when the last pool thread is done with a batch */
+    bool stop_;
+    unsigned generation_; /* Bumped for every batch */
+    int running_; /* Pool threads still working on the current batch */
+
+    batchJob job_; /* Solves one instance of the current batch */
+    void* context_; /* Batch description passed to job_ */
+    int job_size_; /* Instances in the current batch */
+    std::atomic<int> next_job_; /* First instance no thread has claimed yet */
+};
+
+#endif
@@ -0,0 +1,567 @@
+#ifndef BOYKOV_KOLMOGOROV_H
+#define BOYKOV_KOLMOGOROV_H
+
+#include<vector>
+#include<climits>
+
+#include "residual_graph.h"
+#include "grid_graph.h"
+#include "solver_counters.h"
+
+/* Special parent edge values, real parent edges are >= 0 */
+#define BK_NO_PARENT INVALID_PARENT /* Node is in neither tree */
+#define BK_TERMINAL_PARENT -2 /* Parent is the source or the target itself */
+#define BK_ORPHAN_PARENT -3 /* Parent edge was saturated, waiting for adoption */
+
+#define BK_FREE 0
+#define BK_SOURCE_TREE 1
+#define BK_SINK_TREE 2
+
+/*
+ * @brief    Boykov-Kolmogorov max flow engine.
+ *
+ *          Two search trees are grown at the same time, one from the source
+ *          and one from the target, from a FIFO queue of active nodes. When
+ *          they touch, the path through the touching edge is augmented, and
+ *          the nodes whose parent edge got saturated become orphans. Orphans
+ *          look for a new parent in their own tree that is still connected
+ *          to the terminal; the candidate closest to the terminal is taken,
+ *          with distances cached per augmentation by timestamp. Unlike the
+ *          BFS based engines the trees are reused between augmentations,
+ *          which is what makes it fast on vision graphs with short paths.
+ *
+ *          The terminal edges are not graph edges here. Every node keeps one
+ *          terminal residual: positive means residual capacity from the
+ *          source, negative means residual capacity to the target.
+ *
+ *          The graph type must provide getNodeCount(), getFirstEdge(),
+ *          getLastEdge(), getHead(), getReverse(), getResidualCapacity(),
+ *          setResidualCapacity(), getSourceCapacity(), getSinkCapacity() and
+ *          setTerminalFlow(), see gridGraph and bkTerminalAdapter, and the
+ *          capacityType and flowType typedefs. Terminal capacities are
+ *          flowType, a node can have many terminal edges.
+ */
+template<class Graph>
+class bkSolver{
+public:
+    typedef typename Graph::capacityType capacityType;
+    typedef typename Graph::flowType flowType;
+
+    /*
+     * @param[in] graph  The terminal graph to solve
+     * @param[in] arena  Scratch arena for the per node buffers, NULL to use the heap.
+     *                   The buffers stay in the arena until the caller's scratchScope ends.
+     */
+    bkSolver(Graph& graph, scratchArena* arena = NULL) :
+        graph_(graph),
+        node_count_(graph.getNodeCount()),
+        terminal_(node_count_, arena),
+        parent_(node_count_, arena),
+        tree_(node_count_, arena),
+        next_active_(node_count_, arena),
+        timestamp_(node_count_, arena),
+        distance_(node_count_, arena),
+        orphans_(node_count_, arena)
+    {
+    }
+
+    /*
+     * @brief   Compute the maximum flow. The residual capacities of the graph
+     *          are updated and the flow over the terminal edges is reported to
+     *          the graph with setTerminalFlow().
+     *
+     * @return  Returns the maximum flow possible in that flow network
+     */
+    flowType maxFlow(){
+        flowType flow = 0;
+        time_ = 0;
+        active_first_ = INVALID_PARENT;
+        active_last_ = INVALID_PARENT;
+        orphan_first_ = 0;
+        orphan_count_ = 0;
+
+        for(int node_id = 0; node_id < node_count_; node_id++){
+            flowType source_capacity = graph_.getSourceCapacity(node_id);
+            flowType sink_capacity = graph_.getSinkCapacity(node_id);
+            /* Flow straight from the source to the target through this node */
+            flow += source_capacity < sink_capacity ? source_capacity : sink_capacity;
+            terminal_[node_id] = source_capacity - sink_capacity;
+            next_active_[node_id] = INVALID_PARENT;
+            timestamp_[node_id] = 0;
+            distance_[node_id] = 1;
+            if(terminal_[node_id] == 0){
+                tree_[node_id] = BK_FREE;
+                parent_[node_id] = BK_NO_PARENT;
+                continue;
+            }
+            tree_[node_id] = terminal_[node_id] > 0 ? BK_SOURCE_TREE : BK_SINK_TREE;
+            parent_[node_id] = BK_TERMINAL_PARENT;
+            setActive(node_id);
+        }
+
+        int current_node = INVALID_PARENT;
+        while(true){
+            int node_id = current_node;
+            if(node_id != INVALID_PARENT && parent_[node_id] == BK_NO_PARENT){
+                /* It was freed by the last orphan pass, it is no longer queued either */
+                next_active_[node_id] = INVALID_PARENT;
+                node_id = INVALID_PARENT;
+            }
+            if(node_id == INVALID_PARENT){
+                node_id = nextActive();
+                if(node_id == INVALID_PARENT){
+                    break;
+                }
+            }
+            current_node = INVALID_PARENT;
+            SOLVER_COUNT(nodes_dequeued, 1);
+            SOLVER_COUNT(arcs_scanned, graph_.getLastEdge(node_id) - graph_.getFirstEdge(node_id));
+
+            /* Grow the tree of this node until it touches the other tree */
+            int middle_edge = INVALID_PARENT;
+            if(tree_[node_id] == BK_SOURCE_TREE){
+                for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+                    if(graph_.getResidualCapacity(edge_id) == 0){
+                        continue;
+                    }
+                    int next_node = graph_.getHead(edge_id);
+                    if(tree_[next_node] == BK_FREE){
+                        adopt(next_node, BK_SOURCE_TREE, graph_.getReverse(edge_id), node_id);
+                    } else if(tree_[next_node] == BK_SINK_TREE){
+                        middle_edge = edge_id;
+                        break;
+                    } else {
+                        shortenPath(next_node, graph_.getReverse(edge_id), node_id);
+                    }
+                }
+            } else {
+                for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+                    int back_edge = graph_.getReverse(edge_id);
+                    if(graph_.getResidualCapacity(back_edge) == 0){
+                        continue;
+                    }
+                    int next_node = graph_.getHead(edge_id);
+                    if(tree_[next_node] == BK_FREE){
+                        adopt(next_node, BK_SINK_TREE, back_edge, node_id);
+                    } else if(tree_[next_node] == BK_SOURCE_TREE){
+                        middle_edge = back_edge;
+                        break;
+                    } else {
+                        shortenPath(next_node, back_edge, node_id);
+                    }
+                }
+            }
+
+            if(middle_edge == INVALID_PARENT){
+                next_active_[node_id] = INVALID_PARENT;
+                continue;
+            }
+
+            /* Keep growing from this node after the augmentation if it is still in a tree */
+            current_node = node_id;
+            time_++;
+            flow += augment(middle_edge);
+            processOrphans();
+        }
+
+        for(int node_id = 0; node_id < node_count_; node_id++){
+            reportTerminalFlow(node_id);
+        }
+        return flow;
+    }
+
+    /* After maxFlow(), true if the node is on the source side of the minimum cut. */
+    bool isSourceSide(int node_id){
+        return tree_[node_id] == BK_SOURCE_TREE;
+    }
+private:
+    void setActive(int node_id){
+        if(next_active_[node_id] != INVALID_PARENT){
+            return;
+        }
+        /* The last node of the queue points to itself */
+        next_active_[node_id] = node_id;
+        if(active_last_ != INVALID_PARENT){
+            next_active_[active_last_] = node_id;
+        } else {
+            active_first_ = node_id;
+        }
+        active_last_ = node_id;
+    }
+
+    /* Pop the next active node that is still in a tree, INVALID_PARENT when there is none. */
+    int nextActive(){
+        while(active_first_ != INVALID_PARENT){
+            int node_id = active_first_;
+            int next = next_active_[node_id];
+            if(next == node_id){
+                active_first_ = INVALID_PARENT;
+                active_last_ = INVALID_PARENT;
+            } else {
+                active_first_ = next;
+            }
+            /* Mark it as still queued so setActive() does not queue it twice while it is grown */
+            next_active_[node_id] = node_id;
+            if(parent_[node_id] != BK_NO_PARENT){
+                return node_id;
+            }
+            next_active_[node_id] = INVALID_PARENT;
+        }
+        return INVALID_PARENT;
+    }
+
+    /* Attach a free node to a tree through parent_edge, the edge from the node to its parent. */
+    void adopt(int node_id, int tree, int parent_edge, int parent_node){
+        tree_[node_id] = tree;
+        parent_[node_id] = parent_edge;
+        timestamp_[node_id] = timestamp_[parent_node];
+        distance_[node_id] = distance_[parent_node] + 1;
+        setActive(node_id);
+    }
+
+    /* Distance heuristic: reattach a node of the same tree if that brings it closer to the terminal. */
+    void shortenPath(int node_id, int parent_edge, int parent_node){
+        if(timestamp_[node_id] <= timestamp_[parent_node] && distance_[node_id] > distance_[parent_node]){
+            parent_[node_id] = parent_edge;
+            timestamp_[node_id] = timestamp_[parent_node];
+            distance_[node_id] = distance_[parent_node] + 1;
+        }
+    }
+
+    void makeOrphan(int node_id){
+        /* Queued orphans are never orphaned again, so at most V of them are queued */
+        SOLVER_COUNT(orphans, 1);
+        parent_[node_id] = BK_ORPHAN_PARENT;
+        int slot = orphan_first_ + orphan_count_;
+        orphans_[slot < node_count_ ? slot : slot - node_count_] = node_id;
+        orphan_count_++;
+    }
+
+    /*
+     * Augment along source root -> .. -> tail(middle_edge) -> head(middle_edge) -> .. -> sink root.
+     * In the source tree the flow goes from the parent to the node, so it uses the back edge
+     * of the parent edge; in the sink tree it goes over the parent edge itself.
+     */
+    capacityType augment(int middle_edge){
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_AUGMENT);
+        /* The middle edge bounds the bottleneck, so it fits a capacity even though the terminal residuals may not */
+        capacityType bottleneck = graph_.getResidualCapacity(middle_edge);
+        int path_length = 1;
+        int node_id = graph_.getHead(graph_.getReverse(middle_edge));
+        for(; parent_[node_id] != BK_TERMINAL_PARENT; node_id = graph_.getHead(parent_[node_id])){
+            path_length++;
+            capacityType edge_cap = graph_.getResidualCapacity(graph_.getReverse(parent_[node_id]));
+            if(bottleneck > edge_cap){
+                bottleneck = edge_cap;
+            }
+        }
+        if(bottleneck > terminal_[node_id]){
+            bottleneck = (capacityType)terminal_[node_id];
+        }
+        node_id = graph_.getHead(middle_edge);
+        for(; parent_[node_id] != BK_TERMINAL_PARENT; node_id = graph_.getHead(parent_[node_id])){
+            path_length++;
+            capacityType edge_cap = graph_.getResidualCapacity(parent_[node_id]);
+            if(bottleneck > edge_cap){
+                bottleneck = edge_cap;
+            }
+        }
+        if(bottleneck > -terminal_[node_id]){
+            bottleneck = (capacityType)-terminal_[node_id];
+        }
+        SOLVER_COUNT_AUGMENTATION(path_length, bottleneck);
+
+        pushFlow(middle_edge, bottleneck);
+        node_id = graph_.getHead(graph_.getReverse(middle_edge));
+        while(parent_[node_id] != BK_TERMINAL_PARENT){
+            int parent_edge = parent_[node_id];
+            int parent_node = graph_.getHead(parent_edge);
+            pushFlow(graph_.getReverse(parent_edge), bottleneck);
+            if(graph_.getResidualCapacity(graph_.getReverse(parent_edge)) == 0){
+                makeOrphan(node_id);
+            }
+            node_id = parent_node;
+        }
+        terminal_[node_id] -= bottleneck;
+        if(terminal_[node_id] == 0){
+            makeOrphan(node_id);
+        }
+
+        node_id = graph_.getHead(middle_edge);
+        while(parent_[node_id] != BK_TERMINAL_PARENT){
+            int parent_edge = parent_[node_id];
+            int parent_node = graph_.getHead(parent_edge);
+            pushFlow(parent_edge, bottleneck);
+            if(graph_.getResidualCapacity(parent_edge) == 0){
+                makeOrphan(node_id);
+            }
+            node_id = parent_node;
+        }
+        terminal_[node_id] += bottleneck;
+        if(terminal_[node_id] == 0){
+            makeOrphan(node_id);
+        }
+        return bottleneck;
+    }
+
+    void pushFlow(int edge_id, capacityType delta){
+        int back_edge = graph_.getReverse(edge_id);
+        graph_.setResidualCapacity(edge_id, graph_.getResidualCapacity(edge_id) - delta);
+        graph_.setResidualCapacity(back_edge, graph_.getResidualCapacity(back_edge) + delta);
+    }
+
+    /*
+     * Distance from node_id to its terminal through valid parents, INT_MAX if
+     * the chain ends at an orphan. Nodes found connected in this augmentation
+     * are stamped with time_ so their distance is reused.
+     */
+    int originDistance(int node_id){
+        int distance = 0;
+        int start = node_id;
+        while(true){
+            if(timestamp_[node_id] == time_){
+                distance += distance_[node_id];
+                break;
+            }
+            int parent_edge = parent_[node_id];
+            distance++;
+            if(parent_edge == BK_TERMINAL_PARENT){
+                timestamp_[node_id] = time_;
+                distance_[node_id] = 1;
+                break;
+            }
+            if(parent_edge == BK_ORPHAN_PARENT){
+                return INT_MAX;
+            }
+            node_id = graph_.getHead(parent_edge);
+        }
+        /* Stamp the whole chain with its distances */
+        int d = distance;
+        for(node_id = start; timestamp_[node_id] != time_; node_id = graph_.getHead(parent_[node_id])){
+            timestamp_[node_id] = time_;
+            distance_[node_id] = d--;
+        }
+        return distance;
+    }
+
+    void processOrphans(){
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_ORPHANS);
+        while(orphan_count_ > 0){
+            int node_id = orphans_[orphan_first_];
+            orphan_first_ = orphan_first_ + 1 < node_count_ ? orphan_first_ + 1 : 0;
+            orphan_count_--;
+            int tree = tree_[node_id];
+
+            /* Look for the valid parent closest to the terminal */
+            int best_edge = INVALID_PARENT;
+            int best_distance = INT_MAX;
+            for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+                int residual_edge = tree == BK_SOURCE_TREE ? graph_.getReverse(edge_id) : edge_id;
+                if(graph_.getResidualCapacity(residual_edge) == 0){
+                    continue;
+                }
+                int next_node = graph_.getHead(edge_id);
+                if(tree_[next_node] != tree || parent_[next_node] == BK_NO_PARENT){
+                    continue;
+                }
+                int distance = originDistance(next_node);
+                if(distance < best_distance){
+                    best_distance = distance;
+                    best_edge = edge_id;
+                }
+            }
+
+            if(best_edge != INVALID_PARENT){
+                parent_[node_id] = best_edge;
+                timestamp_[node_id] = time_;
+                distance_[node_id] = best_distance + 1;
+                continue;
+            }
+
+            /* No parent found, the node becomes free and its children become orphans */
+            for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+                int next_node = graph_.getHead(edge_id);
+                int next_parent = parent_[next_node];
+                if(next_node == node_id || tree_[next_node] != tree || next_parent == BK_NO_PARENT){
+                    continue;
+                }
+                int residual_edge = tree == BK_SOURCE_TREE ? graph_.getReverse(edge_id) : edge_id;
+                if(graph_.getResidualCapacity(residual_edge) > 0){
+                    setActive(next_node);
+                }
+                if(next_parent >= 0 && graph_.getHead(next_parent) == node_id){
+                    makeOrphan(next_node);
+                }
+            }
+            tree_[node_id] = BK_FREE;
+            parent_[node_id] = BK_NO_PARENT;
+        }
+    }
+
+    /*
+     * Split what is left of the terminal residual back into flow over the
+     * source and the target edge of the node.
+     */
+    void reportTerminalFlow(int node_id){
+        flowType source_capacity = graph_.getSourceCapacity(node_id);
+        flowType sink_capacity = graph_.getSinkCapacity(node_id);
+        flowType terminal = terminal_[node_id];
+        if(terminal >= 0){
+            graph_.setTerminalFlow(node_id, source_capacity - terminal, sink_capacity);
+        } else {
+            graph_.setTerminalFlow(node_id, source_capacity, sink_capacity + terminal);
+        }
+    }
+
+    Graph& graph_;
+    int node_count_;
+    nodeArray<flowType, DYNAMIC_NODE_COUNT> terminal_; /* Source residual minus sink residual */
+    nodeArray<int, DYNAMIC_NODE_COUNT> parent_; /* Edge to the parent, or one of the BK_*_PARENT values */
+    nodeArray<char, DYNAMIC_NODE_COUNT> tree_; /* BK_FREE, BK_SOURCE_TREE or BK_SINK_TREE */
+    nodeArray<int, DYNAMIC_NODE_COUNT> next_active_; /* Active queue link, INVALID_PARENT if not queued */
+    nodeArray<int, DYNAMIC_NODE_COUNT> timestamp_; /* Augmentation in which distance_ was last known to be valid */
+    nodeArray<int, DYNAMIC_NODE_COUNT> distance_; /* Distance to the terminal along parent edges */
+    nodeArray<int, DYNAMIC_NODE_COUNT> orphans_; /* Ring buffer FIFO of orphans of the current augmentation */
+    int orphan_first_;
+    int orphan_count_;
+    int active_first_;
+    int active_last_;
+    int time_;
+};
+
+/*
+ * @brief    Presents a residualGraph as the terminal graph bkSolver expects.
+ *
+ *          The source and the target are taken out of the graph: the
+ *          residual capacities of the edges source->v and v->target become
+ *          the terminal capacities of v and every edge touching a terminal
+ *          looks saturated to the solver. When the solver reports the
+ *          terminal flow of v it is written back over those edges, so the
+ *          residual graph ends up holding a maximum flow like after any
+ *          other engine and findMinCut() can be used on it.
+ */
+template<class ResidualGraph>
+class bkTerminalAdapter{
+public:
+    typedef typename ResidualGraph::capacityType capacityType;
+    typedef typename ResidualGraph::flowType flowType;
+
+    bkTerminalAdapter(ResidualGraph& graph, scratchArena* arena = NULL) :
+        graph_(graph),
+        source_capacity_(graph.getNodeCount(), arena),
+        sink_capacity_(graph.getNodeCount(), arena)
+    {
+        const int source = graph_.getSource();
+        const int sink = graph_.getSink();
+        direct_flow_ = 0;
+        for(int edge_id = graph_.getFirstEdge(source); edge_id < graph_.getLastEdge(source); edge_id++){
+            if(graph_.getHead(edge_id) == sink){
+                /* A direct source->target edge never takes part in the search */
+                direct_flow_ += graph_.getResidualCapacity(edge_id);
+                pushFlow(edge_id, graph_.getResidualCapacity(edge_id));
+            } else if(graph_.getHead(edge_id) != source){
+                source_capacity_[graph_.getHead(edge_id)] += graph_.getResidualCapacity(edge_id);
+            }
+        }
+        for(int edge_id = graph_.getFirstEdge(sink); edge_id < graph_.getLastEdge(sink); edge_id++){
+            if(graph_.getHead(edge_id) != source && graph_.getHead(edge_id) != sink){
+                sink_capacity_[graph_.getHead(edge_id)] += graph_.getResidualCapacity(graph_.getReverse(edge_id));
+            }
+        }
+    }
+
+    int getNodeCount(){return graph_.getNodeCount();}
+    int getFirstEdge(int node_id){return graph_.getFirstEdge(node_id);}
+    int getLastEdge(int node_id){return graph_.getLastEdge(node_id);}
+    int getHead(int edge_id){return graph_.getHead(edge_id);}
+    int getReverse(int edge_id){return graph_.getReverse(edge_id);}
+    capacityType getResidualCapacity(int edge_id){
+        if(isTerminal(graph_.getHead(edge_id)) || isTerminal(graph_.getHead(graph_.getReverse(edge_id)))){
+            return 0;
+        }
+        return graph_.getResidualCapacity(edge_id);
+    }
+    void setResidualCapacity(int edge_id, capacityType residual_capacity){
+        graph_.setResidualCapacity(edge_id, residual_capacity);
+    }
+    flowType getSourceCapacity(int node_id){return source_capacity_[node_id];}
+    flowType getSinkCapacity(int node_id){return sink_capacity_[node_id];}
+
+    void setTerminalFlow(int node_id, flowType source_flow, flowType sink_flow){
+        if(isTerminal(node_id)){
+            return;
+        }
+        /* Spread the flow over the parallel terminal edges of the node */
+        for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+            if(graph_.getHead(edge_id) == graph_.getSink() && sink_flow > 0){
+                capacityType delta = sink_flow < (flowType)graph_.getResidualCapacity(edge_id) ? (capacityType)sink_flow : graph_.getResidualCapacity(edge_id);
+                pushFlow(edge_id, delta);
+                sink_flow -= delta;
+            } else if(graph_.getHead(edge_id) == graph_.getSource() && source_flow > 0){
+                int source_edge = graph_.getReverse(edge_id);
+                capacityType delta = source_flow < (flowType)graph_.getResidualCapacity(source_edge) ? (capacityType)source_flow : graph_.getResidualCapacity(source_edge);
+                pushFlow(source_edge, delta);
+                source_flow -= delta;
+            }
+        }
+    }
+
+    /* Flow of the source->target edges, which the solver does not see. */
+    flowType getDirectFlow(){return direct_flow_;}
+private:
+    bool isTerminal(int node_id){
+        return node_id == graph_.getSource() || node_id == graph_.getSink();
+    }
+
+    void pushFlow(int edge_id, capacityType delta){
+        int back_edge = graph_.getReverse(edge_id);
+        graph_.setResidualCapacity(edge_id, graph_.getResidualCapacity(edge_id) - delta);
+        graph_.setResidualCapacity(back_edge, graph_.getResidualCapacity(back_edge) + delta);
+    }
+
+    ResidualGraph& graph_;
+    nodeArray<flowType, DYNAMIC_NODE_COUNT> source_capacity_; /* Residual capacity from the source per node */
+    nodeArray<flowType, DYNAMIC_NODE_COUNT> sink_capacity_; /* Residual capacity to the target per node */
+    flowType direct_flow_;
+};
+
+/*
+ * @brief   Compute the maximum flow of a grid graph with the Boykov-Kolmogorov
+ *          engine. Use bkSolver directly to also get the segmentation.
+ *
+ * @param [in]  arena   Scratch arena for the buffers of the solver, NULL to use
+ *                      the heap. The default value is NULL.
+ *
+ * @return  Returns the maximum flow possible in that flow network
+ */
+template<int CONNECTIVITY, class Capacity>
+typename gridGraph<CONNECTIVITY, Capacity>::flowType boykovKolmogorov(gridGraph<CONNECTIVITY, Capacity>& graph,
+        scratchArena* arena = NULL){
+    scratchScope scope(arena);
+    bkSolver<gridGraph<CONNECTIVITY, Capacity> > solver(graph, arena);
+    return solver.maxFlow();
+}
+
+/*
+ * @brief   Compute the maximum flow of a residual graph with the
+ *          Boykov-Kolmogorov engine. The flow is left in the residual graph,
+ *          so findMinCut() can be called on the result.
+ *
+ * @param [in]  arena   Scratch arena for the buffers of the solver, NULL to use
+ *                      the heap. The default value is NULL.
+ *
+ * @return  Returns the maximum flow possible in that flow network
+ */
+template<class Graph>
+typename Graph::flowType boykovKolmogorov(Graph& graph, scratchArena* arena = NULL){
+    if(graph.getSource() == graph.getSink()){
+        return 0;
+    }
+    scratchScope scope(arena);
+    bkTerminalAdapter<Graph> adapter(graph, arena);
+    bkSolver<bkTerminalAdapter<Graph> > solver(adapter, arena);
+    typename Graph::flowType max_flow = solver.maxFlow();
+    return max_flow + adapter.getDirectFlow();
+}
+
+#endif
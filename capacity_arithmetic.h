@@ -0,0 +1,111 @@
+#ifndef CAPACITY_ARITHMETIC_H
+#define CAPACITY_ARITHMETIC_H
+
+#include<limits>
+#include<sstream>
+#include<string>
+#include<type_traits>
+
+/*
+ * Arithmetic on capacities that never wraps around silently. Capacities are
+ * stored as narrow as possible, 16 or 32 bits per edge, so adding two of
+ * them up, or an input value that does not fit the storage type, must be
+ * caught where it happens instead of turning into a wrong flow later.
+ * Floating point capacities can not overflow and always pass.
+ */
+
+/* Integer types, __int128 included, which std::is_integral leaves out in strict ISO mode */
+template<class T>
+struct isIntegralValue{
+    static const bool value = std::is_integral<T>::value;
+};
+#ifdef __SIZEOF_INT128__
+template<>
+struct isIntegralValue<__int128>{
+    static const bool value = true;
+};
+#endif
+
+/*
+ * @brief   Add two capacities or flow values.
+ *
+ * @param[in]  a, b     Values to add
+ * @param[out] sum      Receives a + b, left unchanged if it does not fit T
+ *
+ * @return  False if a + b does not fit T
+ */
+template<class T>
+inline bool checkedAdd(T a, T b, T& sum){
+    if constexpr(isIntegralValue<T>::value){
+        T result;
+        if(__builtin_add_overflow(a, b, &result)){
+            return false;
+        }
+        sum = result;
+    } else {
+        sum = a + b;
+    }
+    return true;
+}
+
+/* a + b, or the largest or lowest value of T if the sum does not fit it */
+template<class T>
+inline T saturatingAdd(T a, T b){
+    T sum;
+    if(checkedAdd(a, b, sum)){
+        return sum;
+    }
+    return b > 0 ? std::numeric_limits<T>::max() : std::numeric_limits<T>::lowest();
+}
+
+/*
+ * @brief   Check that a capacity can be stored in a graph of the given
+ *          storage type. Capacities are never negative.
+ *
+ * @param[in] value  A capacity in the capacity type of the graph, which is the
+ *                   storage type itself or int for narrower storage types,
+ *                   or in its flow type
+ */
+template<class Storage, class T>
+inline bool fitsCapacityStorage(T value){
+    if constexpr(!std::is_unsigned<T>::value){
+        if(value < 0){
+            return false;
+        }
+    }
+    if constexpr(std::is_integral<Storage>::value){
+        return value <= (T)std::numeric_limits<Storage>::max();
+    }
+    return true;
+}
+
+/*
+ * @brief   Printable form of a flow value. Streams do not know __int128, the
+ *          total flow type of 64 bit capacities, so it is converted by hand.
+ */
+template<class Flow>
+inline std::string flowToString(Flow value){
+    std::ostringstream text;
+    text<<value;
+    return text.str();
+}
+
+#ifdef __SIZEOF_INT128__
+inline std::string flowToString(__int128 value){
+    const bool negative = value < 0;
+    unsigned __int128 magnitude = negative ? -(unsigned __int128)value : (unsigned __int128)value;
+    char digits[48];
+    int position = sizeof(digits);
+    digits[--position] = '\0';
+    do{
+        digits[--position] = (char)('0' + (int)(magnitude % 10));
+        magnitude /= 10;
+    } while(magnitude != 0);
+    if(negative){
+        digits[--position] = '-';
+    }
+    return std::string(digits + position);
+}
+#endif
+
+#endif
@@ -0,0 +1,349 @@
+#ifndef DIMACS_PARSER_H
+#define DIMACS_PARSER_H
+
+#include<charconv>
+#include<chrono>
+#include<cstring>
+#include<cstdint>
+#include<iostream>
+#include<limits>
+#include<thread>
+#include<vector>
+
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+#include "residual_graph.h"
+
+#define DIMACS_MIN_CHUNK_BYTES (1 << 20) /* Smaller inputs are split into fewer chunks than threads */
+/*
+ * Every chunk counts the edges of all the nodes, so the chunks are limited
+ * to at most this many counts per arc together. The counts then take no
+ * more than half the memory of the edge arrays, and adding them up per node
+ * is linear in the arcs. Graphs with few arcs per node get fewer chunks.
+ */
+#define DIMACS_MAX_COUNTS_PER_ARC 4
+
+/* Timing of a loadDimacsGraph() call */
+struct dimacsParseStats{
+    size_t bytes; /* Size of the input file */
+    int chunk_count; /* Chunks the arc lines were split into, one thread each */
+    double seconds; /* Wall time from opening the file to the finished graph */
+    double megabytes_per_second; /* bytes / seconds, in units of 10^6 bytes */
+};
+
+/* One piece of the arc lines of the input with what its first pass found */
+struct dimacsChunk{
+    const char* begin;
+    const char* end;
+    long long arc_count;
+    int source;
+    int sink;
+    int source_count;
+    int sink_count;
+    const char* error; /* Start of the first line that failed to parse, NULL if none did */
+    std::vector<int32_t> next_slot; /* Edges of each node in this chunk, then the next free slot per node */
+};
+
+inline const char* dimacsSkipSpaces(const char* position, const char* end){
+    while(position < end && (*position == ' ' || *position == '\t' || *position == '\r')){
+        position++;
+    }
+    return position;
+}
+
+/* Read the next integer token of a line and advance past it. */
+inline bool dimacsParseInt(const char*& position, const char* end, long long& value){
+    position = dimacsSkipSpaces(position, end);
+    std::from_chars_result result = std::from_chars(position, end, value);
+    if(result.ec != std::errc() || (result.ptr < end && *result.ptr != ' ' && *result.ptr != '\t' && *result.ptr != '\r')){
+        return false;
+    }
+    position = result.ptr;
+    return true;
+}
+
+inline const char* dimacsLineEnd(const char* line, const char* end){
+    const char* line_end = static_cast<const char*>(memchr(line, '\n', end - line));
+    return line_end != NULL ? line_end : end;
+}
+
+/*
+ * @brief   Parse the node descriptor and arc lines of [begin, end), calling
+ *          visit_arc(from, to, capacity) with 0 based node ids for every arc
+ *          in file order. Comment and empty lines are skipped.
+ *
+ * @return  Returns true if every line is valid, otherwise chunk.error is set
+ */
+template<class ArcVisitor>
+bool dimacsParseLines(dimacsChunk& chunk, int node_count, ArcVisitor visit_arc){
+    const long long max_capacity = std::numeric_limits<residualCapacityStorage>::max();
+    for(const char* line = chunk.begin; line < chunk.end;){
+        const char* line_end = dimacsLineEnd(line, chunk.end);
+        const char* position = dimacsSkipSpaces(line, line_end);
+        if(position < line_end && *position != 'c'){
+            long long from;
+            long long to;
+            long long capacity;
+            char kind = *position++;
+            if(kind == 'a' && dimacsParseInt(position, line_end, from) && dimacsParseInt(position, line_end, to)
+                    && dimacsParseInt(position, line_end, capacity)
+                    && dimacsSkipSpaces(position, line_end) == line_end
+                    && from >= 1 && from <= node_count && to >= 1 && to <= node_count
+                    && capacity >= 0 && capacity <= max_capacity){
+                visit_arc((int)from - 1, (int)to - 1, (int)capacity);
+            } else if(kind == 'n' && dimacsParseInt(position, line_end, from) && from >= 1 && from <= node_count){
+                position = dimacsSkipSpaces(position, line_end);
+                char terminal = position < line_end ? *position++ : 0;
+                if(dimacsSkipSpaces(position, line_end) != line_end || (terminal != 's' && terminal != 't')){
+                    chunk.error = line;
+                    return false;
+                }
+                if(terminal == 's'){
+                    chunk.source = (int)from - 1;
+                    chunk.source_count++;
+                } else {
+                    chunk.sink = (int)from - 1;
+                    chunk.sink_count++;
+                }
+            } else {
+                chunk.error = line;
+                return false;
+            }
+        }
+        line = line_end + 1;
+    }
+    return true;
+}
+
+/* Run work(0) .. work(thread_count - 1) on as many threads, the caller runs work(0). */
+template<class Work>
+void dimacsParallelFor(int thread_count, Work work){
+    std::vector<std::thread> threads;
+    for(int i = 1; i < thread_count; i++){
+        threads.push_back(std::thread(work, i));
+    }
+    work(0);
+    for(size_t i = 0; i < threads.size(); i++){
+        threads[i].join();
+    }
+}
+
+/* 1 based line number of position, only used for error messages. */
+inline long long dimacsLineNumber(const char* data, const char* position){
+    long long line = 1;
+    for(const char* p = data; p < position; p++){
+        line += *p == '\n';
+    }
+    return line;
+}
+
+/*
+ * @brief   Split the arc lines of a DIMACS max flow problem into per thread
+ *          chunks and build the CSR graph from them in two parallel passes.
+ *          The first pass tokenizes every chunk and counts the edges of each
+ *          node per chunk, the second one tokenizes it again and stores each
+ *          edge and its back edge directly at its final index. The per chunk
+ *          counts give every chunk its own slot range at every node, so the
+ *          edge order is exactly that of adding the arcs in file order.
+ *
+ *          Integers are read with std::from_chars from the mapped file, there
+ *          are no iostreams and no copies of the input. The per chunk counts
+ *          take 4 bytes per node and thread.
+ *
+ * @param[in]  path          DIMACS file with a "p max" line, one "n id s" and
+ *                           one "n id t" line and the "a from to capacity" lines.
+ *                           Node ids are 1 based, the graph uses id - 1.
+ * @param[in]  thread_count  Threads to parse with, 0 meaning all hardware threads.
+ *                           The default value is 0.
+ * @param[out] stats         Receives the size and the parse throughput. The default
+ *                           value is NULL.
+ *
+ * @return  Returns the graph, owned by the caller, or NULL if the file can not
+ *          be read or is not a valid max flow problem
+ */
+inline residualGraph<>* loadDimacsGraph(const char* path, int thread_count = 0, dimacsParseStats* stats = NULL){
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    if(thread_count <= 0){
+        thread_count = (int)std::thread::hardware_concurrency();
+    }
+    if(thread_count < 1){
+        thread_count = 1;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        std::cerr<<"Failed to open the DIMACS file "<<path<<"\n";
+        return NULL;
+    }
+    struct stat file_stat;
+    if(fstat(fd, &file_stat) != 0){
+        std::cerr<<"Failed to read the DIMACS file "<<path<<"\n";
+        close(fd);
+        return NULL;
+    }
+    const size_t size = file_stat.st_size;
+    void* mapping = size > 0 ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if(mapping == MAP_FAILED){
+        std::cerr<<"Failed to map the DIMACS file "<<path<<"\n";
+        return NULL;
+    }
+    const char* data = static_cast<const char*>(mapping);
+    const char* end = data + size;
+
+    /* Comments and the problem line come first, the arc lines start at the first other line */
+    long long node_count = -1;
+    long long arc_count = -1;
+    const char* body = data;
+    while(body < end){
+        const char* line_end = dimacsLineEnd(body, end);
+        const char* position = dimacsSkipSpaces(body, line_end);
+        if(position < line_end && *position != 'c'){
+            if(node_count >= 0 || *position != 'p'){
+                break;
+            }
+            position = dimacsSkipSpaces(position + 1, line_end);
+            /* The problem name is a whole token, "max5" is not "max" */
+            bool is_max = line_end - position >= 3 && strncmp(position, "max", 3) == 0
+                && (line_end - position == 3 || dimacsSkipSpaces(position + 3, line_end) != position + 3);
+            position += 3;
+            if(!is_max || !dimacsParseInt(position, line_end, node_count)
+                    || !dimacsParseInt(position, line_end, arc_count)
+                    || dimacsSkipSpaces(position, line_end) != line_end
+                    || node_count < 0 || node_count > INT32_MAX || arc_count < 0 || arc_count > INT32_MAX / 2){
+                std::cerr<<"Invalid problem line at line "<<dimacsLineNumber(data, body)<<" of "<<path<<"\n";
+                munmap(mapping, size);
+                return NULL;
+            }
+        }
+        body = line_end + 1;
+    }
+    if(node_count < 0){
+        std::cerr<<"The DIMACS file "<<path<<" has no \"p max\" problem line\n";
+        if(mapping != NULL){
+            munmap(mapping, size);
+        }
+        return NULL;
+    }
+    if(body > end){
+        body = end;
+    }
+
+    /* Chunk boundaries are moved to the start of the next line */
+    long long body_size = end - body;
+    long long chunk_limit = body_size / DIMACS_MIN_CHUNK_BYTES + 1;
+    if(node_count > 0 && DIMACS_MAX_COUNTS_PER_ARC * arc_count / node_count < chunk_limit){
+        chunk_limit = DIMACS_MAX_COUNTS_PER_ARC * arc_count / node_count;
+        chunk_limit = chunk_limit > 0 ? chunk_limit : 1;
+    }
+    const int chunk_count = thread_count < chunk_limit ? thread_count : (int)chunk_limit;
+    std::vector<dimacsChunk> chunks(chunk_count);
+    for(int i = 0; i < chunk_count; i++){
+        const char* begin = body + body_size * i / chunk_count;
+        if(i > 0 && begin < end){
+            begin = dimacsLineEnd(begin - 1, end) + 1;
+            begin = begin < end ? begin : end;
+        }
+        chunks[i].begin = i > 0 && begin < chunks[i - 1].begin ? chunks[i - 1].begin : begin;
+        chunks[i].arc_count = 0;
+        chunks[i].source_count = 0;
+        chunks[i].sink_count = 0;
+        chunks[i].error = NULL;
+    }
+    for(int i = 0; i < chunk_count; i++){
+        chunks[i].end = i + 1 < chunk_count ? chunks[i + 1].begin : end;
+    }
+
+    /* First pass: validate and count the edges of every node per chunk */
+    dimacsParallelFor(chunk_count, [&](int chunk_id){
+        dimacsChunk& chunk = chunks[chunk_id];
+        chunk.next_slot.assign(node_count, 0);
+        dimacsParseLines(chunk, (int)node_count, [&](int from, int to, int capacity){
+            (void)capacity;
+            chunk.next_slot[from]++;
+            chunk.next_slot[to]++;
+            chunk.arc_count++;
+        });
+    });
+
+    int source = -1;
+    int sink = -1;
+    int source_count = 0;
+    int sink_count = 0;
+    long long parsed_arcs = 0;
+    for(int i = 0; i < chunk_count; i++){
+        if(chunks[i].error != NULL){
+            std::cerr<<"Invalid line "<<dimacsLineNumber(data, chunks[i].error)<<" of "<<path<<"\n";
+            munmap(mapping, size);
+            return NULL;
+        }
+        if(chunks[i].source_count > 0){
+            source = chunks[i].source;
+        }
+        if(chunks[i].sink_count > 0){
+            sink = chunks[i].sink;
+        }
+        source_count += chunks[i].source_count;
+        sink_count += chunks[i].sink_count;
+        parsed_arcs += chunks[i].arc_count;
+    }
+    if(source_count != 1 || sink_count != 1 || parsed_arcs != arc_count){
+        std::cerr<<"The DIMACS file "<<path<<" must have one source, one target and the "
+            <<arc_count<<" arcs of its problem line, it has "<<source_count<<", "<<sink_count
+            <<" and "<<parsed_arcs<<"\n";
+        munmap(mapping, size);
+        return NULL;
+    }
+
+    residualGraph<>* graph = new residualGraph<>((int)node_count, source, sink);
+    std::vector<int32_t> degrees(node_count, 0);
+    const int node_threads = chunk_count;
+    dimacsParallelFor(node_threads, [&](int thread_id){
+        long long first = node_count * thread_id / node_threads;
+        long long last = node_count * (thread_id + 1) / node_threads;
+        for(long long node_id = first; node_id < last; node_id++){
+            for(int i = 0; i < chunk_count; i++){
+                degrees[node_id] += chunks[i].next_slot[node_id];
+            }
+        }
+    });
+    graph->allocateEdges(degrees);
+
+    /* Turn the per chunk counts into the first slot of every chunk at every node */
+    dimacsParallelFor(node_threads, [&](int thread_id){
+        long long first = node_count * thread_id / node_threads;
+        long long last = node_count * (thread_id + 1) / node_threads;
+        for(long long node_id = first; node_id < last; node_id++){
+            int32_t slot = graph->getFirstEdge((int)node_id);
+            for(int i = 0; i < chunk_count; i++){
+                int32_t chunk_edges = chunks[i].next_slot[node_id];
+                chunks[i].next_slot[node_id] = slot;
+                slot += chunk_edges;
+            }
+        }
+    });
+
+    /* Second pass: store the edges, every chunk only writes its own slots */
+    dimacsParallelFor(chunk_count, [&](int chunk_id){
+        dimacsChunk& chunk = chunks[chunk_id];
+        dimacsParseLines(chunk, (int)node_count, [&](int from, int to, int capacity){
+            graph->setEdgePair(chunk.next_slot[from]++, chunk.next_slot[to]++, from, to, capacity);
+        });
+        std::vector<int32_t>().swap(chunk.next_slot);
+    });
+
+    munmap(mapping, size);
+    if(stats != NULL){
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        stats->bytes = size;
+        stats->chunk_count = chunk_count;
+        stats->seconds = seconds;
+        stats->megabytes_per_second = seconds > 0 ? size / seconds / 1e6 : 0;
+    }
+    return graph;
+}
+
+#endif
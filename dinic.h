@@ -0,0 +1,177 @@
+#ifndef DINIC_H
+#define DINIC_H
+
+#include<climits>
+
+#include "residual_graph.h"
+#include "simd_scan.h"
+#include "solver_counters.h"
+#include "solve_control.h"
+
+#define DINIC_CONTROL_AUGMENTATIONS 64 /* Augmentations between two solveControl checks within a phase */
+
+/*
+ * @brief   Build the BFS level graph of the residual graph for one phase of
+ *          Dinic's algorithm. level[v] is the number of residual edges on a
+ *          shortest path from the source to v, or INVALID_PARENT if v can not
+ *          be reached. The search stops after the level of the target node is
+ *          complete, nodes further away can never be on a shortest path.
+ *
+ * @param[in]   graph   A residual graph
+ * @param[out]  level   Level of every node
+ * @param[out]  queue   Scratch buffer with room for every node
+ *
+ * @return  True if the target node is reachable from the source
+ */
+template<class Graph>
+bool dinicBuildLevels(Graph& graph,
+        nodeArray<int, Graph::STATIC_NODE_COUNT>& level,
+        nodeArray<int, Graph::STATIC_NODE_COUNT>& queue)
+{
+    const int sink = graph.getSink();
+    SOLVER_PHASE_TIMER(SOLVER_PHASE_SEARCH);
+    SOLVER_COUNT(bfs_calls, 1);
+    for(int i = 0; i < graph.getNodeCount(); i++){
+        level[i] = INVALID_PARENT;
+    }
+
+    int q_head = 0;
+    int q_tail = 0;
+    queue[q_tail++] = graph.getSource();
+    level[graph.getSource()] = 0;
+    while(q_head != q_tail){
+        int node_id = queue[q_head++];
+        if(level[sink] != INVALID_PARENT && level[node_id] >= level[sink]){
+            break;
+        }
+        SOLVER_COUNT(nodes_dequeued, 1);
+        SOLVER_COUNT(arcs_scanned, graph.getLastEdge(node_id) - graph.getFirstEdge(node_id));
+        forEachResidualArc(graph, node_id, [&](int edge_id){
+            int next_node = graph.getHead(edge_id);
+            if(level[next_node] == INVALID_PARENT){
+                level[next_node] = level[node_id] + 1;
+                queue[q_tail++] = next_node;
+            }
+        });
+    }
+    return level[sink] != INVALID_PARENT;
+}
+
+/*
+ * @brief   Implementation of Dinic's algorithm to compute the maximum flow
+ *          possible in a flow network.
+ *
+ *          Every phase builds one level graph with dinicBuildLevels() and then
+ *          saturates it with a blocking flow. The blocking flow is found by an
+ *          iterative DFS that only follows edges going one level up and keeps
+ *          a current edge pointer per node, so an edge that is found saturated
+ *          or leading to a dead end is never looked at again in that phase.
+ *          This is O(V^2 E) in general and O(E sqrt(V)) on unit capacity
+ *          networks such as bipartite matching.
+ *
+ *          The flow is left in the residual graph the same way fordFulkerson()
+ *          leaves it, so findMinCut() can be called on the result.
+ *
+ * @param [in]  graph   A flow network transformed into a residual graph
+ *                      with back edges
+ * @param [in]  arena   Scratch arena for the per node buffers, NULL to use the
+ *                      heap. The default value is NULL.
+ * @param [in]  control Checked before every phase and every DINIC_CONTROL_AUGMENTATIONS
+ *                      augmentations to stop on cancellation or at a deadline, see
+ *                      solveControl. NULL never stops. The default value is NULL.
+ *
+ * @return  Returns the maximum flow possible in that flow network, the flow found
+ *          so far if control stopped the search
+ */
+template<class Graph>
+typename Graph::flowType dinic(Graph& graph, scratchArena* arena = NULL,
+        solveControl<typename Graph::flowType>* control = NULL)
+{
+    typedef typename Graph::capacityType capacityType;
+    const int node_count = graph.getNodeCount();
+    const int source = graph.getSource();
+    const int sink = graph.getSink();
+
+    scratchScope scope(arena);
+    nodeArray<int, Graph::STATIC_NODE_COUNT> level(node_count, arena);
+    nodeArray<int, Graph::STATIC_NODE_COUNT> current_edge(node_count, arena); /* Next edge to try per node */
+    nodeArray<int, Graph::STATIC_NODE_COUNT> scratch(node_count, arena); /* BFS queue, then DFS path of edges */
+    typename Graph::flowType max_flow = 0;
+
+    if(source == sink){
+        return 0;
+    }
+
+    int unchecked_augmentations = 0;
+    while(dinicBuildLevels(graph, level, scratch)){
+        if(control != NULL && control->shouldStop(graph, max_flow)){
+            return max_flow;
+        }
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_AUGMENT);
+        for(int i = 0; i < node_count; i++){
+            current_edge[i] = graph.getFirstEdge(i);
+        }
+
+        /*
+         * scratch[0 .. path_length) holds the edges of the DFS path from the
+         * source. A path can not be longer than the number of levels, so
+         * it fits in the node sized buffer.
+         */
+        int path_length = 0;
+        int node_id = source;
+        while(true){
+            if(node_id == sink){
+                /* Augment along the path and restart from the tail of the first saturated edge */
+                capacityType min_flow_in_path = minResidual(graph.getResidualCapacities(), &scratch[0], path_length);
+                SOLVER_COUNT_AUGMENTATION(path_length, min_flow_in_path);
+                max_flow += min_flow_in_path;
+
+                int first_saturated = path_length;
+                for(int i = 0; i < path_length; i++){
+                    int edge_id = scratch[i];
+                    int back_edge = graph.getReverse(edge_id);
+                    graph.setResidualCapacity(edge_id, graph.getResidualCapacity(edge_id) - min_flow_in_path);
+                    graph.setResidualCapacity(back_edge, graph.getResidualCapacity(back_edge) + min_flow_in_path);
+                    if(graph.getResidualCapacity(edge_id) == 0 && first_saturated == path_length){
+                        first_saturated = i;
+                    }
+                }
+                path_length = first_saturated;
+                node_id = path_length == 0 ? source : graph.getHead(scratch[path_length - 1]);
+                if(control != NULL && ++unchecked_augmentations == DINIC_CONTROL_AUGMENTATIONS){
+                    unchecked_augmentations = 0;
+                    if(control->shouldStop(graph, max_flow)){
+                        return max_flow;
+                    }
+                }
+                continue;
+            }
+
+            /* Advance along the first admissible edge of this node */
+            int& edge_id = current_edge[node_id];
+            for(; edge_id < graph.getLastEdge(node_id); edge_id++){
+                if(graph.getResidualCapacity(edge_id) > 0 && level[graph.getHead(edge_id)] == level[node_id] + 1){
+                    break;
+                }
+            }
+            if(edge_id < graph.getLastEdge(node_id)){
+                scratch[path_length++] = edge_id;
+                node_id = graph.getHead(edge_id);
+                continue;
+            }
+
+            /* Dead end, drop the node from the level graph and retreat */
+            if(node_id == source){
+                break;
+            }
+            level[node_id] = INVALID_PARENT;
+            path_length--;
+            node_id = path_length == 0 ? source : graph.getHead(scratch[path_length - 1]);
+            current_edge[node_id]++;
+        }
+    }
+
+    return max_flow;
+}
+
+#endif
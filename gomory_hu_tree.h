@@ -0,0 +1,233 @@
+#ifndef GOMORY_HU_TREE_H
+#define GOMORY_HU_TREE_H
+
+#include<algorithm>
+#include<limits>
+#include<memory>
+#include<thread>
+#include<vector>
+
+#include "max_flow.h"
+#include "solver_counters.h"
+
+/*
+ * @brief    Gomory-Hu tree of an undirected graph, built with Gusfield's
+ *          algorithm, for minimum cut queries between any pair of nodes.
+ *
+ *          The graph is given as a residual graph in which every undirected
+ *          edge {u, v} of capacity c was added as the two edges u->v and v->u
+ *          of capacity c. Node s > 0 is cut from its current tree parent with
+ *          one max flow, V - 1 max flows in all, and the nodes of the s side
+ *          that hung from the same parent move below s. The minimum cut
+ *          between u and v is then the lightest edge on the tree path between
+ *          them, and removing that edge splits the tree into the two sides of
+ *          such a cut.
+ *
+ *          Iteration s only depends on the earlier ones through the parent of
+ *          s, so with several threads the cuts of the next thread_count nodes
+ *          are computed at once, each thread on its own copy of the graph and
+ *          with its own workspace. The cuts are then applied in order, and the
+ *          first node whose parent was changed by an earlier cut of the same
+ *          round starts the next round, so the tree is exactly the one the
+ *          serial algorithm builds with the same cuts.
+ *
+ *          Queries walk the tree with binary lifting tables built once, so
+ *          every query is O(log V).
+ */
+template<class Graph>
+class gomoryHuTree{
+public:
+    typedef typename Graph::flowType flowType;
+
+    gomoryHuTree() : node_count_(0), level_count_(0){
+    }
+
+    /*
+     * @brief   Build the tree of a graph. The graph itself is not modified,
+     *          the max flows run on copies of it.
+     *
+     * @param [in]  graph           Residual graph of the undirected graph, every edge
+     *                              added in both directions with the same capacity. Its
+     *                              source and sink are ignored.
+     * @param [in]  thread_count    Max flows computed at once. 0 means one per hardware
+     *                              thread. The default value is 1.
+     * @param [in]  engine          One of the MAX_FLOW_* engine ids, run on one thread.
+     *                              The default value is MAX_FLOW_DINIC.
+     */
+    void build(Graph& graph, int thread_count = 1, int engine = MAX_FLOW_DINIC){
+        node_count_ = graph.getNodeCount();
+        parent_.assign(node_count_, 0);
+        weight_.assign(node_count_, 0);
+        if(node_count_ == 0){
+            level_count_ = 0;
+            return;
+        }
+        parent_[0] = INVALID_PARENT;
+
+        if(thread_count < 1){
+            thread_count = (int)std::thread::hardware_concurrency();
+        }
+        thread_count = std::max(1, std::min(thread_count, node_count_ - 1));
+        std::vector<std::unique_ptr<cutWorker> > workers;
+        for(int i = 0; i < thread_count; i++){
+            workers.push_back(std::unique_ptr<cutWorker>(new cutWorker(graph)));
+        }
+
+        for(int first = 1; first < node_count_;){
+            const int round_size = std::min(thread_count, node_count_ - first);
+            for(int i = 0; i < round_size; i++){
+                workers[i]->node = first + i;
+                workers[i]->target = parent_[first + i];
+            }
+            {
+                solverCountersFork fork(round_size);
+                std::vector<std::thread> threads;
+                for(int i = 1; i < round_size; i++){
+                    threads.push_back(std::thread(&gomoryHuTree::computeCut, workers[i].get(), engine, fork.getThreadCounters(i)));
+                }
+                computeCut(workers[0].get(), engine, fork.getThreadCounters(0));
+                for(size_t i = 0; i < threads.size(); i++){
+                    threads[i].join();
+                }
+            }
+            int applied = 0;
+            while(applied < round_size && parent_[workers[applied]->node] == workers[applied]->target){
+                applyCut(*workers[applied]);
+                applied++;
+            }
+            first += applied;
+        }
+        buildLiftingTables();
+    }
+
+    /*
+     * @brief   Value of a minimum cut between two nodes of the graph.
+     *
+     * @return  Returns the minimum cut between u and v, 0 if u and v are not
+     *          connected or are the same node
+     */
+    flowType getMinCut(int u, int v){
+        if(u == v){
+            return 0;
+        }
+        if(depth_[u] < depth_[v]){
+            std::swap(u, v);
+        }
+        flowType lightest = std::numeric_limits<flowType>::max();
+        for(int level = 0, climb = depth_[u] - depth_[v]; climb != 0; level++, climb >>= 1){
+            if((climb & 1) != 0){
+                lightest = std::min(lightest, lightest_[level * node_count_ + u]);
+                u = ancestors_[level * node_count_ + u];
+            }
+        }
+        if(u == v){
+            return lightest;
+        }
+        for(int level = level_count_ - 1; level >= 0; level--){
+            const int index_u = level * node_count_ + u;
+            const int index_v = level * node_count_ + v;
+            if(ancestors_[index_u] != ancestors_[index_v]){
+                lightest = std::min(lightest, std::min(lightest_[index_u], lightest_[index_v]));
+                u = ancestors_[index_u];
+                v = ancestors_[index_v];
+            }
+        }
+        return std::min(lightest, std::min(lightest_[u], lightest_[v]));
+    }
+
+    int getNodeCount(){return node_count_;}
+    /* Tree parent of a node, INVALID_PARENT for the root, node 0 */
+    int getParent(int node_id){return parent_[node_id];}
+    /* Capacity of the tree edge from a node to its parent, the minimum cut between the two */
+    flowType getWeight(int node_id){return weight_[node_id];}
+private:
+    gomoryHuTree(const gomoryHuTree&);
+    gomoryHuTree& operator=(const gomoryHuTree&);
+
+    /* One max flow of a round, on the thread's own copy of the graph */
+    struct cutWorker{
+        cutWorker(Graph& graph) : graph(graph), node(0), target(0), flow(0){}
+
+        Graph graph;
+        solverWorkspace<Graph::STATIC_NODE_COUNT> workspace;
+        maxFlowResult<flowType> result; /* s_side is the side of node */
+        int node;
+        int target; /* Parent of node when the round started */
+        flowType flow;
+    };
+
+    static void computeCut(cutWorker* worker, int engine, solverCounters* counters){
+        solverCountersScope scope(counters);
+        worker->graph.clearFlow();
+        worker->graph.setTerminals(worker->node, worker->target);
+        worker->flow = computeMaxFlow(worker->graph, engine, MAX_FLOW_OUTPUT_CUT, worker->result, 1, &worker->workspace);
+    }
+
+    /* Gusfield's update for the cut of worker.node from its parent */
+    void applyCut(const cutWorker& worker){
+        const int s = worker.node;
+        const int t = worker.target;
+        const minCutBitmap& s_side = worker.result.s_side;
+        weight_[s] = worker.flow;
+        for(int i = 0; i < node_count_; i++){
+            if(i != s && s_side.isSourceSide(i) && parent_[i] == t){
+                parent_[i] = s;
+            }
+        }
+        /* The parent of t is on the s side: s takes the place of t in the tree */
+        if(parent_[t] != INVALID_PARENT && s_side.isSourceSide(parent_[t])){
+            parent_[s] = parent_[t];
+            parent_[t] = s;
+            weight_[s] = weight_[t];
+            weight_[t] = worker.flow;
+        }
+    }
+
+    /* Depths, and the 2^k-th ancestor and lightest edge on the way up to it of every node */
+    void buildLiftingTables(){
+        depth_.assign(node_count_, INVALID_PARENT);
+        depth_[0] = 0;
+        std::vector<int> path;
+        for(int i = 0; i < node_count_; i++){
+            int node_id = i;
+            while(depth_[node_id] == INVALID_PARENT){
+                path.push_back(node_id);
+                node_id = parent_[node_id];
+            }
+            while(!path.empty()){
+                depth_[path.back()] = depth_[parent_[path.back()]] + 1;
+                path.pop_back();
+            }
+        }
+
+        level_count_ = 1;
+        while((1 << level_count_) < node_count_){
+            level_count_++;
+        }
+        ancestors_.resize((size_t)level_count_ * node_count_);
+        lightest_.resize((size_t)level_count_ * node_count_);
+        for(int i = 0; i < node_count_; i++){
+            /* The root is its own ancestor, through an edge that never is the lightest */
+            ancestors_[i] = parent_[i] != INVALID_PARENT ? parent_[i] : i;
+            lightest_[i] = parent_[i] != INVALID_PARENT ? weight_[i] : std::numeric_limits<flowType>::max();
+        }
+        for(int level = 1; level < level_count_; level++){
+            const int* below = &ancestors_[(size_t)(level - 1) * node_count_];
+            const flowType* below_lightest = &lightest_[(size_t)(level - 1) * node_count_];
+            for(int i = 0; i < node_count_; i++){
+                ancestors_[(size_t)level * node_count_ + i] = below[below[i]];
+                lightest_[(size_t)level * node_count_ + i] = std::min(below_lightest[i], below_lightest[below[i]]);
+            }
+        }
+    }
+
+    int node_count_;
+    int level_count_; /* Levels of the lifting tables, 2^(level_count_ - 1) < V or 1 */
+    std::vector<int> parent_; /* Tree parent of each node, INVALID_PARENT for node 0 */
+    std::vector<flowType> weight_; /* Capacity of the edge to the parent */
+    std::vector<int> depth_; /* Tree edges between each node and the root */
+    std::vector<int> ancestors_; /* 2^k-th ancestor of node v at k * V + v */
+    std::vector<flowType> lightest_; /* Lightest edge between v and that ancestor at k * V + v */
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef GRAPH_BUILDER_H
+#define GRAPH_BUILDER_H
+
+#include<vector>
+
+#include "residual_graph.h"
+#include "scratch_arena.h"
+
+#define GRAPH_BUILDER_CHUNK_EDGES 4096 /* Edges per chunk of the edge buffer */
+
+/*
+ * @brief    Collects the edges of a residual graph and builds its CSR arrays
+ *          into an existing graph, for programs that build many graphs one
+ *          after another.
+ *
+ *          The edges are appended to fixed size chunks carved out of a
+ *          scratch arena, so adding an edge never moves the edges already
+ *          added. finalize() places them with one counting sort pass over the
+ *          per node edge counts, O(V + E), the same layout the graph's own
+ *          addEdge() and finalize() give. reset() hands the chunks back to
+ *          the arena, which keeps one block big enough for the largest
+ *          instance, and the graph keeps its buffers too, so once the largest
+ *          instance has been built the builder and the graph stop allocating.
+ *
+ *          A builder is not thread safe, every thread needs its own.
+ */
+template<class Capacity = residualCapacityStorage>
+class residualGraphBuilder{
+public:
+    typedef typename capacityValue<Capacity>::type capacityType;
+
+    residualGraphBuilder() : node_count_(0), source_(0), sink_(0), edge_count_(0){
+    }
+
+    /* Start a new graph, dropping the edges of the previous one. */
+    void reset(int node_count, int source, int sink){
+        chunks_.clear();
+        arena_.release(0);
+        node_count_ = node_count;
+        source_ = source;
+        sink_ = sink;
+        edge_count_ = 0;
+        degrees_.assign(node_count, 0);
+    }
+
+    /*
+     * @brief   Queue an edge from -> to, its back edge is added by finalize().
+     *
+     * @return  False, leaving the edge out, if the capacity is negative or does not fit Capacity
+     */
+    bool addEdge(int from, int to, capacityType capacity){
+        if(!fitsCapacityStorage<Capacity>(capacity)){
+            std::cerr<<"The capacity of the edge "<<from<<" -> "<<to<<" does not fit the capacity type\n";
+            return false;
+        }
+        const int slot = edge_count_ % GRAPH_BUILDER_CHUNK_EDGES;
+        if(slot == 0){
+            chunks_.push_back(arena_.allocate<pendingEdge>(GRAPH_BUILDER_CHUNK_EDGES));
+        }
+        pendingEdge& edge = chunks_.back()[slot];
+        edge.from = from;
+        edge.to = to;
+        edge.capacity = capacity;
+        edge_count_++;
+        degrees_[from]++;
+        degrees_[to]++;
+        return true;
+    }
+
+    /* Number of addEdge() calls since the last reset() */
+    int getEdgeCount(){return edge_count_;}
+
+    /*
+     * @brief   Replace the contents of graph with the nodes and edges added
+     *          since the last reset(). The builder keeps its edges, so the
+     *          same graph can be built again.
+     */
+    void finalize(residualGraph<DYNAMIC_NODE_COUNT, Capacity>& graph){
+        graph.reset(node_count_, source_, sink_);
+        graph.allocateEdges(degrees_);
+        next_slot_.resize(node_count_);
+        for(int i = 0; i < node_count_; i++){
+            next_slot_[i] = graph.getFirstEdge(i);
+        }
+        for(int i = 0; i < edge_count_; i++){
+            const pendingEdge& edge = chunks_[i / GRAPH_BUILDER_CHUNK_EDGES][i % GRAPH_BUILDER_CHUNK_EDGES];
+            graph.setEdgePair(next_slot_[edge.from]++, next_slot_[edge.to]++, edge.from, edge.to, edge.capacity);
+        }
+    }
+private:
+    residualGraphBuilder(const residualGraphBuilder&);
+    residualGraphBuilder& operator=(const residualGraphBuilder&);
+
+    struct pendingEdge{
+        int from;
+        int to;
+        capacityType capacity;
+    };
+
+    int node_count_;
+    int source_;
+    int sink_;
+    int edge_count_; /* Edges added since the last reset() */
+    scratchArena arena_; /* Holds the chunks */
+    std::vector<pendingEdge*> chunks_; /* GRAPH_BUILDER_CHUNK_EDGES edges each, the last one filling up */
+    std::vector<int32_t> degrees_; /* Edges of each node, back edges included */
+    std::vector<int32_t> next_slot_; /* Next free edge index of each node while finalizing */
+};
+
+#endif
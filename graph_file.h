@@ -0,0 +1,366 @@
+#ifndef GRAPH_FILE_H
+#define GRAPH_FILE_H
+
+#include<cstdio>
+#include<cstring>
+#include<cstdint>
+#include<iostream>
+#include<string>
+#include<vector>
+
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+#include "residual_graph.h"
+
+#define GRAPH_FILE_MAGIC "MFGRAPH" /* First 8 bytes of a graph file, including the terminating NUL */
+#define GRAPH_FILE_VERSION 1
+#define GRAPH_FILE_ALIGNMENT 4096 /* Every section starts on a page boundary */
+#define GRAPH_FILE_WRITE_CHUNK 65536 /* Values buffered per fwrite() */
+
+/*
+ * Binary graph file layout. All values are in the byte order of the machine
+ * that wrote the file. The header is followed by five sections, each
+ * starting at a multiple of GRAPH_FILE_ALIGNMENT:
+ *
+ *  offsets   node_count + 1 int32: the edges of node u are [offsets[u], offsets[u + 1])
+ *  heads     edge_count int32: node each edge points to
+ *  reverses  edge_count int32: index of the paired back edge of each edge
+ *  residual  edge_count capacity values: residual capacity of each edge
+ *  original  edge_count capacity values: input capacity of each edge, 0 for back edges
+ *
+ * This is the edge layout of residualGraph<>, so a file can be used in place
+ * without any parsing. The capacity values are residualCapacityStorage of
+ * the writer, capacity_bytes records its size.
+ */
+struct graphFileHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity_bytes;
+    int32_t node_count;
+    int32_t edge_count;
+    int32_t source;
+    int32_t sink;
+    uint64_t offsets_offset; /* Byte offsets of the sections from the start of the file */
+    uint64_t heads_offset;
+    uint64_t reverses_offset;
+    uint64_t residual_offset;
+    uint64_t original_offset;
+    uint64_t file_size;
+};
+
+inline uint64_t graphFileAlign(uint64_t offset){
+    return (offset + GRAPH_FILE_ALIGNMENT - 1) / GRAPH_FILE_ALIGNMENT * GRAPH_FILE_ALIGNMENT;
+}
+
+/* Pad the file with zeros up to offset. */
+inline bool graphFilePad(FILE* file, uint64_t offset){
+    static const char zeros[GRAPH_FILE_ALIGNMENT] = {0};
+    long position = ftell(file);
+    if(position < 0 || (uint64_t)position > offset){
+        return false;
+    }
+    return fwrite(zeros, 1, offset - position, file) == offset - position;
+}
+
+/*
+ * Stream one section of count values to the file through a fixed buffer,
+ * value(i) gives the i-th value.
+ */
+template<class T, class Value>
+bool graphFileWriteSection(FILE* file, uint64_t offset, int count, Value value){
+    if(!graphFilePad(file, offset)){
+        return false;
+    }
+    std::vector<T> buffer(count < GRAPH_FILE_WRITE_CHUNK ? count : GRAPH_FILE_WRITE_CHUNK);
+    for(int first = 0; first < count; first += GRAPH_FILE_WRITE_CHUNK){
+        int chunk = count - first < GRAPH_FILE_WRITE_CHUNK ? count - first : GRAPH_FILE_WRITE_CHUNK;
+        for(int i = 0; i < chunk; i++){
+            buffer[i] = (T)value(first + i);
+        }
+        if(fwrite(buffer.data(), sizeof(T), chunk, file) != (size_t)chunk){
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * @brief   Write a residual graph to a binary graph file, current residual
+ *          capacities included, so a partly solved graph can be saved too.
+ *          The edges are streamed section by section, the graph is never
+ *          copied as a whole.
+ *
+ * @param[in] graph  Any graph with the residual graph interface whose edge
+ *                   ids of node u are [getFirstEdge(u), getLastEdge(u)) and
+ *                   run from 0 to getEdgeCount() in node order
+ * @param[in] path   File to create or overwrite
+ *
+ * @return  True if the whole file was written
+ */
+template<class Graph>
+bool writeGraphFile(Graph& graph, const char* path){
+    static_assert(std::is_same<typename Graph::capacityStorage, residualCapacityStorage>::value,
+        "Graph files hold the default capacity storage type");
+    const int node_count = graph.getNodeCount();
+    const int edge_count = graph.getEdgeCount();
+    graphFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic));
+    header.version = GRAPH_FILE_VERSION;
+    header.capacity_bytes = sizeof(residualCapacityStorage);
+    header.node_count = node_count;
+    header.edge_count = edge_count;
+    header.source = graph.getSource();
+    header.sink = graph.getSink();
+    header.offsets_offset = graphFileAlign(sizeof(header));
+    header.heads_offset = graphFileAlign(header.offsets_offset + sizeof(int32_t) * ((uint64_t)node_count + 1));
+    header.reverses_offset = graphFileAlign(header.heads_offset + sizeof(int32_t) * (uint64_t)edge_count);
+    header.residual_offset = graphFileAlign(header.reverses_offset + sizeof(int32_t) * (uint64_t)edge_count);
+    header.original_offset = graphFileAlign(header.residual_offset + sizeof(residualCapacityStorage) * (uint64_t)edge_count);
+    header.file_size = header.original_offset + sizeof(residualCapacityStorage) * (uint64_t)edge_count;
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL){
+        std::cerr<<"Failed to create the graph file "<<path<<"\n";
+        return false;
+    }
+    bool written = fwrite(&header, sizeof(header), 1, file) == 1
+        && graphFileWriteSection<int32_t>(file, header.offsets_offset, node_count + 1, [&](int node_id){
+            return node_id < node_count ? graph.getFirstEdge(node_id) : edge_count;
+        })
+        && graphFileWriteSection<int32_t>(file, header.heads_offset, edge_count, [&](int edge_id){
+            return graph.getHead(edge_id);
+        })
+        && graphFileWriteSection<int32_t>(file, header.reverses_offset, edge_count, [&](int edge_id){
+            return graph.getReverse(edge_id);
+        })
+        && graphFileWriteSection<residualCapacityStorage>(file, header.residual_offset, edge_count, [&](int edge_id){
+            return graph.getResidualCapacity(edge_id);
+        })
+        && graphFileWriteSection<residualCapacityStorage>(file, header.original_offset, edge_count, [&](int edge_id){
+            return graph.getOriginalCapacity(edge_id);
+        });
+    if(fclose(file) != 0){
+        written = false;
+    }
+    if(!written){
+        std::cerr<<"Failed to write the graph file "<<path<<"\n";
+    }
+    return written;
+}
+
+/* True if the file starts like a graph file written by writeGraphFile(). */
+inline bool isGraphFile(const char* path){
+    char magic[8];
+    FILE* file = fopen(path, "rb");
+    if(file == NULL){
+        return false;
+    }
+    bool matches = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && memcmp(magic, GRAPH_FILE_MAGIC, sizeof(magic)) == 0;
+    fclose(file);
+    return matches;
+}
+
+/* True if the header is that of a graph file of file_size bytes: sections aligned, in order and inside the file. */
+inline bool checkGraphFileHeader(const graphFileHeader& header, uint64_t file_size){
+    if(memcmp(header.magic, GRAPH_FILE_MAGIC, sizeof(header.magic)) != 0
+            || header.version != GRAPH_FILE_VERSION
+            || header.capacity_bytes != sizeof(residualCapacityStorage)
+            || header.node_count < 0 || header.edge_count < 0
+            || (header.node_count > 0 && (header.source < 0 || header.source >= header.node_count
+                || header.sink < 0 || header.sink >= header.node_count))
+            || header.file_size > file_size){
+        return false;
+    }
+    const uint64_t sections[5] = {header.offsets_offset, header.heads_offset, header.reverses_offset,
+        header.residual_offset, header.original_offset};
+    const uint64_t sizes[5] = {
+        sizeof(int32_t) * ((uint64_t)header.node_count + 1),
+        sizeof(int32_t) * (uint64_t)header.edge_count,
+        sizeof(int32_t) * (uint64_t)header.edge_count,
+        sizeof(residualCapacityStorage) * (uint64_t)header.edge_count,
+        sizeof(residualCapacityStorage) * (uint64_t)header.edge_count
+    };
+    uint64_t end = sizeof(graphFileHeader);
+    for(int i = 0; i < 5; i++){
+        if(sections[i] % GRAPH_FILE_ALIGNMENT != 0 || sections[i] < end || sections[i] + sizes[i] > header.file_size){
+            return false;
+        }
+        end = sections[i] + sizes[i];
+    }
+    return true;
+}
+
+/*
+ * @brief    Residual graph that runs directly on a memory mapped graph file.
+ *
+ *          open() maps the file and checks its header, nothing else is read,
+ *          so a graph of any size is ready at once and its pages are only
+ *          loaded as the solver touches them. The mapping is private: the
+ *          offset, head and back edge arrays are mapped read only and stay
+ *          shared with the page cache, and the capacity arrays are copy on
+ *          write, so a solve copies only the pages of the residual
+ *          capacities it changes and the file itself is never modified.
+ *          Use writeGraphFile() to save the solved state.
+ *
+ *          Only the header and the node and edge counts of the offsets are
+ *          checked; the heads and back edges are trusted to be those of a
+ *          residual graph, as written by writeGraphFile().
+ */
+class mappedResidualGraph{
+public:
+    static const int STATIC_NODE_COUNT = DYNAMIC_NODE_COUNT;
+    typedef residualCapacityStorage capacityStorage;
+    typedef capacityValue<residualCapacityStorage>::type capacityType;
+    typedef flowValue<residualCapacityStorage>::type flowType;
+
+    mappedResidualGraph() :
+        mapping_(NULL),
+        mapping_size_(0),
+        node_count_(0),
+        edge_count_(0),
+        source_(0),
+        sink_(0),
+        offsets_(NULL),
+        heads_(NULL),
+        reverses_(NULL),
+        residual_capacities_(NULL),
+        original_capacities_(NULL)
+    {
+    }
+
+    ~mappedResidualGraph(){close();}
+
+    /*
+     * @brief   Map a graph file written by writeGraphFile(). A graph that is
+     *          already open is closed first.
+     *
+     * @return  True if the file is a valid graph file and was mapped
+     */
+    bool open(const char* path){
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if(fd < 0){
+            std::cerr<<"Failed to open the graph file "<<path<<"\n";
+            return false;
+        }
+        struct stat file_stat;
+        if(fstat(fd, &file_stat) != 0 || (uint64_t)file_stat.st_size < sizeof(graphFileHeader)){
+            std::cerr<<"The graph file "<<path<<" is too short\n";
+            ::close(fd);
+            return false;
+        }
+        void* mapping = mmap(NULL, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(mapping == MAP_FAILED){
+            std::cerr<<"Failed to map the graph file "<<path<<"\n";
+            return false;
+        }
+        mapping_ = static_cast<char*>(mapping);
+        mapping_size_ = file_stat.st_size;
+
+        graphFileHeader header;
+        memcpy(&header, mapping_, sizeof(header));
+        if(!checkGraphFileHeader(header, mapping_size_)){
+            std::cerr<<"The graph file "<<path<<" is invalid or was written with another capacity type\n";
+            close();
+            return false;
+        }
+        node_count_ = header.node_count;
+        edge_count_ = header.edge_count;
+        source_ = header.source;
+        sink_ = header.sink;
+        offsets_ = reinterpret_cast<const int32_t*>(mapping_ + header.offsets_offset);
+        heads_ = reinterpret_cast<const int32_t*>(mapping_ + header.heads_offset);
+        reverses_ = reinterpret_cast<const int32_t*>(mapping_ + header.reverses_offset);
+        residual_capacities_ = reinterpret_cast<residualCapacityStorage*>(mapping_ + header.residual_offset);
+        original_capacities_ = reinterpret_cast<residualCapacityStorage*>(mapping_ + header.original_offset);
+        if(offsets_[0] != 0 || offsets_[node_count_] != edge_count_){
+            std::cerr<<"The graph file "<<path<<" has inconsistent edge offsets\n";
+            close();
+            return false;
+        }
+        /* The topology is never written, keep it out of the copy on write path */
+        mprotect(mapping_ + header.offsets_offset, header.residual_offset - header.offsets_offset, PROT_READ);
+        return true;
+    }
+
+    /* Unmap the file, the changes made to the capacities are dropped. */
+    void close(){
+        if(mapping_ != NULL){
+            munmap(mapping_, mapping_size_);
+        }
+        mapping_ = NULL;
+        mapping_size_ = 0;
+        node_count_ = 0;
+        edge_count_ = 0;
+        offsets_ = NULL;
+        heads_ = NULL;
+        reverses_ = NULL;
+        residual_capacities_ = NULL;
+        original_capacities_ = NULL;
+        std::vector<std::string>().swap(node_names_);
+    }
+
+    bool isOpen(){return mapping_ != NULL;}
+
+    int getNodeCount(){return node_count_;}
+    int getEdgeCount(){return edge_count_;}
+    int getSource(){return source_;}
+    int getSink(){return sink_;}
+    int getFirstEdge(int node_id){return offsets_[node_id];}
+    int getLastEdge(int node_id){return offsets_[node_id + 1];}
+
+    int getHead(int edge_id){return heads_[edge_id];}
+    int getReverse(int edge_id){return reverses_[edge_id];}
+    int getResidualCapacity(int edge_id){return residual_capacities_[edge_id];}
+    void setResidualCapacity(int edge_id, int residual_capacity){residual_capacities_[edge_id] = residual_capacity;}
+    int getOriginalCapacity(int edge_id){return original_capacities_[edge_id];}
+    void setOriginalCapacity(int edge_id, int original_capacity){original_capacities_[edge_id] = original_capacity;}
+    /* Atomic access for the parallel engines. The fetch variant returns the previous value. */
+    int loadResidualCapacity(int edge_id){return __atomic_load_n(&residual_capacities_[edge_id], __ATOMIC_RELAXED);}
+    int fetchAddResidualCapacity(int edge_id, int delta){
+        return __atomic_fetch_add(&residual_capacities_[edge_id], (residualCapacityStorage)delta, __ATOMIC_RELAXED);
+    }
+    /* Residual capacities of all edges by id, for the vector scans. */
+    const residualCapacityStorage* getResidualCapacities(){return residual_capacities_;}
+    /* Overwrite every residual capacity, getEdgeCount() values by edge id, see residualSnapshot. */
+    void setResidualCapacities(const residualCapacityStorage* residual_capacities){
+        memcpy(residual_capacities_, residual_capacities, (size_t)edge_count_ * sizeof(residualCapacityStorage));
+    }
+
+    /* Names are optional and are not part of the file. */
+    void setNodeName(int node_id, const char* name){
+        if(node_names_.empty()){
+            node_names_.resize(node_count_);
+        }
+        node_names_[node_id] = name;
+    }
+    std::string getNodeName(int node_id){
+        if(node_names_.empty() || node_names_[node_id].empty()){
+            return std::to_string(node_id);
+        }
+        return node_names_[node_id];
+    }
+private:
+    mappedResidualGraph(const mappedResidualGraph&);
+    mappedResidualGraph& operator=(const mappedResidualGraph&);
+
+    char* mapping_; /* Start of the private mapping of the whole file */
+    size_t mapping_size_;
+    int node_count_; /* Number of nodes in the graph */
+    int edge_count_; /* Number of edges, back edges included */
+    int source_; /* Id of the source node */
+    int sink_; /* Id of the target node */
+    const int32_t* offsets_; /* Per node start offset into the edge arrays, node_count_ + 1 entries */
+    const int32_t* heads_; /* Node each edge points to, edges grouped by tail node */
+    const int32_t* reverses_; /* Index of the paired back edge of each edge */
+    residualCapacityStorage* residual_capacities_; /* Residual capacity of each edge, copy on write */
+    residualCapacityStorage* original_capacities_; /* Input capacity of each edge, copy on write */
+    std::vector<std::string> node_names_; /* Optional printable names */
+};
+
+#endif
@@ -0,0 +1,253 @@
+#ifndef GRAPH_GENERATORS_H
+#define GRAPH_GENERATORS_H
+
+#include<vector>
+#include<random>
+#include<algorithm>
+
+#include "residual_graph.h"
+
+/*
+ * Generators for the usual synthetic max flow families. Every generator
+ * returns a finalized residual graph allocated with new, the same seed
+ * giving the same graph.
+ */
+
+/*
+ * @brief   Build a random layered network: the source feeds every node of the
+ *          first layer, every node has edges to random nodes of the next
+ *          layer and the last layer drains into the target.
+ *
+ * @param [in]  layers      Number of layers between the source and the target
+ *                          (at least 1)
+ * @param [in]  width       Nodes per layer
+ * @param [in]  degree      Edges from each node to the next layer
+ * @param [in]  seed        Seed of the random generator
+ *
+ * @return  Returns the residual graph, the source is node 0 and the target the
+ *          last node
+ */
+inline residualGraph<>* buildLayeredGraph(int layers, int width, int degree, unsigned seed){
+    const int node_count = layers * width + 2;
+    const int sink = node_count - 1;
+    residualGraph<>* graph = new residualGraph<>(node_count, 0, sink, 2 * width + (layers - 1) * width * degree);
+    std::mt19937 random(seed);
+    for(int i = 0; i < width; i++){
+        graph->addEdge(0, 1 + i, 1000);
+        graph->addEdge(1 + (layers - 1) * width + i, sink, 1000);
+    }
+    for(int layer = 0; layer + 1 < layers; layer++){
+        for(int i = 0; i < width; i++){
+            for(int k = 0; k < degree; k++){
+                graph->addEdge(1 + layer * width + i, 1 + (layer + 1) * width + (int)(random() % width), 1 + (int)(random() % 100));
+            }
+        }
+    }
+    graph->finalize();
+    return graph;
+}
+
+/*
+ * @brief   Build a network in the spirit of the AK generator of Cherkassky and
+ *          Goldberg, which is hard for both augmenting paths and push-relabel.
+ *          It has two modules of k + 1 nodes each. In the first, a path from
+ *          the source leaks one unit into the target at every node and its
+ *          capacities shrink by one per step, so the flow has to be pushed
+ *          along the whole path a unit at a time. In the second, a path of
+ *          capacity k leaks one unit per node into a hub in front of the
+ *          target. The maximum flow is 2k + 2.
+ *
+ * @param [in]  k   Length of the two paths (at least 1)
+ *
+ * @return  Returns the residual graph with 2k + 5 nodes, the source is node 0
+ *          and the target the last node
+ */
+inline residualGraph<>* buildAkGraph(int k){
+    const int node_count = 2 * k + 5;
+    const int sink = node_count - 1;
+    const int hub = sink - 1;
+    const int first_path = 1;
+    const int second_path = first_path + k + 1;
+    residualGraph<>* graph = new residualGraph<>(node_count, 0, sink, 4 * k + 5);
+    graph->addEdge(0, first_path, k + 1);
+    graph->addEdge(0, second_path, k + 1);
+    for(int i = 0; i <= k; i++){
+        if(i < k){
+            graph->addEdge(first_path + i, first_path + i + 1, k - i);
+            graph->addEdge(second_path + i, second_path + i + 1, k);
+        }
+        graph->addEdge(first_path + i, sink, 1);
+        graph->addEdge(second_path + i, hub, 1);
+    }
+    graph->addEdge(hub, sink, k + 1);
+    graph->finalize();
+    return graph;
+}
+
+/*
+ * @brief   Build a Washington RMF network (Goldfarb and Grigoriadis): frames
+ *          of a x a grids, with edges of capacity a * a between grid
+ *          neighbours. Each node of a frame has one edge to the node at a
+ *          random permutation of the next frame, with a random capacity.
+ *
+ * @param [in]  a               Side of a frame (at least 1)
+ * @param [in]  frames          Number of frames (at least 1)
+ * @param [in]  max_capacity    Largest capacity between frames
+ * @param [in]  seed            Seed of the random generator
+ *
+ * @return  Returns the residual graph with a * a * frames nodes, the source is
+ *          the first node of the first frame and the target the last node of
+ *          the last frame
+ */
+inline residualGraph<>* buildRmfGraph(int a, int frames, int max_capacity, unsigned seed){
+    const int frame_size = a * a;
+    const int node_count = frame_size * frames;
+    residualGraph<>* graph = new residualGraph<>(node_count, 0, node_count - 1,
+            frames * 4 * a * (a - 1) + (frames - 1) * frame_size);
+    std::mt19937 random(seed);
+    std::vector<int> permutation(frame_size);
+    for(int frame = 0; frame < frames; frame++){
+        const int base = frame * frame_size;
+        for(int row = 0; row < a; row++){
+            for(int column = 0; column < a; column++){
+                const int node_id = base + row * a + column;
+                if(column + 1 < a){
+                    graph->addEdge(node_id, node_id + 1, frame_size);
+                    graph->addEdge(node_id + 1, node_id, frame_size);
+                }
+                if(row + 1 < a){
+                    graph->addEdge(node_id, node_id + a, frame_size);
+                    graph->addEdge(node_id + a, node_id, frame_size);
+                }
+            }
+        }
+        if(frame + 1 < frames){
+            for(int i = 0; i < frame_size; i++){
+                permutation[i] = i;
+            }
+            std::shuffle(permutation.begin(), permutation.end(), random);
+            for(int i = 0; i < frame_size; i++){
+                graph->addEdge(base + i, base + frame_size + permutation[i], 1 + (int)(random() % max_capacity));
+            }
+        }
+    }
+    graph->finalize();
+    return graph;
+}
+
+/*
+ * @brief   Build a Washington grid network: a rows x columns grid where every
+ *          node has edges to its right, upper and lower neighbours with random
+ *          capacities. The source feeds the first column and the last column
+ *          drains into the target.
+ *
+ * @param [in]  rows            Rows of the grid (at least 1)
+ * @param [in]  columns         Columns of the grid (at least 1)
+ * @param [in]  max_capacity    Largest capacity of a grid edge
+ * @param [in]  seed            Seed of the random generator
+ *
+ * @return  Returns the residual graph, the source is node 0 and the target the
+ *          last node
+ */
+inline residualGraph<>* buildWashingtonGrid(int rows, int columns, int max_capacity, unsigned seed){
+    const int node_count = rows * columns + 2;
+    const int sink = node_count - 1;
+    residualGraph<>* graph = new residualGraph<>(node_count, 0, sink,
+            2 * rows + rows * (columns - 1) + 2 * (rows - 1) * columns);
+    std::mt19937 random(seed);
+    for(int row = 0; row < rows; row++){
+        graph->addEdge(0, 1 + row * columns, max_capacity * 4);
+        graph->addEdge(1 + row * columns + columns - 1, sink, max_capacity * 4);
+        for(int column = 0; column < columns; column++){
+            const int node_id = 1 + row * columns + column;
+            if(column + 1 < columns){
+                graph->addEdge(node_id, node_id + 1, 1 + (int)(random() % max_capacity));
+            }
+            if(row > 0){
+                graph->addEdge(node_id, node_id - columns, 1 + (int)(random() % max_capacity));
+            }
+            if(row + 1 < rows){
+                graph->addEdge(node_id, node_id + columns, 1 + (int)(random() % max_capacity));
+            }
+        }
+    }
+    graph->finalize();
+    return graph;
+}
+
+/*
+ * @brief   Build a bipartite matching network with unit capacities: the source
+ *          feeds every left node, each left node has edges to random right
+ *          nodes and every right node drains into the target. The maximum flow
+ *          is the size of a maximum matching.
+ *
+ * @param [in]  left_count      Nodes on the left
+ * @param [in]  right_count     Nodes on the right (at least 1)
+ * @param [in]  degree          Edges from each left node
+ * @param [in]  seed            Seed of the random generator
+ *
+ * @return  Returns the residual graph, the source is node 0, then the left and
+ *          the right nodes, and the target the last node
+ */
+inline residualGraph<>* buildBipartiteGraph(int left_count, int right_count, int degree, unsigned seed){
+    const int node_count = left_count + right_count + 2;
+    const int sink = node_count - 1;
+    residualGraph<>* graph = new residualGraph<>(node_count, 0, sink, left_count * (degree + 1) + right_count);
+    std::mt19937 random(seed);
+    for(int i = 0; i < left_count; i++){
+        graph->addEdge(0, 1 + i, 1);
+        for(int k = 0; k < degree; k++){
+            graph->addEdge(1 + i, 1 + left_count + (int)(random() % right_count), 1);
+        }
+    }
+    for(int i = 0; i < right_count; i++){
+        graph->addEdge(1 + left_count + i, sink, 1);
+    }
+    graph->finalize();
+    return graph;
+}
+
+/*
+ * @brief   Build a network with a power law degree distribution by
+ *          preferential attachment (Barabasi-Albert). The first nodes form a
+ *          ring, then every new node links to degree existing nodes picked in
+ *          proportion to their degree. Each link is an edge in both
+ *          directions, with random capacities.
+ *
+ * @param [in]  node_count      Nodes of the graph (more than degree)
+ * @param [in]  degree          Links of every new node (at least 1)
+ * @param [in]  max_capacity    Largest capacity of an edge
+ * @param [in]  seed            Seed of the random generator
+ *
+ * @return  Returns the residual graph, the source is node 0, one of the hubs,
+ *          and the target the last node, one of the leaves
+ */
+inline residualGraph<>* buildPowerLawGraph(int node_count, int degree, int max_capacity, unsigned seed){
+    residualGraph<>* graph = new residualGraph<>(node_count, 0, node_count - 1, 2 * node_count * degree);
+    std::mt19937 random(seed);
+    /* Every node appears once per link it has, so a uniform pick is a pick by degree */
+    std::vector<int> endpoints;
+    endpoints.reserve(2 * node_count * degree);
+    for(int i = 0; i <= degree; i++){
+        const int next_node = i < degree ? i + 1 : 0;
+        graph->addEdge(i, next_node, 1 + (int)(random() % max_capacity));
+        graph->addEdge(next_node, i, 1 + (int)(random() % max_capacity));
+        endpoints.push_back(i);
+        endpoints.push_back(next_node);
+    }
+    for(int node_id = degree + 1; node_id < node_count; node_id++){
+        for(int k = 0; k < degree; k++){
+            const int target = endpoints[random() % endpoints.size()];
+            graph->addEdge(node_id, target, 1 + (int)(random() % max_capacity));
+            graph->addEdge(target, node_id, 1 + (int)(random() % max_capacity));
+            endpoints.push_back(target);
+        }
+        for(int k = 0; k < degree; k++){
+            endpoints.push_back(node_id);
+        }
+    }
+    graph->finalize();
+    return graph;
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef GRAPH_MEMORY_H
+#define GRAPH_MEMORY_H
+
+#include<cstddef>
+#include<cstdint>
+#include<new>
+
+#ifdef __linux__
+#include<sys/mman.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+#define GRAPH_MEMORY_LINUX
+#endif
+
+/*
+ * Placement of the large edge arrays of the graphs. Arrays of at least
+ * GRAPH_HUGE_PAGE_THRESHOLD bytes are mapped on their own, aligned to 2 MB,
+ * so the kernel can back them with huge pages; a search walking 100M edges
+ * then needs a TLB entry per 2 MB instead of per 4 kB. Smaller arrays come
+ * from operator new as before. On other systems than Linux everything does.
+ */
+
+#define GRAPH_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define GRAPH_HUGE_PAGE_THRESHOLD GRAPH_HUGE_PAGE_SIZE /* Smallest array mapped with huge pages */
+
+/* Flags of setGraphMemoryPolicy(), or-ed together */
+#define GRAPH_MEMORY_DEFAULT 0 /* Transparent huge pages through madvise */
+#define GRAPH_MEMORY_HUGETLB 1 /* Reserved hugetlbfs pages first, transparent ones if none are left */
+#define GRAPH_MEMORY_INTERLEAVE 2 /* Spread the pages over every NUMA node, for the parallel engines */
+#define GRAPH_MEMORY_SMALL_PAGES 4 /* No huge pages at all */
+
+/* Policy of the graph arrays allocated from now on, process wide */
+inline int& graphMemoryPolicy(){
+    static int policy = GRAPH_MEMORY_DEFAULT;
+    return policy;
+}
+
+/*
+ * @brief   Choose how the edge arrays of graphs built from now on are placed.
+ *          Graphs built before keep their memory. Not thread safe, set it
+ *          before building graphs.
+ *
+ * @param[in] policy    GRAPH_MEMORY_* flags
+ */
+inline void setGraphMemoryPolicy(int policy){
+    graphMemoryPolicy() = policy;
+}
+
+#ifdef GRAPH_MEMORY_LINUX
+/* Bytes actually mapped for an array, whole huge pages */
+inline size_t getGraphMappingSize(size_t bytes){
+    return (bytes + GRAPH_HUGE_PAGE_SIZE - 1) / GRAPH_HUGE_PAGE_SIZE * GRAPH_HUGE_PAGE_SIZE;
+}
+
+/*
+ * @brief   Map an array of memory that is aligned to a huge page and apply the
+ *          current policy to it. The hints are best effort: without huge
+ *          pages or NUMA support the memory is plain anonymous memory.
+ *
+ * @return  Returns the memory, NULL if it could not be mapped
+ */
+inline void* mapGraphArray(size_t bytes){
+    const int policy = graphMemoryPolicy();
+    const size_t size = getGraphMappingSize(bytes);
+    void* memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if((policy & GRAPH_MEMORY_HUGETLB) != 0){
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+#endif
+    if(memory == MAP_FAILED){
+        /* Map a huge page more than needed and trim it to an aligned range */
+        char* mapping = (char*)mmap(NULL, size + GRAPH_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(mapping == (char*)MAP_FAILED){
+            return NULL;
+        }
+        char* aligned = (char*)(((uintptr_t)mapping + GRAPH_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(GRAPH_HUGE_PAGE_SIZE - 1));
+        if(aligned != mapping){
+            munmap(mapping, aligned - mapping);
+        }
+        if(aligned + size != mapping + size + GRAPH_HUGE_PAGE_SIZE){
+            munmap(aligned + size, mapping + size + GRAPH_HUGE_PAGE_SIZE - (aligned + size));
+        }
+        memory = aligned;
+#ifdef MADV_HUGEPAGE
+        if((policy & GRAPH_MEMORY_SMALL_PAGES) == 0){
+            madvise(memory, size, MADV_HUGEPAGE);
+        }
+#endif
+    }
+#ifdef SYS_mbind
+    if((policy & GRAPH_MEMORY_INTERLEAVE) != 0){
+        /* MPOL_INTERLEAVE over every node, the kernel leaves out the nodes without memory */
+        const int interleave = 3;
+        unsigned long nodes[16];
+        for(int i = 0; i < 16; i++){
+            nodes[i] = ~0UL;
+        }
+        syscall(SYS_mbind, memory, size, interleave, nodes, (unsigned long)(sizeof(nodes) * 8), 0UL);
+    }
+#endif
+    return memory;
+}
+#endif
+
+/*
+ * @brief    Allocator of the graph edge arrays, see the top of this file.
+ *          It has no state, so any two compare equal and vectors using it
+ *          copy and swap like with std::allocator.
+ */
+template<class T>
+class graphArrayAllocator{
+public:
+    typedef T value_type;
+
+    graphArrayAllocator(){}
+    template<class U>
+    graphArrayAllocator(const graphArrayAllocator<U>&){}
+
+    T* allocate(size_t count){
+#ifdef GRAPH_MEMORY_LINUX
+        if(count * sizeof(T) >= GRAPH_HUGE_PAGE_THRESHOLD){
+            void* memory = mapGraphArray(count * sizeof(T));
+            if(memory == NULL){
+                throw std::bad_alloc();
+            }
+            return (T*)memory;
+        }
+#endif
+        return (T*)::operator new(count * sizeof(T));
+    }
+
+    void deallocate(T* memory, size_t count){
+#ifdef GRAPH_MEMORY_LINUX
+        if(count * sizeof(T) >= GRAPH_HUGE_PAGE_THRESHOLD){
+            munmap(memory, getGraphMappingSize(count * sizeof(T)));
+            return;
+        }
+#endif
+        ::operator delete(memory);
+    }
+};
+
+template<class T, class U>
+bool operator==(const graphArrayAllocator<T>&, const graphArrayAllocator<U>&){return true;}
+template<class T, class U>
+bool operator!=(const graphArrayAllocator<T>&, const graphArrayAllocator<U>&){return false;}
+
+#endif
@@ -0,0 +1,539 @@
+#ifndef GRAPH_PREPROCESSING_H
+#define GRAPH_PREPROCESSING_H
+
+#include<algorithm>
+#include<utility>
+#include<vector>
+
+#include "max_flow.h"
+
+/* Node orders maxFlowPreprocessor can number the reduced graph in */
+#define PREPROCESS_ORDER_INPUT 0 /* Keep the order of the input ids */
+#define PREPROCESS_ORDER_BFS 1 /* Breadth first from the source */
+#define PREPROCESS_ORDER_RCM 2 /* Reverse Cuthill-McKee from the source */
+#define PREPROCESS_ORDER_DEGREE 3 /* By decreasing degree, the hubs first */
+#define PREPROCESS_ORDER_HILBERT 4 /* Along a Hilbert curve through the grid set with setGridShape() */
+
+/* Reductions maxFlowPreprocessor applies, or-ed together */
+#define PREPROCESS_REDUCE_NONE 0 /* Only renumber the nodes */
+#define PREPROCESS_PRUNE 1
+#define PREPROCESS_MERGE 2
+#define PREPROCESS_CONTRACT 4
+#define PREPROCESS_REDUCE_ALL (PREPROCESS_PRUNE | PREPROCESS_MERGE | PREPROCESS_CONTRACT)
+
+/*
+ * @brief    Reduces a flow network to a smaller one with the same maximum
+ *          flow before it is solved, and maps the flow found back to the
+ *          input graph.
+ *
+ *          The input edges with capacity are taken as arcs and reduced in
+ *          rounds until nothing changes:
+ *
+ *          - Pruning drops the nodes the source can not reach and the nodes
+ *            that can not reach the target, with their arcs.
+ *          - Parallel arcs u->v are merged into one arc with the sum of their
+ *            capacities.
+ *          - A node other than the terminals with one arc in, u->v, and one
+ *            arc out, v->w, is a series link: both arcs are replaced by the
+ *            arc u->w with the smaller of their capacities. If w is u the two
+ *            arcs form a cycle that carries no flow and are dropped.
+ *
+ *          Every arc keeps a tree of the input edges it stands for, with
+ *          series and parallel inner nodes, so a flow on it can be split back
+ *          onto those edges: a series node passes the flow to both children,
+ *          a parallel node fills its first child before the second one.
+ *
+ *          The remaining nodes are renumbered so that the nodes a search
+ *          visits one after another sit close together in memory: in breadth
+ *          first or reverse Cuthill-McKee order from the source, by degree, or
+ *          along a Hilbert curve for grids, whose neighbours then mostly fall
+ *          on the same pages. The reduced graph is built in CSR form.
+ *          PREPROCESS_REDUCE_NONE only renumbers, for relabeling a graph at
+ *          build time. After it is solved, restoreFlow()
+ *          writes the flow onto the input graph, on which findMinCut(),
+ *          computeMinCut() and printEdgeFlows() then report the input ids.
+ */
+template<class Graph>
+class maxFlowPreprocessor{
+public:
+    typedef typename Graph::capacityType capacityType;
+    typedef residualGraph<DYNAMIC_NODE_COUNT, typename Graph::capacityStorage> reducedGraph;
+
+    maxFlowPreprocessor() :
+        reduced_(0, 0, 0),
+        pruned_nodes_(0),
+        contracted_nodes_(0),
+        merged_arcs_(0),
+        grid_rows_(0),
+        grid_columns_(0),
+        grid_first_node_(0)
+    {
+    }
+
+    /*
+     * @brief   Reduce a graph. The graph is only read, its residual
+     *          capacities are ignored and every input edge is taken at its
+     *          original capacity.
+     *
+     * @param [in]  graph       A flow network transformed into a residual graph with back edges
+     * @param [in]  order       One of the PREPROCESS_ORDER_* node orders. The default value is
+     *                          PREPROCESS_ORDER_BFS.
+     * @param [in]  reductions  PREPROCESS_* flags of the reductions to apply. The default value
+     *                          is PREPROCESS_REDUCE_ALL.
+     */
+    void build(Graph& graph, int order = PREPROCESS_ORDER_BFS, int reductions = PREPROCESS_REDUCE_ALL){
+        node_count_ = graph.getNodeCount();
+        source_ = graph.getSource();
+        sink_ = graph.getSink();
+        pruned_nodes_ = contracted_nodes_ = merged_arcs_ = 0;
+        expression_kinds_.clear();
+        expression_children_.clear();
+        expression_capacities_.clear();
+        arcs_.clear();
+        for(int node_id = 0; node_id < node_count_; node_id++){
+            for(int edge_id = graph.getFirstEdge(node_id); edge_id < graph.getLastEdge(node_id); edge_id++){
+                if(graph.getOriginalCapacity(edge_id) > 0 && graph.getHead(edge_id) != node_id){
+                    arc added = {node_id, graph.getHead(edge_id), addExpression(EXPRESSION_EDGE, edge_id, 0, graph.getOriginalCapacity(edge_id)), true};
+                    arcs_.push_back(added);
+                }
+            }
+        }
+
+        node_alive_.assign(node_count_, 1);
+        bool changed = true;
+        while(changed){
+            changed = (reductions & PREPROCESS_PRUNE) != 0 && pruneNodes();
+            changed = ((reductions & PREPROCESS_MERGE) != 0 && mergeParallelArcs()) || changed;
+            changed = ((reductions & PREPROCESS_CONTRACT) != 0 && contractSeriesNodes()) || changed;
+        }
+        numberNodes(order);
+        buildReducedGraph();
+    }
+
+    /*
+     * @brief   Describe the grid of a grid input for PREPROCESS_ORDER_HILBERT:
+     *          node first_node + row * columns + column is the cell at row and
+     *          column. The other nodes are not part of the grid.
+     */
+    void setGridShape(int rows, int columns, int first_node){
+        grid_rows_ = rows;
+        grid_columns_ = columns;
+        grid_first_node_ = first_node;
+    }
+
+    /* The reduced graph, to be solved with any engine before restoreFlow() */
+    reducedGraph& getReducedGraph(){return reduced_;}
+
+    /* Input id of a node of the reduced graph */
+    int getOriginalNode(int reduced_node){return original_nodes_[reduced_node];}
+    /* Id in the reduced graph of an input node, INVALID_PARENT if it was removed */
+    int getReducedNode(int original_node){return reduced_nodes_[original_node];}
+
+    int getPrunedNodeCount(){return pruned_nodes_;}
+    int getContractedNodeCount(){return contracted_nodes_;}
+    int getMergedArcCount(){return merged_arcs_;}
+
+    /*
+     * @brief   Replace the flow of the input graph with the flow on the
+     *          reduced graph, split onto the input edges. The reduced graph
+     *          must hold a flow, not the preflow of PUSH_RELABEL_PREFLOW_ONLY.
+     *
+     * @param [in]  graph   The graph build() was called with
+     */
+    void restoreFlow(Graph& graph){
+        for(int edge_id = 0; edge_id < graph.getEdgeCount(); edge_id++){
+            graph.setResidualCapacity(edge_id, graph.getOriginalCapacity(edge_id));
+        }
+        std::vector<std::pair<int, capacityType> > pending;
+        for(size_t i = 0; i < arcs_.size(); i++){
+            if(!arcs_[i].alive){
+                continue;
+            }
+            const int edge_id = reduced_edges_[i];
+            const capacityType flow = reduced_.getOriginalCapacity(edge_id) - reduced_.getResidualCapacity(edge_id);
+            if(flow > 0){
+                pending.push_back(std::make_pair(arcs_[i].expression, flow));
+            }
+            while(!pending.empty()){
+                const int expression = pending.back().first;
+                capacityType amount = pending.back().second;
+                pending.pop_back();
+                const int first = expression_children_[2 * expression];
+                const int second = expression_children_[2 * expression + 1];
+                if(expression_kinds_[expression] == EXPRESSION_EDGE){
+                    graph.setResidualCapacity(first, graph.getResidualCapacity(first) - amount);
+                    graph.setResidualCapacity(graph.getReverse(first), graph.getResidualCapacity(graph.getReverse(first)) + amount);
+                } else if(expression_kinds_[expression] == EXPRESSION_SERIES){
+                    pending.push_back(std::make_pair(first, amount));
+                    pending.push_back(std::make_pair(second, amount));
+                } else {
+                    const capacityType first_amount = std::min(amount, expression_capacities_[first]);
+                    pending.push_back(std::make_pair(first, first_amount));
+                    if(amount > first_amount){
+                        pending.push_back(std::make_pair(second, amount - first_amount));
+                    }
+                }
+            }
+        }
+    }
+private:
+    maxFlowPreprocessor(const maxFlowPreprocessor&);
+    maxFlowPreprocessor& operator=(const maxFlowPreprocessor&);
+
+    /* Kinds of the nodes of the expression trees */
+    static const char EXPRESSION_EDGE = 0; /* An input edge, the first child is its edge id */
+    static const char EXPRESSION_SERIES = 1; /* Both children carry the whole flow */
+    static const char EXPRESSION_PARALLEL = 2; /* The children share the flow */
+
+    struct arc{
+        int from;
+        int to;
+        int expression; /* Root of the tree of input edges */
+        bool alive;
+    };
+
+    int addExpression(char kind, int first, int second, capacityType capacity){
+        expression_kinds_.push_back(kind);
+        expression_children_.push_back(first);
+        expression_children_.push_back(second);
+        expression_capacities_.push_back(capacity);
+        return (int)expression_kinds_.size() - 1;
+    }
+
+    capacityType getArcCapacity(int arc_id){return expression_capacities_[arcs_[arc_id].expression];}
+
+    /* Build in and out arc lists of the live arcs, as offsets into one array each */
+    void buildAdjacency(){
+        out_offsets_.assign(node_count_ + 1, 0);
+        in_offsets_.assign(node_count_ + 1, 0);
+        for(size_t i = 0; i < arcs_.size(); i++){
+            if(arcs_[i].alive){
+                out_offsets_[arcs_[i].from + 1]++;
+                in_offsets_[arcs_[i].to + 1]++;
+            }
+        }
+        for(int i = 0; i < node_count_; i++){
+            out_offsets_[i + 1] += out_offsets_[i];
+            in_offsets_[i + 1] += in_offsets_[i];
+        }
+        out_arcs_.resize(out_offsets_[node_count_]);
+        in_arcs_.resize(in_offsets_[node_count_]);
+        std::vector<int> next_out(out_offsets_.begin(), out_offsets_.end() - 1);
+        std::vector<int> next_in(in_offsets_.begin(), in_offsets_.end() - 1);
+        for(size_t i = 0; i < arcs_.size(); i++){
+            if(arcs_[i].alive){
+                out_arcs_[next_out[arcs_[i].from]++] = (int)i;
+                in_arcs_[next_in[arcs_[i].to]++] = (int)i;
+            }
+        }
+    }
+
+    /* Mark the nodes reachable from start along live arcs, forward or backward */
+    void markReachable(int start, bool backward, std::vector<char>& reached){
+        reached.assign(node_count_, 0);
+        std::vector<int> queue(1, start);
+        reached[start] = 1;
+        for(size_t next = 0; next < queue.size(); next++){
+            const int node_id = queue[next];
+            const std::vector<int>& offsets = backward ? in_offsets_ : out_offsets_;
+            const std::vector<int>& arcs = backward ? in_arcs_ : out_arcs_;
+            for(int i = offsets[node_id]; i < offsets[node_id + 1]; i++){
+                const int other = backward ? arcs_[arcs[i]].from : arcs_[arcs[i]].to;
+                if(!reached[other]){
+                    reached[other] = 1;
+                    queue.push_back(other);
+                }
+            }
+        }
+    }
+
+    /* @return True if a node was removed */
+    bool pruneNodes(){
+        buildAdjacency();
+        std::vector<char> from_source;
+        std::vector<char> to_sink;
+        markReachable(source_, false, from_source);
+        markReachable(sink_, true, to_sink);
+        bool changed = false;
+        for(int i = 0; i < node_count_; i++){
+            if(node_alive_[i] && i != source_ && i != sink_ && !(from_source[i] && to_sink[i])){
+                node_alive_[i] = 0;
+                pruned_nodes_++;
+                changed = true;
+            }
+        }
+        for(size_t i = 0; i < arcs_.size(); i++){
+            /* Without a path from the source to the target no arc can carry flow */
+            if(arcs_[i].alive && (!node_alive_[arcs_[i].from] || !node_alive_[arcs_[i].to] || !to_sink[source_])){
+                arcs_[i].alive = false;
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+    /* @return True if two arcs were merged */
+    bool mergeParallelArcs(){
+        std::vector<int> order;
+        for(size_t i = 0; i < arcs_.size(); i++){
+            if(arcs_[i].alive){
+                order.push_back((int)i);
+            }
+        }
+        std::sort(order.begin(), order.end(), [&](int a, int b){
+            return arcs_[a].from != arcs_[b].from ? arcs_[a].from < arcs_[b].from : arcs_[a].to < arcs_[b].to;
+        });
+        bool changed = false;
+        for(size_t first = 0, next = 1; next < order.size(); next++){
+            arc& kept = arcs_[order[first]];
+            arc& other = arcs_[order[next]];
+            if(other.from != kept.from || other.to != kept.to){
+                first = next;
+                continue;
+            }
+            /*
+             * Arcs whose sum does not fit the capacity storage stay apart,
+             * a saturated sum would lose the flow above it
+             */
+            capacityType sum;
+            if(!checkedAdd(expression_capacities_[kept.expression], expression_capacities_[other.expression], sum)
+                    || !fitsCapacityStorage<typename Graph::capacityStorage>(sum)){
+                first = next;
+                continue;
+            }
+            kept.expression = addExpression(EXPRESSION_PARALLEL, kept.expression, other.expression, sum);
+            other.alive = false;
+            merged_arcs_++;
+            changed = true;
+        }
+        return changed;
+    }
+
+    /* @return True if a node was contracted */
+    bool contractSeriesNodes(){
+        buildAdjacency();
+        /* Only meaningful for nodes with one arc in and one out, kept up to date as links are contracted */
+        std::vector<int> in_arc(node_count_, INVALID_PARENT);
+        std::vector<int> out_arc(node_count_, INVALID_PARENT);
+        std::vector<int> links;
+        for(int i = 0; i < node_count_; i++){
+            if(node_alive_[i] && i != source_ && i != sink_
+                    && in_offsets_[i + 1] - in_offsets_[i] == 1 && out_offsets_[i + 1] - out_offsets_[i] == 1){
+                in_arc[i] = in_arcs_[in_offsets_[i]];
+                out_arc[i] = out_arcs_[out_offsets_[i]];
+                links.push_back(i);
+            }
+        }
+        for(size_t i = 0; i < links.size(); i++){
+            const int node_id = links[i];
+            const int in = in_arc[node_id];
+            const int out = out_arc[node_id];
+            if(!arcs_[in].alive || !arcs_[out].alive){
+                /* Its arcs formed a cycle through another link, the node is pruned next round */
+                continue;
+            }
+            const int from = arcs_[in].from;
+            const int to = arcs_[out].to;
+            arcs_[in].alive = false;
+            arcs_[out].alive = false;
+            node_alive_[node_id] = 0;
+            contracted_nodes_++;
+            if(from == to){
+                continue;
+            }
+            arc added = {from, to, addExpression(EXPRESSION_SERIES, arcs_[in].expression, arcs_[out].expression,
+                    std::min(getArcCapacity(in), getArcCapacity(out))), true};
+            arcs_.push_back(added);
+            out_arc[from] = (int)arcs_.size() - 1;
+            in_arc[to] = (int)arcs_.size() - 1;
+        }
+        return !links.empty();
+    }
+
+    int getDegree(int node_id){
+        return out_offsets_[node_id + 1] - out_offsets_[node_id] + in_offsets_[node_id + 1] - in_offsets_[node_id];
+    }
+
+    /* Give the live nodes their ids in the reduced graph */
+    void numberNodes(int order){
+        buildAdjacency();
+        reduced_nodes_.assign(node_count_, INVALID_PARENT);
+        original_nodes_.clear();
+        if(order == PREPROCESS_ORDER_BFS || order == PREPROCESS_ORDER_RCM){
+            numberBreadthFirst(order == PREPROCESS_ORDER_RCM);
+        } else {
+            for(int i = 0; i < node_count_; i++){
+                if(node_alive_[i]){
+                    original_nodes_.push_back(i);
+                }
+            }
+            if(order == PREPROCESS_ORDER_DEGREE){
+                std::stable_sort(original_nodes_.begin(), original_nodes_.end(), [&](int a, int b){
+                    return getDegree(a) > getDegree(b);
+                });
+            } else if(order == PREPROCESS_ORDER_HILBERT && grid_rows_ > 0 && grid_columns_ > 0){
+                std::vector<long long> keys(node_count_);
+                int side = 1;
+                while(side < grid_rows_ || side < grid_columns_){
+                    side *= 2;
+                }
+                for(int i = 0; i < node_count_; i++){
+                    const int cell = i - grid_first_node_;
+                    /* Nodes outside the grid, like the terminals, go first */
+                    keys[i] = cell >= 0 && cell < grid_rows_ * grid_columns_
+                        ? getHilbertIndex(side, cell % grid_columns_, cell / grid_columns_) : -1;
+                }
+                std::stable_sort(original_nodes_.begin(), original_nodes_.end(), [&](int a, int b){
+                    return keys[a] < keys[b];
+                });
+            }
+        }
+        for(size_t i = 0; i < original_nodes_.size(); i++){
+            reduced_nodes_[original_nodes_[i]] = (int)i;
+        }
+    }
+
+    /*
+     * Breadth first over the arcs in both directions, from the source and then
+     * from the lowest live node not reached yet, until every live node is reached
+     */
+    void numberBreadthFirst(bool reverse_cuthill_mckee){
+        std::vector<int> neighbours;
+        std::vector<char> queued(node_count_, 0);
+        int next_root = 0;
+        original_nodes_.push_back(source_);
+        queued[source_] = 1;
+        for(size_t next = 0; next < original_nodes_.size(); next++){
+            const int node_id = original_nodes_[next];
+            neighbours.clear();
+            for(int i = out_offsets_[node_id]; i < out_offsets_[node_id + 1]; i++){
+                neighbours.push_back(arcs_[out_arcs_[i]].to);
+            }
+            for(int i = in_offsets_[node_id]; i < in_offsets_[node_id + 1]; i++){
+                neighbours.push_back(arcs_[in_arcs_[i]].from);
+            }
+            if(reverse_cuthill_mckee){
+                /* Cuthill-McKee visits the neighbours by increasing degree */
+                std::sort(neighbours.begin(), neighbours.end(), [&](int a, int b){
+                    return getDegree(a) != getDegree(b) ? getDegree(a) < getDegree(b) : a < b;
+                });
+            }
+            for(size_t i = 0; i < neighbours.size(); i++){
+                if(!queued[neighbours[i]]){
+                    queued[neighbours[i]] = 1;
+                    original_nodes_.push_back(neighbours[i]);
+                }
+            }
+            if(next + 1 == original_nodes_.size()){
+                while(next_root < node_count_ && (!node_alive_[next_root] || queued[next_root])){
+                    next_root++;
+                }
+                if(next_root < node_count_){
+                    queued[next_root] = 1;
+                    original_nodes_.push_back(next_root);
+                }
+            }
+        }
+        if(reverse_cuthill_mckee){
+            std::reverse(original_nodes_.begin(), original_nodes_.end());
+        }
+    }
+
+    /* Position of cell (x, y) along the Hilbert curve through a side x side square, side a power of two */
+    static long long getHilbertIndex(int side, int x, int y){
+        long long index = 0;
+        for(int half = side / 2; half > 0; half /= 2){
+            const int right = (x & half) != 0;
+            const int top = (y & half) != 0;
+            index += (long long)half * half * ((3 * right) ^ top);
+            /* Rotate the quadrant so the curve inside it has the orientation of the whole */
+            if(top == 0){
+                if(right == 1){
+                    x = side - 1 - x;
+                    y = side - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return index;
+    }
+
+    void buildReducedGraph(){
+        const int node_count = (int)original_nodes_.size();
+        reduced_.reset(node_count, reduced_nodes_[source_], reduced_nodes_[sink_]);
+        std::vector<int32_t> degrees(node_count, 0);
+        for(size_t i = 0; i < arcs_.size(); i++){
+            if(arcs_[i].alive){
+                degrees[reduced_nodes_[arcs_[i].from]]++;
+                degrees[reduced_nodes_[arcs_[i].to]]++;
+            }
+        }
+        reduced_.allocateEdges(degrees);
+        std::vector<int32_t> next_slot(node_count);
+        for(int i = 0; i < node_count; i++){
+            next_slot[i] = reduced_.getFirstEdge(i);
+        }
+        reduced_edges_.assign(arcs_.size(), INVALID_PARENT);
+        /* Edges in reduced node order, so every edge range is sorted by tail too */
+        for(int i = 0; i < node_count; i++){
+            const int node_id = original_nodes_[i];
+            for(int k = out_offsets_[node_id]; k < out_offsets_[node_id + 1]; k++){
+                const arc& edge = arcs_[out_arcs_[k]];
+                const int from = reduced_nodes_[edge.from];
+                const int to = reduced_nodes_[edge.to];
+                reduced_edges_[out_arcs_[k]] = next_slot[from];
+                reduced_.setEdgePair(next_slot[from]++, next_slot[to]++, from, to, expression_capacities_[edge.expression]);
+            }
+        }
+    }
+
+    int node_count_; /* Nodes of the input graph */
+    int source_;
+    int sink_;
+    reducedGraph reduced_;
+    std::vector<arc> arcs_; /* Arcs of the input, then those made by contractions */
+    std::vector<char> node_alive_; /* Input nodes still in the graph */
+    std::vector<char> expression_kinds_; /* EXPRESSION_* of each tree node */
+    std::vector<int> expression_children_; /* Two per tree node */
+    std::vector<capacityType> expression_capacities_; /* Capacity of the subtree of each tree node */
+    std::vector<int> out_offsets_; /* Per node start of its live arcs in out_arcs_ */
+    std::vector<int> out_arcs_;
+    std::vector<int> in_offsets_;
+    std::vector<int> in_arcs_;
+    std::vector<int> original_nodes_; /* Input id of each reduced node */
+    std::vector<int> reduced_nodes_; /* Reduced id of each input node, INVALID_PARENT if removed */
+    std::vector<int> reduced_edges_; /* Edge of the reduced graph of each live arc */
+    int pruned_nodes_;
+    int contracted_nodes_;
+    int merged_arcs_;
+    int grid_rows_; /* Grid of setGridShape(), 0 rows if there is none */
+    int grid_columns_;
+    int grid_first_node_;
+};
+
+/*
+ * @brief   Reduce a graph with maxFlowPreprocessor, solve the reduced graph and
+ *          write the flow back, so the graph is left holding a maximum flow as
+ *          after solveMaxFlow().
+ *
+ * @param [in]  graph           A flow network transformed into a residual graph with back edges
+ * @param [in]  engine          One of the MAX_FLOW_* engine ids
+ * @param [in]  order           One of the PREPROCESS_ORDER_* node orders. The default value is
+ *                              PREPROCESS_ORDER_BFS.
+ * @param [in]  thread_count    As for solveMaxFlow(). The default value is 1.
+ * @param [in]  reductions      PREPROCESS_* flags, as for build(). The default value is
+ *                              PREPROCESS_REDUCE_ALL.
+ *
+ * @return  Returns the maximum flow possible in that flow network
+ */
+template<class Graph>
+typename Graph::flowType solvePreprocessed(Graph& graph, int engine, int order = PREPROCESS_ORDER_BFS, int thread_count = 1,
+        int reductions = PREPROCESS_REDUCE_ALL){
+    maxFlowPreprocessor<Graph> preprocessor;
+    preprocessor.build(graph, order, reductions);
+    const typename Graph::flowType max_flow = solveMaxFlow(preprocessor.getReducedGraph(), engine, thread_count);
+    preprocessor.restoreFlow(graph);
+    return max_flow;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef GRID_GRAPH_H
+#define GRID_GRAPH_H
+
+#include<cstddef>
+#include<vector>
+
+#include "residual_graph.h"
+
+/*
+ * @brief    Flow network over a 4 or 8 connected pixel lattice, as used for
+ *          image segmentation. Every pixel is a node with an edge from the
+ *          source and an edge to the target.
+ *
+ *          Nothing about the lattice is stored explicitly. The edge from a
+ *          node in a given direction has the index
+ *          node_id * CONNECTIVITY + direction, its head is computed from the
+ *          direction and its back edge is the edge of the neighbour in the
+ *          opposite direction, so only the residual capacities take memory.
+ *          Edges that would leave the image are kept with 0 capacity and
+ *          point back at their own node.
+ *
+ *          Directions run clockwise starting to the right: for CONNECTIVITY
+ *          4 they are right, down, left, up and for CONNECTIVITY 8 the
+ *          diagonals are inserted between them. The opposite of direction k
+ *          is (k + CONNECTIVITY / 2) % CONNECTIVITY.
+ *
+ *          The terminal edges are kept as per node residual capacities. This
+ *          is the graph interface boykovKolmogorov() runs on. Capacities are
+ *          stored as Capacity and taken and returned as for residualGraph.
+ */
+template<int CONNECTIVITY, class Capacity = residualCapacityStorage>
+class gridGraph{
+    static_assert(CONNECTIVITY == 4 || CONNECTIVITY == 8, "Grid connectivity must be 4 or 8");
+public:
+    typedef Capacity capacityStorage;
+    typedef typename capacityValue<Capacity>::type capacityType;
+    typedef typename flowValue<Capacity>::type flowType;
+
+    gridGraph(int width, int height) :
+        width_(width),
+        height_(height),
+        residual_((size_t)width * height * CONNECTIVITY, 0),
+        source_residual_((size_t)width * height, 0),
+        sink_residual_((size_t)width * height, 0)
+    {
+    }
+
+    int getWidth(){return width_;}
+    int getHeight(){return height_;}
+    int getNodeCount(){return width_ * height_;}
+    int getNodeId(int x, int y){return y * width_ + x;}
+
+    /* Capacity of the edge from node_id to its neighbour in the given direction. Ignored at the image border. */
+    void setNeighbourCapacity(int node_id, int direction, capacityType capacity){
+        if(getHead(node_id * CONNECTIVITY + direction) != node_id){
+            residual_[(size_t)node_id * CONNECTIVITY + direction] = capacity;
+        }
+    }
+
+    /* Capacities of the edges source->node_id and node_id->target. */
+    void setTerminalCapacity(int node_id, capacityType source_capacity, capacityType sink_capacity){
+        source_residual_[node_id] = source_capacity;
+        sink_residual_[node_id] = sink_capacity;
+    }
+
+    int getFirstEdge(int node_id){return node_id * CONNECTIVITY;}
+    int getLastEdge(int node_id){return node_id * CONNECTIVITY + CONNECTIVITY;}
+
+    int getHead(int edge_id){
+        int node_id = edge_id / CONNECTIVITY;
+        int direction = edge_id % CONNECTIVITY;
+        int x = node_id % width_ + directionX(direction);
+        int y = node_id / width_ + directionY(direction);
+        if(x < 0 || x >= width_ || y < 0 || y >= height_){
+            return node_id;
+        }
+        return y * width_ + x;
+    }
+
+    int getReverse(int edge_id){
+        int head = getHead(edge_id);
+        int direction = edge_id % CONNECTIVITY;
+        if(head == edge_id / CONNECTIVITY){
+            return edge_id;
+        }
+        return head * CONNECTIVITY + (direction + CONNECTIVITY / 2) % CONNECTIVITY;
+    }
+
+    capacityType getResidualCapacity(int edge_id){return residual_[edge_id];}
+    void setResidualCapacity(int edge_id, capacityType residual_capacity){residual_[edge_id] = residual_capacity;}
+
+    flowType getSourceCapacity(int node_id){return source_residual_[node_id];}
+    flowType getSinkCapacity(int node_id){return sink_residual_[node_id];}
+
+    /* Record the flow a solver sent over the terminal edges of a node, at most their capacity. */
+    void setTerminalFlow(int node_id, flowType source_flow, flowType sink_flow){
+        source_residual_[node_id] = (Capacity)(source_residual_[node_id] - source_flow);
+        sink_residual_[node_id] = (Capacity)(sink_residual_[node_id] - sink_flow);
+    }
+private:
+    static int directionX(int direction){
+        static const int dx4[4] = {1, 0, -1, 0};
+        static const int dx8[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+        return CONNECTIVITY == 4 ? dx4[direction % 4] : dx8[direction];
+    }
+    static int directionY(int direction){
+        static const int dy4[4] = {0, 1, 0, -1};
+        static const int dy8[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+        return CONNECTIVITY == 4 ? dy4[direction % 4] : dy8[direction];
+    }
+
+    int width_; /* Pixels per row */
+    int height_; /* Number of rows */
+    std::vector<Capacity> residual_; /* Residual capacity per node and direction */
+    std::vector<Capacity> source_residual_; /* Residual capacity of source->node */
+    std::vector<Capacity> sink_residual_; /* Residual capacity of node->target */
+};
+
+#endif
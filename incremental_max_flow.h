@@ -0,0 +1,216 @@
+#ifndef INCREMENTAL_MAX_FLOW_H
+#define INCREMENTAL_MAX_FLOW_H
+
+#include<climits>
+
+#include "maxflow_mincut.h"
+#include "simd_scan.h"
+#include "solver_workspace.h"
+
+/*
+ * Change of the capacity of one edge, by edge id as numbered by the graph.
+ * capacityDelta fits every integer capacity type; graphs with floating point
+ * capacities take fractional changes as capacityChange<double>.
+ */
+template<class Delta>
+struct capacityChange{
+    int edge_id;
+    Delta delta;
+};
+typedef capacityChange<long long> capacityDelta;
+
+/*
+ * @brief   BFS over the residual edges from every start node at once until a
+ *          node for which is_target(node) holds is dequeued. A start node can
+ *          be the target itself. The path can be read back from the parents
+ *          in the workspace, the start nodes have INVALID_PARENT as parent.
+ *
+ * @return  Returns the target that was reached, or INVALID_PARENT if none can be
+ */
+template<class Graph, class Target>
+int residualSearch(Graph& graph,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>& search,
+        const int* starts,
+        int start_count,
+        Target is_target)
+{
+    SOLVER_PHASE_TIMER(SOLVER_PHASE_SEARCH);
+    SOLVER_COUNT(bfs_calls, 1);
+    search.beginSearch(graph.getNodeCount());
+    for(int i = 0; i < start_count; i++){
+        if(!search.isVisited(starts[i])){
+            search.setVisited(starts[i]);
+            search.setParent(starts[i], INVALID_PARENT, INVALID_PARENT);
+            search.push(starts[i]);
+        }
+    }
+    while(!search.isQueueEmpty()){
+        int node_id = search.pop();
+        if(is_target(node_id)){
+            return node_id;
+        }
+        SOLVER_COUNT(nodes_dequeued, 1);
+        SOLVER_COUNT(arcs_scanned, graph.getLastEdge(node_id) - graph.getFirstEdge(node_id));
+        forEachResidualArc(graph, node_id, [&](int edge_id){
+            int next_node = graph.getHead(edge_id);
+            if(!search.isVisited(next_node)){
+                search.setVisited(next_node);
+                search.setParent(next_node, node_id, edge_id);
+                search.push(next_node);
+            }
+        });
+    }
+    return INVALID_PARENT;
+}
+
+/*
+ * @brief   Send flow along the path residualSearch() found to end_node, up to
+ *          the bottleneck of the path and at most max_amount.
+ *
+ * @return  Returns the amount sent, max_amount for a path without edges
+ */
+template<class Graph>
+typename Graph::flowType augmentResidualPath(Graph& graph, solverWorkspace<Graph::STATIC_NODE_COUNT>& search,
+        int end_node, typename Graph::flowType max_amount){
+    typedef typename Graph::capacityType capacityType;
+    if(search.getParentNode(end_node) == INVALID_PARENT){
+        return max_amount;
+    }
+    int* path_edges = search.getPathEdges();
+    int path_length = 0;
+    for(int node_id = end_node; search.getParentNode(node_id) != INVALID_PARENT; node_id = search.getParentNode(node_id)){
+        path_edges[path_length++] = search.getParentEdge(node_id);
+    }
+    capacityType amount = minResidual(graph.getResidualCapacities(), path_edges, path_length);
+    if(max_amount < (typename Graph::flowType)amount){
+        amount = (capacityType)max_amount;
+    }
+    SOLVER_COUNT_AUGMENTATION(path_length, amount);
+    for(int i = 0; i < path_length; i++){
+        int edge_id = path_edges[i];
+        int back_edge = graph.getReverse(edge_id);
+        graph.setResidualCapacity(edge_id, graph.getResidualCapacity(edge_id) - amount);
+        graph.setResidualCapacity(back_edge, graph.getResidualCapacity(back_edge) + amount);
+    }
+    return amount;
+}
+
+/* Flow value of a graph holding a flow: the excess of the target. */
+template<class Graph>
+typename Graph::flowType getFlowValue(Graph& graph){
+    typedef typename Graph::flowType flowType;
+    flowType flow = 0;
+    const int sink = graph.getSink();
+    for(int edge_id = graph.getFirstEdge(sink); edge_id < graph.getLastEdge(sink); edge_id++){
+        flow += (flowType)graph.getResidualCapacity(edge_id) - (flowType)graph.getOriginalCapacity(edge_id);
+    }
+    return flow;
+}
+
+/*
+ * @brief   Bring the maximum flow of an already solved graph up to date after
+ *          some edge capacities changed, starting from the flow it holds.
+ *
+ *          An increase only adds residual capacity to its edge, the new
+ *          augmenting paths are found at the end. A decrease below the flow on
+ *          its edge u->v cancels the overflow, which leaves an excess at u
+ *          and a deficit at v. The excess is sent back to v around the edge
+ *          if possible, otherwise to the source or the target, and what is
+ *          left of the deficit is made up from the source or the target. Each
+ *          of these is a breadth first search that stops at the nearest node
+ *          that can take the flow, so the repair stays local to the changed
+ *          edge. Finally Ford Fulkerson augments from the repaired flow, so
+ *          the work depends on how much the flow changes and not on the size
+ *          of the flow.
+ *
+ * @param [in]  graph         Graph holding a flow, as left by any of the engines run to a
+ *                            full flow. It is left holding the new maximum flow.
+ * @param [in]  deltas        Capacity changes to apply. A capacity never goes below 0, and a
+ *                            change that would take it past the capacity type is skipped
+ *                            with a message.
+ * @param [in]  delta_count   Number of changes
+ * @param [in]  workspace     Search buffers, as for fordFulkerson(). NULL allocates one
+ *                            for this call. The default value is NULL.
+ *
+ * @return  Returns the new maximum flow
+ */
+template<class Graph, class Delta>
+typename Graph::flowType updateMaxFlow(Graph& graph,
+        const capacityChange<Delta>* deltas,
+        int delta_count,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL)
+{
+    typedef typename Graph::capacityType capacityType;
+    typedef typename Graph::flowType flowType;
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? graph.getNodeCount() : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& search = workspace != NULL ? *workspace : local_workspace;
+    const int source = graph.getSource();
+    const int sink = graph.getSink();
+    const int terminals[2] = {source, sink};
+
+    for(int i = 0; i < delta_count; i++){
+        const int edge_id = deltas[i].edge_id;
+        flowType delta = (flowType)deltas[i].delta;
+        if(delta < -(flowType)graph.getOriginalCapacity(edge_id)){
+            delta = -(flowType)graph.getOriginalCapacity(edge_id);
+        }
+        /* Computed as flows before storing, the capacity type may be unsigned or too narrow */
+        const flowType original_capacity = (flowType)graph.getOriginalCapacity(edge_id) + delta;
+        const flowType residual_capacity = (flowType)graph.getResidualCapacity(edge_id) + delta;
+        if(!fitsCapacityStorage<typename Graph::capacityStorage>(original_capacity)
+                || (residual_capacity > 0 && !fitsCapacityStorage<typename Graph::capacityStorage>(residual_capacity))){
+            std::cerr<<"The new capacity of edge "<<edge_id<<" does not fit the capacity type, the change is skipped\n";
+            continue;
+        }
+        graph.setOriginalCapacity(edge_id, (capacityType)original_capacity);
+        if(residual_capacity >= 0){
+            graph.setResidualCapacity(edge_id, (capacityType)residual_capacity);
+            continue;
+        }
+
+        /* The edge carries more than its new capacity, cancel the overflow */
+        const int back_edge = graph.getReverse(edge_id);
+        const int from = graph.getHead(back_edge);
+        const int to = graph.getHead(edge_id);
+        flowType excess = -residual_capacity;
+        flowType deficit = excess;
+        graph.setResidualCapacity(edge_id, 0);
+        graph.setResidualCapacity(back_edge, (capacityType)((flowType)graph.getResidualCapacity(back_edge) - excess));
+        if(from == source || from == sink){
+            excess = 0;
+        }
+        if(to == source || to == sink){
+            deficit = 0;
+        }
+
+        /* Reroute the excess to the deficit, or return it to a terminal */
+        while(excess > 0){
+            int end_node = residualSearch(graph, search, &from, 1, [&](int node_id){
+                return node_id == source || node_id == sink || (node_id == to && deficit > 0);
+            });
+            if(end_node == INVALID_PARENT){
+                break;
+            }
+            flowType amount = augmentResidualPath(graph, search, end_node, excess);
+            excess -= amount;
+            if(end_node == to){
+                deficit -= amount;
+            }
+        }
+        /* Make up the rest of the deficit from the terminals */
+        while(deficit > 0){
+            int end_node = residualSearch(graph, search, terminals, 2, [&](int node_id){
+                return node_id == to;
+            });
+            if(end_node == INVALID_PARENT){
+                break;
+            }
+            deficit -= augmentResidualPath(graph, search, end_node, deficit);
+        }
+    }
+
+    fordFulkerson(graph, 1, &search);
+    return getFlowValue(graph);
+}
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef MAX_FLOW_H
+#define MAX_FLOW_H
+
+#include<cstring>
+#include<future>
+#include<vector>
+
+#include "maxflow_mincut.h"
+#include "dinic.h"
+#include "push_relabel.h"
+#include "boykov_kolmogorov.h"
+#include "parallel_push_relabel.h"
+
+/* Max flow engines that solveMaxFlow() can run */
+#define MAX_FLOW_FORD_FULKERSON 0
+#define MAX_FLOW_DINIC 1
+#define MAX_FLOW_PUSH_RELABEL 2
+#define MAX_FLOW_BOYKOV_KOLMOGOROV 3
+#define MAX_FLOW_PARALLEL_PUSH_RELABEL 4
+#define MAX_FLOW_CAPACITY_SCALING 5
+#define MAX_FLOW_BIDIRECTIONAL 6
+#define MAX_FLOW_ENGINE_COUNT 7
+
+/* Results computeMaxFlow() produces besides the flow value, or-ed together */
+#define MAX_FLOW_OUTPUT_VALUE 0 /* Only the flow value */
+#define MAX_FLOW_OUTPUT_CUT 1 /* Bitmap of the s side of a minimum cut */
+#define MAX_FLOW_OUTPUT_FLOWS 2 /* Flow on every edge */
+#define MAX_FLOW_OUTPUT_ALL (MAX_FLOW_OUTPUT_CUT | MAX_FLOW_OUTPUT_FLOWS)
+
+/* Short names used on command lines, indexed by engine */
+static const char* const maxFlowEngineNames[MAX_FLOW_ENGINE_COUNT] = {
+    "fordfulkerson", "dinic", "pushrelabel", "bk", "parallelpushrelabel", "scaling", "bidirectional"
+};
+
+/* Names for printing, indexed by engine */
+static const char* const maxFlowEngineTitles[MAX_FLOW_ENGINE_COUNT] = {
+    "Ford Fulkerson algorithm", "Dinic's algorithm", "push-relabel",
+    "Boykov-Kolmogorov", "parallel push-relabel", "capacity scaling Ford Fulkerson",
+    "bidirectional Ford Fulkerson"
+};
+
+/*
+ * @brief   Look up an engine by its short name.
+ *
+ * @return  Returns the engine id, or INVALID_PARENT if there is no engine with that name
+ */
+inline int maxFlowEngineFromName(const char* name){
+    for(int i = 0; i < MAX_FLOW_ENGINE_COUNT; i++){
+        if(strcmp(name, maxFlowEngineNames[i]) == 0){
+            return i;
+        }
+    }
+    return INVALID_PARENT;
+}
+
+/*
+ * @brief   Compute the maximum flow with the given engine. Every engine leaves
+ *          a maximum flow in the residual graph, so findMinCut() and
+ *          printEdgeFlows() can be used on the result. Every engine takes any
+ *          capacity type, except that graphs parallel push-relabel can not
+ *          hold, see parallelPushRelabelSupports, run serial push-relabel for
+ *          MAX_FLOW_PARALLEL_PUSH_RELABEL, and graphs with floating point
+ *          capacities, see pushRelabelSupports, run Dinic for both
+ *          push-relabel engines.
+ *
+ * @param [in]  graph           A flow network transformed into a residual graph
+ *                              with back edges
+ * @param [in]  engine          One of the MAX_FLOW_* engine ids
+ * @param [in]  thread_count    Threads for the engines that use them: the
+ *                              augmenting path search of Ford Fulkerson and the
+ *                              workers of parallel push-relabel. 0 means all
+ *                              hardware threads. The default value is 1.
+ * @param [in]  workspace       Search buffers and scratch arena for the serial engines,
+ *                              kept alive across solves so they do not allocate. NULL
+ *                              uses the heap. Parallel push-relabel and the parallel
+ *                              BFS always use the heap. The default value is NULL.
+ * @param [in]  control         Stops the Ford Fulkerson engines and Dinic on cancellation
+ *                              or at a deadline, see solveControl. The other engines run
+ *                              to completion. NULL never stops. The default value is NULL.
+ *
+ * @return  Returns the maximum flow possible in that flow network, exact even when it does
+ *          not fit the capacity type. The flow found so far if control stopped the engine.
+ */
+template<class Graph>
+typename Graph::flowType solveMaxFlow(Graph& graph, int engine, int thread_count = 1,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL,
+        solveControl<typename Graph::flowType>* control = NULL){
+    scratchArena* arena = workspace != NULL ? &workspace->getArena() : NULL;
+    switch(engine){
+    case MAX_FLOW_DINIC:
+        return dinic(graph, arena, control);
+    case MAX_FLOW_PUSH_RELABEL:
+        if constexpr(pushRelabelSupports<Graph>::value){
+            return pushRelabel(graph, PUSH_RELABEL_FULL_FLOW, arena);
+        } else {
+            return dinic(graph, arena, control);
+        }
+    case MAX_FLOW_BOYKOV_KOLMOGOROV:
+        return boykovKolmogorov(graph, arena);
+    case MAX_FLOW_PARALLEL_PUSH_RELABEL:
+        if constexpr(parallelPushRelabelSupports<Graph>::value){
+            return parallelPushRelabel(graph, thread_count);
+        } else if constexpr(pushRelabelSupports<Graph>::value){
+            return pushRelabel(graph, PUSH_RELABEL_FULL_FLOW, arena);
+        } else {
+            return dinic(graph, arena, control);
+        }
+    case MAX_FLOW_CAPACITY_SCALING:
+        return fordFulkerson(graph, thread_count, workspace, FORD_FULKERSON_CAPACITY_SCALING, control);
+    case MAX_FLOW_BIDIRECTIONAL:
+        return fordFulkerson(graph, thread_count, workspace, FORD_FULKERSON_BIDIRECTIONAL, control);
+    default:
+        return fordFulkerson(graph, thread_count, workspace, FORD_FULKERSON_SHORTEST_PATH, control);
+    }
+}
+
+/*
+ * What computeMaxFlow() found. Only the members asked for are filled. Flow is
+ * the flowType of the graph, the default one is that of 32 bit capacities.
+ */
+template<class Flow = long long>
+struct maxFlowResult{
+    Flow max_flow;
+    Flow upper_bound; /* max_flow for a finished solve, the best cut found for a stopped one */
+    int outputs; /* MAX_FLOW_OUTPUT_* flags of the members below that were filled */
+    minCutBitmap s_side; /* Bit set for the nodes of the s side of a minimum cut */
+    std::vector<Flow> edge_flows; /* Flow by edge id, see getEdgeFlows() */
+};
+
+/*
+ * @brief   Compute the maximum flow and only the results asked for, without
+ *          any output. When the per edge flows are not asked for, push-relabel
+ *          stops after its first phase and the cut is taken from the target
+ *          side, which skips turning the preflow into a flow.
+ *
+ * @param [in]  graph           A flow network transformed into a residual graph
+ *                              with back edges. It is left holding a maximum flow, or
+ *                              only a maximum preflow for MAX_FLOW_PUSH_RELABEL without
+ *                              MAX_FLOW_OUTPUT_FLOWS.
+ * @param [in]  engine          One of the MAX_FLOW_* engine ids
+ * @param [in]  outputs         MAX_FLOW_OUTPUT_* flags of the results to compute
+ * @param [out] result          Receives the flow value and the results asked for
+ * @param [in]  thread_count    As for solveMaxFlow(), also used for the cut. The default
+ *                              value is 1.
+ * @param [in]  workspace       As for solveMaxFlow(). The default value is NULL.
+ * @param [in]  control         As for solveMaxFlow(). When it stopped the engine the result
+ *                              holds the flow found so far, its upper_bound and s_side that
+ *                              of the smallest cut the checks found, and the graph a feasible
+ *                              flow. The default value is NULL.
+ *
+ * @return  Returns the maximum flow possible in that flow network
+ */
+template<class Graph>
+typename Graph::flowType computeMaxFlow(Graph& graph, int engine, int outputs,
+        maxFlowResult<typename Graph::flowType>& result, int thread_count = 1,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL,
+        solveControl<typename Graph::flowType>* control = NULL){
+    int cut_mode = MIN_CUT_FROM_SOURCE;
+    if(control != NULL && control->shouldStop(graph, 0)){
+        /* Cancelled or out of time before starting, the empty flow is the best there is */
+        result.max_flow = 0;
+    } else if(pushRelabelSupports<Graph>::value && engine == MAX_FLOW_PUSH_RELABEL && (outputs & MAX_FLOW_OUTPUT_FLOWS) == 0){
+        if constexpr(pushRelabelSupports<Graph>::value){
+            result.max_flow = pushRelabel(graph, PUSH_RELABEL_PREFLOW_ONLY, workspace != NULL ? &workspace->getArena() : NULL);
+            cut_mode = MIN_CUT_FROM_TARGET;
+        }
+    } else {
+        result.max_flow = solveMaxFlow(graph, engine, thread_count, workspace, control);
+    }
+    result.upper_bound = result.max_flow;
+    result.outputs = MAX_FLOW_OUTPUT_VALUE;
+    const bool stopped = control != NULL && control->getStatus() != SOLVE_STATUS_RUNNING;
+    if(control != NULL){
+        if(stopped){
+            typename Graph::flowType flow;
+            control->getProgress(flow, result.upper_bound);
+        } else {
+            control->setOptimal(result.max_flow);
+        }
+    }
+    if((outputs & MAX_FLOW_OUTPUT_CUT) != 0 && (stopped ? control->getBestCut(result.s_side)
+            : computeMinCut(graph, result.s_side, cut_mode, thread_count, workspace))){
+        result.outputs |= MAX_FLOW_OUTPUT_CUT;
+    }
+    if((outputs & MAX_FLOW_OUTPUT_FLOWS) != 0){
+        getEdgeFlows(graph, result.edge_flows);
+        result.outputs |= MAX_FLOW_OUTPUT_FLOWS;
+    }
+    return result.max_flow;
+}
+
+/*
+ * @brief   Run computeMaxFlow() on a thread of its own. The caller can cancel
+ *          the solve or watch its progress through control meanwhile, and
+ *          must keep graph, result, control and workspace alive and leave
+ *          them alone until the future is ready. The parameters are those of
+ *          computeMaxFlow().
+ *
+ * @param [in]  control     Cancellation, deadline and progress of the solve, see
+ *                          solveControl. Only the Ford Fulkerson engines and Dinic
+ *                          stop early.
+ *
+ * @return  Returns a future that becomes ready with the SOLVE_STATUS_* value of the
+ *          solve once result is filled
+ */
+template<class Graph>
+std::future<int> solveMaxFlowAsync(Graph& graph, int engine, int outputs,
+        maxFlowResult<typename Graph::flowType>& result,
+        solveControl<typename Graph::flowType>& control, int thread_count = 1,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL){
+    return std::async(std::launch::async, [&graph, engine, outputs, &result, &control, thread_count, workspace](){
+        computeMaxFlow(graph, engine, outputs, result, thread_count, workspace, &control);
+        return control.getStatus();
+    });
+}
+
+#endif
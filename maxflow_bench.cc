@@ -0,0 +1,188 @@
+/*
+ * The counters cost a thread local load per counted event, which is the same
+ * in every build the output is compared across.
+ */
+#ifndef MAX_FLOW_INSTRUMENTATION
+#define MAX_FLOW_INSTRUMENTATION
+#endif
+
+#include<iostream>
+#include<cstdlib>
+#include<cstring>
+#include<cmath>
+#include<chrono>
+#include<string>
+#include<vector>
+#include<sys/resource.h>
+
+#include "max_flow.h"
+#include "graph_generators.h"
+
+using namespace std;
+
+/* Synthetic graph families the benchmark can generate */
+#define BENCH_LAYERED 0
+#define BENCH_AK 1
+#define BENCH_RMF 2
+#define BENCH_GRID 3
+#define BENCH_BIPARTITE 4
+#define BENCH_POWER_LAW 5
+#define BENCH_FAMILY_COUNT 6
+
+static const char* const benchFamilyNames[BENCH_FAMILY_COUNT] = {
+    "layered", "ak", "rmf", "grid", "bipartite", "powerlaw"
+};
+
+/*
+ * @brief   Generate a graph of a family with about size nodes.
+ *
+ * @return  Returns the finalized residual graph, allocated with new
+ */
+static residualGraph<>* buildBenchGraph(int family, int size, unsigned seed){
+    switch(family){
+    case BENCH_AK:
+        return buildAkGraph(max(1, size / 2));
+    case BENCH_RMF: {
+        /* Frames of a x a nodes, half as many frames as the side */
+        int a = max(2, (int)cbrt(2.0 * size));
+        return buildRmfGraph(a, max(1, a / 2), 1000, seed);
+    }
+    case BENCH_GRID: {
+        int side = max(1, (int)sqrt((double)size));
+        return buildWashingtonGrid(side, side, 1000, seed);
+    }
+    case BENCH_BIPARTITE:
+        return buildBipartiteGraph(max(1, size / 2), max(1, size / 2), 4, seed);
+    case BENCH_POWER_LAW:
+        return buildPowerLawGraph(max(8, size), 4, 1000, seed);
+    default:
+        return buildLayeredGraph(16, max(1, size / 16), 4, seed);
+    }
+}
+
+/* Peak resident set size of the process so far, in kilobytes */
+static long getPeakRssKilobytes(){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/*
+ * @brief   Parse a comma separated list of names, or "all", into ids.
+ *
+ * @return  False if a name is not one of the names
+ */
+static bool parseNameList(const char* list, const char* const* names, int name_count, vector<int>& ids){
+    if(strcmp(list, "all") == 0){
+        for(int i = 0; i < name_count; i++){
+            ids.push_back(i);
+        }
+        return true;
+    }
+    string text(list);
+    for(size_t begin = 0; begin <= text.size();){
+        size_t end = text.find(',', begin);
+        if(end == string::npos){
+            end = text.size();
+        }
+        string name = text.substr(begin, end - begin);
+        int id = INVALID_PARENT;
+        for(int i = 0; i < name_count; i++){
+            if(name == names[i]){
+                id = i;
+            }
+        }
+        if(id == INVALID_PARENT){
+            cerr<<"Unknown name "<<name<<"\n";
+            return false;
+        }
+        ids.push_back(id);
+        begin = end + 1;
+    }
+    return true;
+}
+
+/*
+ * @brief   Benchmark of the max flow engines on synthetic graphs. For every
+ *          family and every size from min size to max size, doubling, each
+ *          engine solves a fresh copy of the same graph repeat times. Every
+ *          run is printed as one JSON object of a JSON array on the standard
+ *          output, with the wall time of the solve alone, the peak resident
+ *          set size of the process so far and the solver counters of the run,
+ *          so the output of two builds can be compared.
+ *
+ *          Build: g++ -std=c++17 -O2 -pthread maxflow_bench.cc -o maxflow_bench
+ *          Usage: maxflow_bench [families|all] [engines|all] [min size] [max size] [repeat] [threads]
+ *
+ *          Families and engines are comma separated lists of the names in
+ *          benchFamilyNames and maxFlowEngineNames. The default is every family
+ *          with fordfulkerson,dinic,pushrelabel,bk on 1024 to 16384 nodes.
+ *
+ * @return Returns 0 on success, 1 on bad arguments or if the engines disagree on a flow value
+ */
+int main(int argc, char** argv){
+    vector<int> families;
+    vector<int> engines;
+    if(!parseNameList(argc > 1 ? argv[1] : "all", benchFamilyNames, BENCH_FAMILY_COUNT, families)
+            || !parseNameList(argc > 2 ? argv[2] : "fordfulkerson,dinic,pushrelabel,bk",
+                maxFlowEngineNames, MAX_FLOW_ENGINE_COUNT, engines)){
+        return 1;
+    }
+    const int min_size = argc > 3 ? atoi(argv[3]) : 1024;
+    const int max_size = argc > 4 ? atoi(argv[4]) : 16384;
+    const int repeat = argc > 5 ? atoi(argv[5]) : 1;
+    const int threads = argc > 6 ? atoi(argv[6]) : 1;
+    if(min_size < 1 || max_size < min_size || repeat < 1){
+        cerr<<"Usage: maxflow_bench [families|all] [engines|all] [min size] [max size] [repeat] [threads]\n";
+        return 1;
+    }
+
+    solverWorkspace<> workspace;
+    bool first = true;
+    cout<<"[\n";
+    for(size_t f = 0; f < families.size(); f++){
+        for(int size = min_size; size <= max_size; size *= 2){
+            long long expected_flow = INVALID_PARENT;
+            for(size_t e = 0; e < engines.size(); e++){
+                for(int run = 0; run < repeat; run++){
+                    residualGraph<>* graph = buildBenchGraph(families[f], size, 1);
+                    solverCounters counters;
+                    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                    long long max_flow;
+                    {
+                        solverCountersScope scope(&counters);
+                        max_flow = solveMaxFlow(*graph, engines[e], threads, &workspace);
+                    }
+                    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                    cout<<(first ? "" : ",\n")<<"  {\"family\": \""<<benchFamilyNames[families[f]]
+                        <<"\", \"size\": "<<size
+                        <<", \"nodes\": "<<graph->getNodeCount()
+                        <<", \"edges\": "<<graph->getEdgeCount()
+                        <<", \"engine\": \""<<maxFlowEngineNames[engines[e]]
+                        <<"\", \"threads\": "<<threads
+                        <<", \"run\": "<<run
+                        <<", \"max_flow\": "<<max_flow
+                        <<", \"seconds\": "<<seconds
+                        <<", \"peak_rss_kb\": "<<getPeakRssKilobytes()
+                        <<", \"augmentations\": "<<counters.augmentations
+                        <<", \"arc_scans\": "<<counters.arcs_scanned
+                        <<", \"counters\": ";
+                    writeSolverCountersJson(cout, counters);
+                    cout<<"}";
+                    first = false;
+                    delete graph;
+                    if(expected_flow == INVALID_PARENT){
+                        expected_flow = max_flow;
+                    } else if(max_flow != expected_flow){
+                        cout<<"\n]\n";
+                        cerr<<"Flow mismatch on "<<benchFamilyNames[families[f]]<<" "<<size<<": "
+                            <<maxFlowEngineNames[engines[e]]<<" found "<<max_flow<<", expected "<<expected_flow<<"\n";
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+    cout<<"\n]\n";
+    return 0;
+}
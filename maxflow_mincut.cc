@@ -1,18 +1,19 @@
 #include<iostream>
-#include<vector>
-#include<queue>
-#include<climits>
+#include<cstring>
+#include<cstdlib>
+#include<memory>
 
-#define SOURCE_NODE_ID 0
-#define TARGET_NODE_ID 5
-#define NODE_COUNT 6
-#define INVALID_PARENT -1
+#include "max_flow.h"
+#include "graph_file.h"
+#include "dimacs_parser.h"
+
+using namespace std;
 
 /*
- * Node id to name mapping
+ * Node id to name mapping of the example network
  *
- * s --> 0 
- * w --> 1 
+ * s --> 0
+ * w --> 1
  * x --> 2
  * z --> 3
  * y --> 4
@@ -20,288 +21,128 @@
  *
  */
 
-static const char* nodeName[NODE_COUNT] = {"s", "w", "x", "z", "y", "t"};
+static const char* nodeName[] = {"s", "w", "x", "z", "y", "t"};
 
-using namespace std;
+/* Output modes on the command line, indexed by MAX_FLOW_OUTPUT_* flags */
+static const char* outputModeNames[] = {"value", "cut", "flows", "all"};
 
-/* 
- * @brief    This class represents those nodes of the residual graphs that
- *          appear in the augmenting paths from source to target.
+/*
+ * @brief   Run the chosen max flow engine on a graph and print the results
+ *          asked for. All printing happens here, after the solve.
  *
+ * @return Returns 0 on success
  */
-class residualGraphNode{
-public:
-    residualGraphNode(int id, int parent_id){
-        id_ = id;
-        parent_id_ = parent_id;
+template<class Graph>
+int solveAndPrint(Graph& graph, const char* engine_name, int threads, int outputs){
+    const bool preflow = engine_name != NULL && strcmp(engine_name, "preflow") == 0;
+    const int engine = preflow ? MAX_FLOW_PUSH_RELABEL
+        : engine_name != NULL ? maxFlowEngineFromName(engine_name) : MAX_FLOW_FORD_FULKERSON;
+    if(engine == INVALID_PARENT){
+        cerr<<"Unknown max flow engine "<<engine_name<<"\n";
+        return 1;
     }
-    int getId(){return id_;}
-    void setId(int id){id_ = id;}
-    int getParentId(){return parent_id_;}
-    void setParentId(int parent_id){parent_id_ = parent_id;}
-private:
-    int id_; /* Id of node */
-    int parent_id_; /* Id of parent node in an augmenting path */
-};
-
-/* 
- * @breif    This class represents edges in a residual graph.
- *
- */
-class residualGraphEdge{
-public:
-    residualGraphEdge(int residual_capacity, int original_capacity){
-        residual_capacity_ = residual_capacity;
-        original_capacity_ = original_capacity;
+    if(preflow){
+        /* Only the flow value and the cut are needed, skip turning the preflow into a flow */
+        outputs &= ~MAX_FLOW_OUTPUT_FLOWS;
     }
-    int getResidualCapacity(){return residual_capacity_;}
-    void setResidualCapacity(int residual_capacity){residual_capacity_ = residual_capacity;}
-    int getOriginalCapacity(){return original_capacity_;}
-    void setOriginalCapacity(int original_capacity){original_capacity_ = original_capacity;}
-private:
-    int residual_capacity_; /* residual capacity of an edge */
-    int original_capacity_; /*  Original capacity of an edge */
-};
 
-/*
- *  @brief  BFS implementation that runs on a graph to find out a path between
- *          the source node and the target node.
- *
- *  @param[in]             graph    The graph to traverse.
- *  @param[out] (optional) sPath    The nodes reachable from the source after bfs is done. The default value is NULL.
- *  @param[out] (optional) tPath    The nodes not reachable from the source after bfs is done. The default value is NULL.
- *  @param[out] (optional) outPath  Path from source to target. The default value is NULL.
- *  
- *  @return True if the target node is reachable from the source
- *
- */
-bool bfs(vector<vector<residualGraphEdge> > &graph,
-        vector<int>* sPath = NULL,
-        vector<int>* tPath = NULL,
-        vector<residualGraphNode> *outPath = NULL)
-{
-
-    vector<bool> trav; /* For each node in the graph, we will store true if we can reach from the source */
-    for(int i = 0; i< NODE_COUNT; i++){
-        /* Initialize with false value for each node */
-        trav.push_back(false);
+    maxFlowResult<typename Graph::flowType> result;
+    computeMaxFlow(graph, engine, outputs, result, threads);
+    if((result.outputs & MAX_FLOW_OUTPUT_FLOWS) != 0){
+        printEdgeFlows(graph);
     }
-    
-    queue<int> bfs_q;
-    bfs_q.push(SOURCE_NODE_ID); /* Start with the cource */
-    trav[SOURCE_NODE_ID] = true;
-    while(!bfs_q.empty()){
-        int node_id = bfs_q.front();
-        bfs_q.pop();
-        for(int next_node = 0; next_node < NODE_COUNT; next_node++){
-            if(!trav.at(next_node) && graph[node_id][next_node].getResidualCapacity() > 0){
-                /* 
-                 * This is an unvisited node and the edge it shares with the previous node
-                 * has some residual capacity value. So Mark it traversed and mark the previous
-                 * node as it's parent. 
-                 */
-                trav[next_node] = true;
-                if(outPath != NULL) {
-                    outPath->at(next_node).setParentId(node_id);
-                }
-                bfs_q.push(next_node);
-            }
-        }
+    cout<<"Max flow found after running "<<(preflow ? "push-relabel phase one" : maxFlowEngineTitles[engine])
+        <<": "<<flowToString(result.max_flow)<<"\n";
 
-    }
-    /* 
-     * This part is used to compute the s-t cut.
-     * Now that we know, which nodes can be reached 
-     * from the source and which nodes can not be,
-     * store them in the respective buffers. Use this
-     * code when there is no augmenting path left.
+    /*
+     * Now that the max flow engine has been executed, our residual graph does not have
+     * any augmenting path, so the s-t cut vertices sets are known.
      */
-    if (sPath != NULL && tPath != NULL) {
-
-        for(int i = 0; i< NODE_COUNT; i++){
-            if(trav.at(i)){
-                sPath->push_back(i);
-            } else {
-                tPath->push_back(i);
-            }
+    if((outputs & MAX_FLOW_OUTPUT_CUT) != 0){
+        if((result.outputs & MAX_FLOW_OUTPUT_CUT) == 0){
+            cout<<"The residual graph still has one or more augmenting paths. Failed to compute minimum s-t cut.\n";
+            return 1;
         }
+        printMinCut(graph, result.s_side);
     }
 
-    return trav.at(TARGET_NODE_ID);
+    return 0;
 }
+
 /*
- * @brief   Implementation of the Ford Fulkerson algorithm to compute
- *          the maximum flow possible in a flow network
+ * @brief   Main function to call the max flow and MinCut
+ *          functions. The input graph is hard coded unless a graph
+ *          file is given: a file written by writeGraphFile() is mapped
+ *          and solved in place, anything else is parsed as a DIMACS
+ *          max flow problem with the given number of threads. The
+ *          other inputs are the optional
+ *          name of the max flow engine, the number of threads for
+ *          Ford Fulkerson, parallel push-relabel and the minimum cut,
+ *          0 meaning all hardware threads, and what to print: only the
+ *          flow value, the value and the cut, the value and the edge
+ *          flows, or all of them.
  *
- * @param [in]  residualGraph   A flow network transformed into a residual graph
- *                              with back edges
+ *          Usage: maxflow_mincut [fordfulkerson|dinic|pushrelabel|preflow|bk|parallelpushrelabel|scaling|bidirectional] [threads] [graph file|-] [value|cut|flows|all]
  *
- * @return  Returns the maximum flow possible in that flow network
+ * @return Returns 0 on success
  */
-int fordFulkerson(
-        vector<vector<residualGraphEdge> > &residualGraph)
-
-{
-    vector<residualGraphNode> augmentingPath; /* We call BFS and store the augmenting path at every stage*/
-    int max_flow = 0;
-
-    for(int i = 0; i< NODE_COUNT; i++){
-        /* Initialize the path */
-        augmentingPath.push_back(residualGraphNode(i, INVALID_PARENT));
+int main(int argc, char** argv){
+    const char* engine_name = argc > 1 ? argv[1] : NULL;
+    const int threads = argc > 2 ? atoi(argv[2]) : 1;
+    int outputs = MAX_FLOW_OUTPUT_ALL;
+    if(argc > 4){
+        for(outputs = MAX_FLOW_OUTPUT_ALL; outputs >= 0 && strcmp(argv[4], outputModeNames[outputs]) != 0; outputs--){
+        }
+        if(outputs < 0){
+            cerr<<"Unknown output mode "<<argv[4]<<"\n";
+            return 1;
+        }
     }
-
-
-    while(bfs(residualGraph, NULL, NULL, &augmentingPath)){
-        /* An augmenting path was found */
-        int min_flow_in_path = INT_MAX;
-
-        /* 
-         * Compute the minimum capacity value in this augmenting path.
-         * This should be the maximum amount of flow possible using
-         * this path.
-         */
-        for(int node_id = TARGET_NODE_ID; node_id != SOURCE_NODE_ID;){
-            int parent_node_id = augmentingPath[node_id].getParentId();
-            if(min_flow_in_path> residualGraph[parent_node_id][node_id].getResidualCapacity()) {
-                min_flow_in_path = residualGraph[parent_node_id][node_id].getResidualCapacity();
+    if(argc > 3 && strcmp(argv[3], "-") != 0){
+        if(isGraphFile(argv[3])){
+            mappedResidualGraph mapped_graph;
+            if(!mapped_graph.open(argv[3])){
+                return 1;
             }
-            node_id = parent_node_id;
+            return solveAndPrint(mapped_graph, engine_name, threads, outputs);
         }
-        /* Update the max_flow value for this path. */
-        max_flow += min_flow_in_path;
-
-        for(int node_id = TARGET_NODE_ID; node_id != SOURCE_NODE_ID;){
-            int parent_node_id = augmentingPath[node_id].getParentId();
-            augmentingPath[node_id].setParentId(INVALID_PARENT);
-            /* 
-             * Update the edges and the back edges with the max poossible flow found for this
-             * path. So we add the max flow value for this path to the back edge capacities
-             * and subtract the value from the edges.
-             */
-            residualGraph[parent_node_id][node_id].setResidualCapacity(
-                    residualGraph[parent_node_id][node_id].getResidualCapacity() - min_flow_in_path
-                    );
-            residualGraph[node_id][parent_node_id].setResidualCapacity(
-                    residualGraph[node_id][parent_node_id].getResidualCapacity() + min_flow_in_path
-                    );
-            node_id = parent_node_id;
+        dimacsParseStats stats;
+        unique_ptr<residualGraph<> > dimacs_graph(loadDimacsGraph(argv[3], threads, &stats));
+        if(!dimacs_graph){
+            return 1;
         }
+        cout<<"Parsed "<<stats.bytes / 1e6<<" MB in "<<stats.seconds<<" s: "<<stats.megabytes_per_second<<" MB/s\n";
+        return solveAndPrint(*dimacs_graph, engine_name, threads, outputs);
     }
 
-    /*
-     * Now print the flows for all the edges that sum up to the maximum flow.
-     * The difference between the residual flow and the original flow should be answer
-     * for each edge.
-     */
-
-    cout<< "Printing flows through all the edges that sum up to the maximum flow.\n";
-    cout<< "Flow through s->w: "<<residualGraph[0][1].getOriginalCapacity()-residualGraph[0][1].getResidualCapacity()<<"\n";
-    cout<< "Flow through s->x: "<<residualGraph[0][2].getOriginalCapacity()-residualGraph[0][2].getResidualCapacity()<<"\n";
-    cout<< "Flow through s->z: "<<residualGraph[0][3].getOriginalCapacity()-residualGraph[0][3].getResidualCapacity()<<"\n";
-    cout<< "Flow through w->y: "<<residualGraph[1][4].getOriginalCapacity()-residualGraph[1][4].getResidualCapacity()<<"\n";
-    cout<< "Flow through w->t: "<<residualGraph[1][5].getOriginalCapacity()-residualGraph[1][5].getResidualCapacity()<<"\n";
-    cout<< "Flow through x->w: "<<residualGraph[2][1].getOriginalCapacity()-residualGraph[2][1].getResidualCapacity()<<"\n";
-    cout<< "Flow through x->z: "<<residualGraph[2][3].getOriginalCapacity()-residualGraph[2][3].getResidualCapacity()<<"\n";
-    cout<< "Flow through x->y: "<<residualGraph[2][4].getOriginalCapacity()-residualGraph[2][4].getResidualCapacity()<<"\n";
-    cout<< "Flow through z->y: "<<residualGraph[3][4].getOriginalCapacity()-residualGraph[3][4].getResidualCapacity()<<"\n";
-    cout<< "Flow through z->t: "<<residualGraph[3][5].getOriginalCapacity()-residualGraph[3][5].getResidualCapacity()<<"\n";
-    cout<< "Flow through y->w: "<<residualGraph[4][5].getOriginalCapacity()-residualGraph[4][5].getResidualCapacity()<<"\n";
+    const int node_count = sizeof(nodeName) / sizeof(nodeName[0]);
+    const int edge_count = 11;
 
-    return max_flow;
-}
-
-/*
- * @brief   Find the minimum s-t cut of the input residual graph. Print the s and t vertices sets 
- *          on the standard output console.
- * @param[in] graph A residual graph
- *
- */
-
-void findMinCut(vector<vector<residualGraphEdge> >& graph){
-
-    vector<int> sPath;
-    vector<int> tPath;
-    if (bfs(graph, &sPath, &tPath)){
-        cout<<"The residual graph still has one or more augmenting paths. Failed to compute minimum s-t cut.\n";
-        return;
-    }
-    cout<<"\nMinimum s-t cut \n"; 
-    cout<<"Nodes at the s side:\n";
-    for(vector<int>::iterator itr = sPath.begin(); itr!= sPath.end(); itr++){
-        cout <<nodeName[*itr]<<" ";
+    /* Container to store the input graph, s is the source and t the target */
+    residualGraph<> graph(node_count, 0, 5, edge_count);
+    for(int i = 0; i < node_count; i++){
+        graph.setNodeName(i, nodeName[i]);
     }
-    cout<<"\n";
-
-    cout<<"Nodes at the t side:\n";
-    for(vector<int>::iterator itr = tPath.begin(); itr != tPath.end(); itr++){
-        cout <<nodeName[*itr]<<" ";
-    }
-    cout<<"\n";
-}
 
-/*
- * @brief   Main function to call the Ford Fulkerson and MinCut
- *          functions. The input graph is hard coded. So it doesn't
- *          take any other input.
- *
- * @return Returns 0 on success
- */
-int main(){
-    vector<vector<residualGraphEdge> > graph; /* Container to store the input graph */
-
-    /* 
-     * Create the input graph as a residual graph. We add back edges with 0 capacity
-     * to begin with and update them later.
-     */
-    for(int i = 0; i< NODE_COUNT; i++){
-        vector<residualGraphEdge> edge_set_to_node;
-        for(int i = 0; i< NODE_COUNT; i++){
-            /* Initialize all the edges with 0 capacity */
-            edge_set_to_node.push_back(residualGraphEdge(0,0));
-        }
-        graph.push_back(edge_set_to_node);
-    }
-
-    /* 
-     * Update actual graph edges with their residual capacities.
-     * Initially it is same as the original capacity.
+    /*
+     * Create the input graph as a residual graph. Every edge gets a back edge
+     * with 0 capacity when the graph is finalized; the back edges are updated
+     * later while augmenting.
      */
-    graph[0][1].setResidualCapacity(4); /* s->w */
-    graph[0][2].setResidualCapacity(7); /* s->x */
-    graph[0][3].setResidualCapacity(10); /* s->z */
-    graph[1][4].setResidualCapacity(2); /* w->y */
-    graph[1][5].setResidualCapacity(10); /* w->t */
-    graph[2][1].setResidualCapacity(2); /* x->w */
-    graph[2][3].setResidualCapacity(2); /* x->z */
-    graph[2][4].setResidualCapacity(10); /* x->y */
-    graph[3][4].setResidualCapacity(2); /* z->y */
-    graph[3][5].setResidualCapacity(6); /* z->t */
-    graph[4][5].setResidualCapacity(7); /* y->t */
+    graph.addEdge(0, 1, 4); /* s->w */
+    graph.addEdge(0, 2, 7); /* s->x */
+    graph.addEdge(0, 3, 10); /* s->z */
+    graph.addEdge(1, 4, 2); /* w->y */
+    graph.addEdge(1, 5, 10); /* w->t */
+    graph.addEdge(2, 1, 2); /* x->w */
+    graph.addEdge(2, 3, 2); /* x->z */
+    graph.addEdge(2, 4, 10); /* x->y */
+    graph.addEdge(3, 4, 2); /* z->y */
+    graph.addEdge(3, 5, 6); /* z->t */
+    graph.addEdge(4, 5, 7); /* y->t */
+    graph.finalize();
 
-    /* Now update the original capacity of the edges */
-   
-    graph[0][1].setOriginalCapacity(4); /* s->w */
-    graph[0][2].setOriginalCapacity(7); /* s->x */
-    graph[0][3].setOriginalCapacity(10); /* s->z */
-    graph[1][4].setOriginalCapacity(2); /* w->y */
-    graph[1][5].setOriginalCapacity(10); /* w->t */
-    graph[2][1].setOriginalCapacity(2); /* x->w */
-    graph[2][3].setOriginalCapacity(2); /* x->z */
-    graph[2][4].setOriginalCapacity(10); /* x->y */
-    graph[3][4].setOriginalCapacity(2); /* z->y */
-    graph[3][5].setOriginalCapacity(6); /* z->t */
-    graph[4][5].setOriginalCapacity(7); /* y->t */
-	
 	/* There are no self loops, so we do not need to modify this graph */
 
-    cout<<"Max flow found after running Ford Fulkerson algorithm: "<<fordFulkerson(graph)<<"\n";
-
-    /* 
-     * Now that the Ford Fulkerson algorithm has been executed, our residual graph does not have
-     * any augmenting path. Now use this graph to get the s-t cut vertices sets.
-     */
-
-    findMinCut(graph);
-    
-    return 0;
+    return solveAndPrint(graph, engine_name, threads, outputs);
 }
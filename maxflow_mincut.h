@@ -0,0 +1,686 @@
+#ifndef MAXFLOW_MINCUT_H
+#define MAXFLOW_MINCUT_H
+
+#include<algorithm>
+#include<iostream>
+#include<vector>
+#include<climits>
+#include<memory>
+#include<thread>
+
+#include "residual_graph.h"
+#include "min_cut_bitmap.h"
+#include "parallel_bfs.h"
+#include "simd_scan.h"
+#include "solver_workspace.h"
+#include "solver_counters.h"
+#include "solve_control.h"
+
+#define MIN_CUT_FROM_SOURCE 0 /* s side is what the source can reach */
+#define MIN_CUT_FROM_TARGET 1 /* t side is what can reach the target */
+
+/* Augmenting path orders fordFulkerson() can use */
+#define FORD_FULKERSON_SHORTEST_PATH 0 /* Shortest augmenting path first */
+#define FORD_FULKERSON_CAPACITY_SCALING 1 /* Shortest path of at least delta capacity, delta halving each phase */
+#define FORD_FULKERSON_BIDIRECTIONAL 2 /* Shortest augmenting path first, searched from both ends */
+
+/*
+ *  @brief  BFS implementation that runs on a graph to find out a path between
+ *          the source node and the target node. Without sPath and tPath the
+ *          search stops as soon as the target is reached.
+ *
+ *  @param[in]             graph    The graph to traverse.
+ *  @param[out] (optional) sPath    The nodes reachable from the source after bfs is done. The default value is NULL.
+ *  @param[out] (optional) tPath    The nodes not reachable from the source after bfs is done. The default value is NULL.
+ *  @param[in]  (optional) workspace  Visited flags, queue and parents of the search. It is left
+ *                                  holding the search tree, so the path from source to target
+ *                                  can be read from its parents. NULL uses a temporary one. The
+ *                                  default value is NULL.
+ *  @param[in]  (optional) floor    Only edges with more residual capacity than floor are followed.
+ *                                  The default value is 0.
+ *
+ *  @return True if the target node is reachable from the source
+ *
+ */
+template<class Graph>
+bool bfs(Graph &graph,
+        std::vector<int>* sPath = NULL,
+        std::vector<int>* tPath = NULL,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL,
+        typename Graph::capacityType floor = 0)
+{
+    const int node_count = graph.getNodeCount();
+    const int sink = graph.getSink();
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? node_count : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& search = workspace != NULL ? *workspace : local_workspace;
+    /* The cut needs every node reachable from the source, a path only the target */
+    const bool full_search = sPath != NULL && tPath != NULL;
+    SOLVER_PHASE_TIMER(SOLVER_PHASE_SEARCH);
+    SOLVER_COUNT(bfs_calls, 1);
+
+    /* Every node starts unvisited, the queue starts empty */
+    search.beginSearch(node_count);
+    search.push(graph.getSource()); /* Start with the cource */
+    search.setVisited(graph.getSource());
+    search.setParent(graph.getSource(), INVALID_PARENT, INVALID_PARENT);
+    while(!search.isQueueEmpty() && (full_search || !search.isVisited(sink))){
+        int node_id = search.pop();
+        SOLVER_COUNT(nodes_dequeued, 1);
+        SOLVER_COUNT(arcs_scanned, graph.getLastEdge(node_id) - graph.getFirstEdge(node_id));
+        forEachResidualArc(graph, node_id, [&](int edge_id){
+            int next_node = graph.getHead(edge_id);
+            if(!search.isVisited(next_node)){
+                /*
+                 * This is an unvisited node and the edge it shares with the previous node
+                 * has some residual capacity value. So Mark it traversed and mark the previous
+                 * node as it's parent.
+                 */
+                search.setVisited(next_node);
+                search.setParent(next_node, node_id, edge_id);
+                search.push(next_node);
+            }
+        }, floor);
+
+    }
+    /*
+     * This part is used to compute the s-t cut.
+     * Now that we know, which nodes can be reached
+     * from the source and which nodes can not be,
+     * store them in the respective buffers. Use this
+     * code when there is no augmenting path left.
+     */
+    if (full_search) {
+
+        for(int i = 0; i< node_count; i++){
+            if(search.isVisited(i)){
+                sPath->push_back(i);
+            } else {
+                tPath->push_back(i);
+            }
+        }
+    }
+
+    return search.isVisited(sink);
+}
+
+/*
+ *  @brief  Search for a shortest augmenting path from both ends at once: from
+ *          the source along residual edges and from the target backwards along
+ *          residual edges, one level at a time on the side with the smaller
+ *          frontier, until the two searches meet. On graphs with a small
+ *          diameter each side only has to go about half way, which visits far
+ *          less nodes than a search from the source alone.
+ *
+ *          Nodes reached from the target keep the next node towards the target
+ *          as parent. Once the searches meet, these are turned around, so the
+ *          path can be read from the parents from the target back to the
+ *          source as after bfs().
+ *
+ *  @param[in]             graph      The graph to traverse.
+ *  @param[in]  (optional) workspace  Search buffers, left holding the path in its parents. NULL
+ *                                    uses a temporary one. The default value is NULL.
+ *
+ *  @return True if the target node is reachable from the source
+ */
+template<class Graph>
+bool bidirectionalBfs(Graph& graph, solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL){
+    const int node_count = graph.getNodeCount();
+    const int source = graph.getSource();
+    const int sink = graph.getSink();
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? node_count : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& search = workspace != NULL ? *workspace : local_workspace;
+
+    SOLVER_PHASE_TIMER(SOLVER_PHASE_SEARCH);
+    SOLVER_COUNT(bfs_calls, 1);
+    search.beginSearch(node_count);
+    search.setVisited(source);
+    search.setReachedFromTarget(source, false);
+    search.setParent(source, INVALID_PARENT, INVALID_PARENT);
+    search.push(source);
+    if(source == sink){
+        return true;
+    }
+    search.setVisited(sink);
+    search.setReachedFromTarget(sink, true);
+    search.setParent(sink, INVALID_PARENT, INVALID_PARENT);
+    search.pushReverse(sink);
+
+    /* Residual edge where the searches met, from a node of the source side */
+    int meeting_node = INVALID_PARENT;
+    int meeting_edge = INVALID_PARENT;
+    while(meeting_edge == INVALID_PARENT && !search.isQueueEmpty() && !search.isReverseQueueEmpty()){
+        if(search.getQueueSize() <= search.getReverseQueueSize()){
+            for(int level_size = search.getQueueSize(); level_size > 0 && meeting_edge == INVALID_PARENT; level_size--){
+                int node_id = search.pop();
+                SOLVER_COUNT(nodes_dequeued, 1);
+                SOLVER_COUNT(arcs_scanned, graph.getLastEdge(node_id) - graph.getFirstEdge(node_id));
+                forEachResidualArc(graph, node_id, [&](int edge_id){
+                    int next_node = graph.getHead(edge_id);
+                    if(!search.isVisited(next_node)){
+                        search.setVisited(next_node);
+                        search.setReachedFromTarget(next_node, false);
+                        search.setParent(next_node, node_id, edge_id);
+                        search.push(next_node);
+                    } else if(search.isReachedFromTarget(next_node) && meeting_edge == INVALID_PARENT){
+                        meeting_node = node_id;
+                        meeting_edge = edge_id;
+                    }
+                });
+            }
+        } else {
+            for(int level_size = search.getReverseQueueSize(); level_size > 0 && meeting_edge == INVALID_PARENT; level_size--){
+                int node_id = search.popReverse();
+                SOLVER_COUNT(nodes_dequeued, 1);
+                SOLVER_COUNT(arcs_scanned, graph.getLastEdge(node_id) - graph.getFirstEdge(node_id));
+                for(int edge_id = graph.getFirstEdge(node_id); edge_id < graph.getLastEdge(node_id); edge_id++){
+                    /* prev_node can reach node_id if the paired edge prev_node->node_id has residual capacity */
+                    int prev_node = graph.getHead(edge_id);
+                    int step_edge = graph.getReverse(edge_id);
+                    if(graph.getResidualCapacity(step_edge) <= 0){
+                        continue;
+                    }
+                    if(!search.isVisited(prev_node)){
+                        search.setVisited(prev_node);
+                        search.setReachedFromTarget(prev_node, true);
+                        search.setParent(prev_node, node_id, step_edge);
+                        search.pushReverse(prev_node);
+                    } else if(!search.isReachedFromTarget(prev_node)){
+                        meeting_node = prev_node;
+                        meeting_edge = step_edge;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    if(meeting_edge == INVALID_PARENT){
+        return false;
+    }
+
+    /* Turn the target side around, each node gets the node before it on the path as parent */
+    int prev_node = meeting_node;
+    int prev_edge = meeting_edge;
+    for(int node_id = graph.getHead(meeting_edge); node_id != INVALID_PARENT;){
+        int next_node = search.getParentNode(node_id);
+        int next_edge = search.getParentEdge(node_id);
+        search.setParent(node_id, prev_node, prev_edge);
+        prev_node = node_id;
+        prev_edge = next_edge;
+        node_id = next_node;
+    }
+    return true;
+}
+
+/*
+ *  @brief  Reverse BFS from the target node. It follows residual edges backwards
+ *          and so finds every node that can still reach the target.
+ *
+ *  @param[out] (optional) sPath    The nodes that can not reach the target. The default value is NULL.
+ *  @param[out] (optional) tPath    The nodes that can reach the target. The default value is NULL.
+ *  @param[in]  (optional) workspace  Visited flags and queue of the search, NULL uses a temporary
+ *                                  one. The default value is NULL.
+ *
+ *  @return True if the source node can reach the target
+ */
+template<class Graph>
+bool reverseBfs(Graph &graph,
+        std::vector<int>* sPath = NULL,
+        std::vector<int>* tPath = NULL,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL)
+{
+    const int node_count = graph.getNodeCount();
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? node_count : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& search = workspace != NULL ? *workspace : local_workspace;
+
+    SOLVER_PHASE_TIMER(SOLVER_PHASE_SEARCH);
+    SOLVER_COUNT(bfs_calls, 1);
+    search.beginSearch(node_count);
+    search.push(graph.getSink());
+    search.setVisited(graph.getSink());
+    while(!search.isQueueEmpty()){
+        int node_id = search.pop();
+        SOLVER_COUNT(nodes_dequeued, 1);
+        SOLVER_COUNT(arcs_scanned, graph.getLastEdge(node_id) - graph.getFirstEdge(node_id));
+        for(int edge_id = graph.getFirstEdge(node_id); edge_id < graph.getLastEdge(node_id); edge_id++){
+            int prev_node = graph.getHead(edge_id);
+            /* prev_node can reach node_id if the paired edge prev_node->node_id has residual capacity */
+            if(!search.isVisited(prev_node) && graph.getResidualCapacity(graph.getReverse(edge_id)) > 0){
+                search.setVisited(prev_node);
+                search.push(prev_node);
+            }
+        }
+    }
+
+    if (sPath != NULL && tPath != NULL) {
+        for(int i = 0; i< node_count; i++){
+            if(search.isVisited(i)){
+                tPath->push_back(i);
+            } else {
+                sPath->push_back(i);
+            }
+        }
+    }
+
+    return search.isVisited(graph.getSource());
+}
+
+/*
+ * @brief   Print the flow through every input edge of a residual graph that
+ *          a max flow engine has run on. The difference between the residual
+ *          flow and the original flow should be the answer for each edge.
+ *          Back edges have 0 original capacity and are skipped.
+ *
+ * @param[in] graph A residual graph
+ */
+template<class Graph>
+void printEdgeFlows(Graph& graph){
+    typedef typename Graph::flowType flowType;
+    std::cout<< "Printing flows through all the edges that sum up to the maximum flow.\n";
+    for(int node_id = 0; node_id < graph.getNodeCount(); node_id++){
+        for(int edge_id = graph.getFirstEdge(node_id); edge_id < graph.getLastEdge(node_id); edge_id++){
+            if(graph.getOriginalCapacity(edge_id) > 0){
+                std::cout<< "Flow through "<<graph.getNodeName(node_id)<<"->"<<graph.getNodeName(graph.getHead(edge_id))<<": "
+                    <<flowToString((flowType)graph.getOriginalCapacity(edge_id) - (flowType)graph.getResidualCapacity(edge_id))<<"\n";
+            }
+        }
+    }
+}
+
+/*
+ * @brief   Find an augmenting path and store it in the parent arrays of the
+ *          workspace, with the serial bfs() or, if parallel_search is not
+ *          NULL, with the parallel BFS. The parallel search stops once the
+ *          target is reached and only the nodes on the path are written.
+ *
+ * @return True if the target node is reachable from the source
+ */
+template<class Graph>
+bool findAugmentingPath(Graph& graph,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>& workspace,
+        parallelBfs<Graph>* parallel_search)
+{
+    if(parallel_search == NULL){
+        return bfs(graph, NULL, NULL, &workspace);
+    }
+    if(!parallel_search->run(graph, true)){
+        return false;
+    }
+    /* Only bfs() sizes the workspace, it may not have been used yet */
+    workspace.reserve(graph.getNodeCount());
+    for(int node_id = graph.getSink(); node_id != graph.getSource();){
+        int edge_id = parallel_search->getParentEdge(node_id);
+        int parent_node_id = graph.getHead(graph.getReverse(edge_id));
+        workspace.setParent(node_id, parent_node_id, edge_id);
+        node_id = parent_node_id;
+    }
+    return true;
+}
+
+/*
+ * @brief   Implementation of the Ford Fulkerson algorithm to compute
+ *          the maximum flow possible in a flow network
+ *
+ *          With FORD_FULKERSON_CAPACITY_SCALING the augmenting paths are found
+ *          in phases. delta starts at the largest power of two not above the
+ *          widest edge out of the source, a phase only follows edges with at
+ *          least delta residual capacity and delta halves after each phase,
+ *          the last one following every edge. This takes O(E log U) augmenting
+ *          paths for capacities up to U, instead of paths depending on E and V
+ *          only through the flow value, which pays off for large capacities.
+ *          Capacities that are not integers take edges above delta instead.
+ *          FORD_FULKERSON_BIDIRECTIONAL finds each path with bidirectionalBfs().
+ *
+ * @param [in]  residualGraph   A flow network transformed into a residual graph
+ *                              with back edges
+ * @param [in]  bfs_threads     Threads for the augmenting path search. 1 runs the
+ *                              serial bfs(), anything else the parallel BFS with that
+ *                              many threads, 0 meaning all hardware threads. It is held
+ *                              to the hardware threads, and with one left the serial
+ *                              bfs() runs. Scaling
+ *                              only uses it in its last phase, the search from both
+ *                              ends is always serial. The default value is 1.
+ * @param [in]  workspace       Search buffers to use for every augmenting path. Keep
+ *                              one alive across solves to avoid allocating; NULL
+ *                              allocates one for this call. The default value is NULL.
+ * @param [in]  mode            One of the FORD_FULKERSON_* path orders. The default value
+ *                              is FORD_FULKERSON_SHORTEST_PATH.
+ * @param [in]  control         Checked after every augmenting path to stop on cancellation
+ *                              or at a deadline, see solveControl. NULL never stops. The
+ *                              default value is NULL.
+ *
+ * @return  Returns the maximum flow possible in that flow network, the flow found
+ *          so far if control stopped the search
+ */
+template<class Graph>
+typename Graph::flowType fordFulkerson(
+        Graph &residualGraph,
+        int bfs_threads = 1,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL,
+        int mode = FORD_FULKERSON_SHORTEST_PATH,
+        solveControl<typename Graph::flowType>* control = NULL)
+
+{
+    typedef typename Graph::capacityType capacityType;
+    const int source = residualGraph.getSource();
+    const int sink = residualGraph.getSink();
+    /* We call BFS and store the augmenting path at every stage*/
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? residualGraph.getNodeCount() : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& augmentingPath = workspace != NULL ? *workspace : local_workspace;
+    typename Graph::flowType max_flow = 0;
+    if(source == sink){
+        return 0;
+    }
+
+    std::unique_ptr<parallelBfs<Graph> > parallel_search;
+    if(mode != FORD_FULKERSON_BIDIRECTIONAL && parallelBfs<Graph>::getPoolSize(bfs_threads) > 1){
+        parallel_search.reset(new parallelBfs<Graph>(residualGraph.getNodeCount(), bfs_threads));
+    }
+
+    /* Without scaling there is a single phase with delta 1, which follows every edge */
+    capacityType delta = 1;
+    if(mode == FORD_FULKERSON_CAPACITY_SCALING){
+        capacityType widest = 0;
+        for(int edge_id = residualGraph.getFirstEdge(source); edge_id < residualGraph.getLastEdge(source); edge_id++){
+            if(residualGraph.getResidualCapacity(edge_id) > widest){
+                widest = residualGraph.getResidualCapacity(edge_id);
+            }
+        }
+        while(delta <= widest / 2){
+            delta *= 2;
+        }
+    }
+
+    while(true){
+        /* At least delta residual capacity for integers, more than delta otherwise */
+        const capacityType floor = delta > 1 ? (std::is_integral<capacityType>::value ? delta - 1 : delta) : 0;
+        while(floor > 0 ? bfs(residualGraph, NULL, NULL, &augmentingPath, floor)
+                : mode == FORD_FULKERSON_BIDIRECTIONAL ? bidirectionalBfs(residualGraph, &augmentingPath)
+                : findAugmentingPath(residualGraph, augmentingPath, parallel_search.get())){
+            /* An augmenting path was found */
+            SOLVER_PHASE_TIMER(SOLVER_PHASE_AUGMENT);
+            int* path_edges = augmentingPath.getPathEdges();
+            int path_length = 0;
+            for(int node_id = sink; node_id != source; node_id = augmentingPath.getParentNode(node_id)){
+                path_edges[path_length++] = augmentingPath.getParentEdge(node_id);
+            }
+
+            /*
+             * Compute the minimum capacity value in this augmenting path.
+             * This should be the maximum amount of flow possible using
+             * this path.
+             */
+            capacityType min_flow_in_path = minResidual(residualGraph.getResidualCapacities(), path_edges, path_length);
+            SOLVER_COUNT_AUGMENTATION(path_length, min_flow_in_path);
+            /* Update the max_flow value for this path. */
+            max_flow += min_flow_in_path;
+
+            for(int i = 0; i < path_length; i++){
+                int edge_id = path_edges[i];
+                int back_edge = residualGraph.getReverse(edge_id);
+                /*
+                 * Update the edges and the back edges with the max poossible flow found for this
+                 * path. So we add the max flow value for this path to the back edge capacities
+                 * and subtract the value from the edges.
+                 */
+                residualGraph.setResidualCapacity(edge_id, residualGraph.getResidualCapacity(edge_id) - min_flow_in_path);
+                residualGraph.setResidualCapacity(back_edge, residualGraph.getResidualCapacity(back_edge) + min_flow_in_path);
+            }
+            if(control != NULL && control->shouldStop(residualGraph, max_flow)){
+                return max_flow;
+            }
+        }
+        if(delta <= 1){
+            break;
+        }
+        delta /= 2;
+    }
+
+    return max_flow;
+}
+
+/*
+ * @brief   Compute the minimum s-t cut of the input residual graph as a bitmap,
+ *          without any output.
+ *
+ * @param[in]  graph        A residual graph
+ * @param[out] s_side       Resized to the node count, 1 for the nodes of the s side
+ *                          and 0 for those of the t side
+ * @param[in]  cut_mode     MIN_CUT_FROM_SOURCE takes the nodes reachable from the source as the
+ *                          s side and needs a maximum flow. MIN_CUT_FROM_TARGET takes the nodes
+ *                          that can reach the target as the t side, which also works on the
+ *                          maximum preflow left by pushRelabel() in PUSH_RELABEL_PREFLOW_ONLY mode.
+ *                          The default value is MIN_CUT_FROM_SOURCE.
+ * @param[in]  bfs_threads  Threads for the reachability pass, as for fordFulkerson().
+ *                          The default value is 1.
+ * @param[in]  workspace    Search buffers for the serial pass, NULL uses a temporary one.
+ *                          The default value is NULL.
+ *
+ * @return  False if the residual graph still has an augmenting path, so there is no cut yet
+ */
+template<class Graph>
+bool computeMinCut(Graph& graph,
+        std::vector<char>& s_side,
+        int cut_mode = MIN_CUT_FROM_SOURCE,
+        int bfs_threads = 1,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL)
+{
+    const int node_count = graph.getNodeCount();
+    const bool from_target = cut_mode == MIN_CUT_FROM_TARGET;
+    s_side.resize(node_count);
+    bool has_path;
+    if(parallelBfs<Graph>::getPoolSize(bfs_threads) > 1){
+        parallelBfs<Graph> search(node_count, bfs_threads);
+        has_path = search.run(graph, false, from_target);
+        for(int i = 0; i < node_count; i++){
+            /* Forward: visited means s side. Reverse: visited means t side. */
+            s_side[i] = search.isVisited(i) != from_target;
+        }
+        return !has_path;
+    }
+
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? node_count : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& search = workspace != NULL ? *workspace : local_workspace;
+    has_path = from_target ? reverseBfs(graph, NULL, NULL, &search) : bfs(graph, NULL, NULL, &search);
+    for(int i = 0; i < node_count; i++){
+        s_side[i] = search.isVisited(i) != from_target;
+    }
+    return !has_path;
+}
+
+/*
+ * @brief   Compute the minimum s-t cut as a bit packed bitmap, one bit per
+ *          node. With several threads the reachability pass is the parallel
+ *          BFS, whose visited bitmap already is the cut and is copied a word
+ *          at a time.
+ *
+ * @param[in]  graph        A residual graph
+ * @param[out] cut          Reset to the node count, with the bits of the s side set
+ * @param[in]  cut_mode     As for the computeMinCut() above. The default value is
+ *                          MIN_CUT_FROM_SOURCE.
+ * @param[in]  bfs_threads  Threads for the reachability pass, as for fordFulkerson().
+ *                          The default value is 1.
+ * @param[in]  workspace    Search buffers for the serial pass, NULL uses a temporary one.
+ *                          The default value is NULL.
+ *
+ * @return  False if the residual graph still has an augmenting path, so there is no cut yet
+ */
+template<class Graph>
+bool computeMinCut(Graph& graph,
+        minCutBitmap& cut,
+        int cut_mode = MIN_CUT_FROM_SOURCE,
+        int bfs_threads = 1,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL)
+{
+    const int node_count = graph.getNodeCount();
+    const bool from_target = cut_mode == MIN_CUT_FROM_TARGET;
+    /* A reverse search visits the t side, the s side is its complement */
+    const uint64_t flip = from_target ? ~(uint64_t)0 : 0;
+    cut.reset(node_count);
+    uint64_t* words = cut.getWords();
+    bool has_path;
+    if(parallelBfs<Graph>::getPoolSize(bfs_threads) > 1){
+        parallelBfs<Graph> search(node_count, bfs_threads);
+        has_path = search.run(graph, false, from_target);
+        for(int i = 0; i < cut.getWordCount(); i++){
+            words[i] = search.getVisitedWord(i) ^ flip;
+        }
+        cut.clearTail();
+        return !has_path;
+    }
+
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? node_count : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& search = workspace != NULL ? *workspace : local_workspace;
+    has_path = from_target ? reverseBfs(graph, NULL, NULL, &search) : bfs(graph, NULL, NULL, &search);
+    for(int i = 0; i < cut.getWordCount(); i++){
+        uint64_t word = 0;
+        const int first_node = i * 64;
+        const int word_nodes = node_count - first_node < 64 ? node_count - first_node : 64;
+        for(int bit = 0; bit < word_nodes; bit++){
+            word |= (uint64_t)search.isVisited(first_node + bit) << bit;
+        }
+        words[i] = word ^ flip;
+    }
+    cut.clearTail();
+    return !has_path;
+}
+
+/*
+ * @brief   List the input edges that cross a cut from the s side to the t
+ *          side. The nodes are split into one range per thread, each thread
+ *          keeps the edges of its range that cross, and the lists are joined
+ *          in range order, so the edges come in edge id order whatever the
+ *          thread count.
+ *
+ * @param[in]  graph            A residual graph
+ * @param[in]  cut              A cut of it, see computeMinCut()
+ * @param[out] cut_edges        Replaced by the ids of the crossing edges
+ * @param[in]  thread_count     Threads for the filter, 0 means one per hardware thread.
+ *                              The default value is 1.
+ *
+ * @return  Returns the capacity of the cut, the sum of the original capacities of the edges
+ */
+template<class Graph>
+typename Graph::flowType computeCutEdges(Graph& graph, const minCutBitmap& cut,
+        std::vector<int>& cut_edges, int thread_count = 1)
+{
+    typedef typename Graph::flowType flowType;
+    const int node_count = graph.getNodeCount();
+    if(thread_count < 1){
+        thread_count = (int)std::thread::hardware_concurrency();
+    }
+    /* Ranges of whole bitmap words, no point in more threads than words */
+    const int word_count = (node_count + 63) / 64;
+    thread_count = std::max(1, std::min(thread_count, word_count));
+    std::vector<std::vector<int> > thread_edges(thread_count);
+    std::vector<flowType> thread_capacities(thread_count, 0);
+    auto filter = [&](int thread_id){
+        const int first_node = (int)std::min<long long>(node_count, (long long)word_count * thread_id / thread_count * 64);
+        const int last_node = (int)std::min<long long>(node_count, (long long)word_count * (thread_id + 1) / thread_count * 64);
+        std::vector<int>& edges = thread_id == 0 ? cut_edges : thread_edges[thread_id];
+        edges.clear();
+        flowType capacity = 0;
+        for(int node_id = first_node; node_id < last_node; node_id++){
+            if(!cut.isSourceSide(node_id)){
+                continue;
+            }
+            for(int edge_id = graph.getFirstEdge(node_id); edge_id < graph.getLastEdge(node_id); edge_id++){
+                if(graph.getOriginalCapacity(edge_id) > 0 && !cut.isSourceSide(graph.getHead(edge_id))){
+                    edges.push_back(edge_id);
+                    capacity += graph.getOriginalCapacity(edge_id);
+                }
+            }
+        }
+        thread_capacities[thread_id] = capacity;
+    };
+    std::vector<std::thread> threads;
+    for(int i = 1; i < thread_count; i++){
+        threads.push_back(std::thread(filter, i));
+    }
+    filter(0);
+    flowType capacity = thread_capacities[0];
+    for(int i = 1; i < thread_count; i++){
+        threads[i - 1].join();
+        cut_edges.insert(cut_edges.end(), thread_edges[i].begin(), thread_edges[i].end());
+        capacity += thread_capacities[i];
+    }
+    return capacity;
+}
+
+/*
+ * @brief   Flow on every edge of a residual graph that a max flow engine has
+ *          run on, the original minus the residual capacity. A back edge
+ *          holds the negated flow of its input edge.
+ *
+ * @param[in]  graph  A residual graph
+ * @param[out] flows  Resized to the edge count, the flow at each edge id
+ */
+template<class Graph, class Flow>
+void getEdgeFlows(Graph& graph, std::vector<Flow>& flows){
+    flows.resize(graph.getEdgeCount());
+    for(int edge_id = 0; edge_id < graph.getEdgeCount(); edge_id++){
+        /* Subtracted as flows, the capacity type may be unsigned */
+        flows[edge_id] = (Flow)graph.getOriginalCapacity(edge_id) - (Flow)graph.getResidualCapacity(edge_id);
+    }
+}
+
+/*
+ * @brief   Print the s and t vertices sets of a cut computed by computeMinCut()
+ *          on the standard output console.
+ */
+template<class Graph>
+void printMinCut(Graph& graph, const std::vector<char>& s_side){
+    std::cout<<"\nMinimum s-t cut \n";
+    std::cout<<"Nodes at the s side:\n";
+    for(int i = 0; i < graph.getNodeCount(); i++){
+        if(s_side[i]){
+            std::cout <<graph.getNodeName(i)<<" ";
+        }
+    }
+    std::cout<<"\n";
+
+    std::cout<<"Nodes at the t side:\n";
+    for(int i = 0; i < graph.getNodeCount(); i++){
+        if(!s_side[i]){
+            std::cout <<graph.getNodeName(i)<<" ";
+        }
+    }
+    std::cout<<"\n";
+}
+
+/* Same output for a cut computed as a bitmap */
+template<class Graph>
+void printMinCut(Graph& graph, const minCutBitmap& cut){
+    std::cout<<"\nMinimum s-t cut \n";
+    std::cout<<"Nodes at the s side:\n";
+    for(int node_id : cut.getSourceSide()){
+        std::cout <<graph.getNodeName(node_id)<<" ";
+    }
+    std::cout<<"\n";
+
+    std::cout<<"Nodes at the t side:\n";
+    for(int node_id : cut.getTargetSide()){
+        std::cout <<graph.getNodeName(node_id)<<" ";
+    }
+    std::cout<<"\n";
+}
+
+/*
+ * @brief   Find the minimum s-t cut of the input residual graph. Print the s and t vertices sets
+ *          on the standard output console.
+ * @param[in] graph     A residual graph
+ * @param[in] cut_mode  As for computeMinCut(). The default value is MIN_CUT_FROM_SOURCE.
+ * @param[in] bfs_threads  Threads for the reachability pass, as for fordFulkerson().
+ *                      The default value is 1.
+ *
+ */
+template<class Graph>
+void findMinCut(Graph& graph, int cut_mode = MIN_CUT_FROM_SOURCE, int bfs_threads = 1){
+    minCutBitmap cut;
+    if(!computeMinCut(graph, cut, cut_mode, bfs_threads)){
+        std::cout<<"The residual graph still has one or more augmenting paths. Failed to compute minimum s-t cut.\n";
+        return;
+    }
+    printMinCut(graph, cut);
+}
+
+#endif
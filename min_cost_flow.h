@@ -0,0 +1,465 @@
+#ifndef MIN_COST_FLOW_H
+#define MIN_COST_FLOW_H
+
+#include<climits>
+#include<cstdlib>
+#include<iostream>
+
+#include "residual_graph.h"
+#include "dinic.h"
+#include "radix_heap.h"
+#include "simd_scan.h"
+#include "solver_workspace.h"
+#include "solver_counters.h"
+
+/* Min cost flow engines that solveMinCostFlow() can run */
+#define MIN_COST_FLOW_SUCCESSIVE_SHORTEST_PATH 0
+#define MIN_COST_FLOW_COST_SCALING 1
+#define MIN_COST_FLOW_ENGINE_COUNT 2
+
+#define COST_SCALING_ALPHA 16 /* Factor epsilon shrinks by between two refine passes */
+
+/*
+ * What the min cost flow engines found, in the flowType of the graph. The
+ * flow is a maximum flow, and no other maximum flow costs less.
+ */
+template<class Flow = long long>
+struct minCostFlowResult{
+    Flow flow;
+    Flow cost; /* Sum over the edges of their flow times their cost */
+};
+
+/*
+ * @brief   Cost of the flow a graph holds: the flow of every input edge
+ *          times its cost. Back edges carry minus the flow of their input
+ *          edge at minus its cost, so only the edges with a positive flow
+ *          are counted.
+ */
+template<class Graph>
+typename Graph::flowType getFlowCost(Graph& graph){
+    typedef typename Graph::flowType flowType;
+    flowType cost = 0;
+    for(int edge_id = 0; edge_id < graph.getEdgeCount(); edge_id++){
+        const flowType flow = (flowType)graph.getOriginalCapacity(edge_id) - (flowType)graph.getResidualCapacity(edge_id);
+        if(flow > 0){
+            cost += flow * graph.getCost(edge_id);
+        }
+    }
+    return cost;
+}
+
+/*
+ * @brief   Potentials that make every reduced cost of the residual graph non
+ *          negative, the distances from a virtual source with an edge of
+ *          cost 0 to every node, found by Bellman-Ford with a FIFO queue.
+ *          Starting from every node finds the negative cycles the source
+ *          can not reach as well.
+ *
+ * @return  False if the residual graph has a cycle of negative cost, there is
+ *          no minimum cost then
+ */
+template<class Graph>
+bool initialPotentials(Graph& graph,
+        nodeArray<long long, Graph::STATIC_NODE_COUNT>& potential,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>& search,
+        scratchArena* arena)
+{
+    const int node_count = graph.getNodeCount();
+    nodeArray<char, Graph::STATIC_NODE_COUNT> queued(node_count, arena);
+    nodeArray<int, Graph::STATIC_NODE_COUNT> path_edges(node_count, arena); /* Edges of the path to each node, the virtual one included */
+    search.beginSearch(node_count);
+    for(int i = 0; i < node_count; i++){
+        potential[i] = 0;
+        path_edges[i] = 1;
+        queued[i] = 1;
+        search.push(i);
+    }
+    while(!search.isQueueEmpty()){
+        const int node_id = search.pop();
+        queued[node_id] = 0;
+        SOLVER_COUNT(nodes_dequeued, 1);
+        bool negative_cycle = false;
+        forEachResidualArc(graph, node_id, [&](int edge_id){
+            const int next_node = graph.getHead(edge_id);
+            const long long distance = potential[node_id] + graph.getCost(edge_id);
+            if(distance < potential[next_node]){
+                potential[next_node] = distance;
+                /* A path of more than V edges from the virtual source repeats a node */
+                path_edges[next_node] = path_edges[node_id] + 1;
+                if(path_edges[next_node] > node_count){
+                    negative_cycle = true;
+                }
+                if(queued[next_node] == 0){
+                    queued[next_node] = 1;
+                    search.push(next_node);
+                }
+            }
+        });
+        if(negative_cycle){
+            std::cerr<<"The residual graph has a cycle of negative cost, there is no minimum cost flow\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * @brief   Successive shortest path min cost flow engine.
+ *
+ *          Every round sends flow along a cheapest augmenting path, found by
+ *          Dijkstra's algorithm on the reduced costs c(u, v) + p(u) - p(v),
+ *          which Johnson's potentials p keep non negative: after each round
+ *          p(v) grows by the distance of v, or by that of the target for the
+ *          nodes further away, as the search stops at the target. Distances
+ *          are integers, so the queue is a radixHeap. Negative costs are
+ *          allowed: the first potentials then come from Bellman-Ford, and a
+ *          negative cycle makes the solve fail. The number of rounds is at
+ *          most the flow value, use the cost scaling engine for large
+ *          capacities.
+ *
+ *          The graph must start without flow. It is left holding a minimum
+ *          cost maximum flow, so computeMinCut() and getEdgeFlows() can be
+ *          used on the result.
+ *
+ * @param [in]  graph       A residual graph with back edges and costs, see
+ *                          residualGraph::addEdge()
+ * @param [out] result      Receives the flow value and its cost
+ * @param [in]  workspace   Search buffers and scratch arena, kept alive across solves
+ *                          so they do not allocate. NULL allocates them for this call.
+ *                          The default value is NULL.
+ *
+ * @return  False if the graph has a cycle of negative cost, result is then empty
+ */
+template<class Graph>
+bool successiveShortestPaths(Graph& graph,
+        minCostFlowResult<typename Graph::flowType>& result,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL)
+{
+    typedef typename Graph::capacityType capacityType;
+    const int node_count = graph.getNodeCount();
+    const int source = graph.getSource();
+    const int sink = graph.getSink();
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? node_count : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& search = workspace != NULL ? *workspace : local_workspace;
+    scratchArena* arena = &search.getArena();
+    scratchScope scope(arena);
+    nodeArray<long long, Graph::STATIC_NODE_COUNT> potential(node_count, arena);
+    nodeArray<long long, Graph::STATIC_NODE_COUNT> distance(node_count, arena);
+    radixHeap<int> heap;
+    result.flow = 0;
+    result.cost = 0;
+    if(source == sink){
+        return true;
+    }
+
+    bool negative_costs = false;
+    for(int edge_id = 0; edge_id < graph.getEdgeCount() && !negative_costs; edge_id++){
+        negative_costs = graph.getResidualCapacity(edge_id) > 0 && graph.getCost(edge_id) < 0;
+    }
+    if(negative_costs && !initialPotentials(graph, potential, search, arena)){
+        return false;
+    }
+
+    while(true){
+        {
+            SOLVER_PHASE_TIMER(SOLVER_PHASE_SEARCH);
+            SOLVER_COUNT(bfs_calls, 1);
+            search.beginSearch(node_count);
+            for(int i = 0; i < node_count; i++){
+                distance[i] = LLONG_MAX;
+            }
+            distance[source] = 0;
+            heap.clear();
+            heap.push(0, source);
+            /* A node is visited once it is settled, its distance is then final */
+            while(!heap.isEmpty()){
+                unsigned long long key;
+                int node_id;
+                heap.pop(key, node_id);
+                if(search.isVisited(node_id)){
+                    continue;
+                }
+                search.setVisited(node_id);
+                SOLVER_COUNT(nodes_dequeued, 1);
+                if(node_id == sink){
+                    break;
+                }
+                SOLVER_COUNT(arcs_scanned, graph.getLastEdge(node_id) - graph.getFirstEdge(node_id));
+                forEachResidualArc(graph, node_id, [&](int edge_id){
+                    const int next_node = graph.getHead(edge_id);
+                    if(search.isVisited(next_node)){
+                        return;
+                    }
+                    const long long next_distance = distance[node_id] + graph.getCost(edge_id) + potential[node_id] - potential[next_node];
+                    if(next_distance < distance[next_node]){
+                        distance[next_node] = next_distance;
+                        search.setParent(next_node, node_id, edge_id);
+                        heap.push((unsigned long long)next_distance, next_node);
+                    }
+                });
+            }
+        }
+        if(!search.isVisited(sink)){
+            break;
+        }
+
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_AUGMENT);
+        const long long sink_distance = distance[sink];
+        for(int i = 0; i < node_count; i++){
+            potential[i] += search.isVisited(i) ? distance[i] : sink_distance;
+        }
+        int* path_edges = search.getPathEdges();
+        int path_length = 0;
+        long long path_cost = 0;
+        for(int node_id = sink; node_id != source; node_id = search.getParentNode(node_id)){
+            path_edges[path_length] = search.getParentEdge(node_id);
+            path_cost += graph.getCost(path_edges[path_length]);
+            path_length++;
+        }
+        const capacityType bottleneck = minResidual(graph.getResidualCapacities(), path_edges, path_length);
+        SOLVER_COUNT_AUGMENTATION(path_length, bottleneck);
+        for(int i = 0; i < path_length; i++){
+            const int edge_id = path_edges[i];
+            const int back_edge = graph.getReverse(edge_id);
+            graph.setResidualCapacity(edge_id, graph.getResidualCapacity(edge_id) - bottleneck);
+            graph.setResidualCapacity(back_edge, graph.getResidualCapacity(back_edge) + bottleneck);
+        }
+        result.flow += bottleneck;
+        result.cost += (typename Graph::flowType)bottleneck * path_cost;
+    }
+    return true;
+}
+
+/*
+ * @brief    Cost scaling min cost flow engine of Goldberg and Tarjan.
+ *
+ *          A maximum flow is found with dinic() first. What is left is a
+ *          minimum cost circulation in its residual graph, which changes the
+ *          cost of the flow but not its value. Costs are multiplied by V + 1,
+ *          so a flow that is 1-optimal for them, with no reduced cost below
+ *          -1, is optimal for the input costs. Each refine pass turns an
+ *          alpha epsilon-optimal flow into an epsilon-optimal one: it
+ *          saturates every residual edge of negative reduced cost and then
+ *          pushes the excess it created along admissible edges, of negative
+ *          reduced cost, and lowers the price of a node by at least epsilon
+ *          when it has none left, FIFO order with a current edge per node
+ *          as in pushRelabel(). Epsilon starts at the largest scaled cost
+ *          and shrinks by alpha per pass down to 1, O(log(V C)) passes. The
+ *          running time does not depend on the capacities, and negative costs
+ *          and negative cycles need nothing special.
+ *
+ *          Capacities must be integers and the graph must start without flow.
+ */
+template<class Graph>
+class costScalingSolver{
+public:
+    typedef typename Graph::capacityType capacityType;
+    typedef typename Graph::flowType flowType;
+
+    /*
+     * @param[in] graph  A residual graph with back edges and costs
+     * @param[in] arena  Scratch arena for the per node buffers, NULL to use the heap.
+     *                   The buffers stay in the arena until the caller's scratchScope ends.
+     */
+    costScalingSolver(Graph& graph, scratchArena* arena = NULL) :
+        graph_(graph),
+        arena_(arena),
+        node_count_(graph.getNodeCount()),
+        price_(node_count_, arena),
+        excess_(node_count_, arena),
+        current_edge_(node_count_, arena),
+        queue_(node_count_, arena),
+        queued_(node_count_, arena)
+    {
+    }
+
+    /*
+     * @brief   Compute a minimum cost maximum flow into the residual graph.
+     *
+     * @param[out] result   Receives the flow value and its cost
+     * @param[in]  alpha    Factor epsilon shrinks by between two passes, at least 2.
+     *                      The default value is COST_SCALING_ALPHA.
+     *
+     * @return  False, leaving a maximum flow of unknown cost, if the scaled prices
+     *          could overflow 64 bits
+     */
+    bool solve(minCostFlowResult<flowType>& result, int alpha = COST_SCALING_ALPHA){
+        result.flow = dinic(graph_, arena_);
+        result.cost = 0;
+        long long largest_cost = 0;
+        for(int edge_id = 0; edge_id < graph_.getEdgeCount(); edge_id++){
+            const long long cost = std::llabs((long long)graph_.getCost(edge_id));
+            if(cost > largest_cost){
+                largest_cost = cost;
+            }
+        }
+        /* Prices fall by less than 3 V epsilon a pass, 6 V^2 C in all for the scaled costs */
+        scale_ = node_count_ + 1;
+        if((long double)largest_cost * scale_ * node_count_ * 6 >= (long double)LLONG_MAX){
+            std::cerr<<"The costs are too large for cost scaling on "<<node_count_<<" nodes\n";
+            return false;
+        }
+        for(int i = 0; i < node_count_; i++){
+            price_[i] = 0;
+            excess_[i] = 0;
+        }
+        long long epsilon = largest_cost * scale_;
+        while(epsilon > 1){
+            epsilon = std::max(1LL, epsilon / std::max(alpha, 2));
+            refine(epsilon);
+        }
+        result.cost = getFlowCost(graph_);
+        return true;
+    }
+private:
+    costScalingSolver(const costScalingSolver&);
+    costScalingSolver& operator=(const costScalingSolver&);
+
+    long long getReducedCost(int node_id, int edge_id){
+        return graph_.getCost(edge_id) * scale_ + price_[node_id] - price_[graph_.getHead(edge_id)];
+    }
+
+    void pushFlow(int node_id, int edge_id, capacityType amount){
+        const int next_node = graph_.getHead(edge_id);
+        graph_.setResidualCapacity(edge_id, graph_.getResidualCapacity(edge_id) - amount);
+        graph_.setResidualCapacity(graph_.getReverse(edge_id), graph_.getResidualCapacity(graph_.getReverse(edge_id)) + amount);
+        excess_[node_id] -= amount;
+        excess_[next_node] += amount;
+        SOLVER_COUNT(pushes, 1);
+    }
+
+    void enqueue(int node_id){
+        if(queued_[node_id] == 0 && excess_[node_id] > 0){
+            queued_[node_id] = 1;
+            const int slot = queue_head_ + queue_size_;
+            queue_[slot < node_count_ ? slot : slot - node_count_] = node_id;
+            queue_size_++;
+        }
+    }
+
+    /* Turn the flow into an epsilon-optimal one, from an alpha epsilon-optimal one */
+    void refine(long long epsilon){
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_AUGMENT);
+        for(int node_id = 0; node_id < node_count_; node_id++){
+            for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+                const capacityType residual = graph_.getResidualCapacity(edge_id);
+                if(residual > 0 && getReducedCost(node_id, edge_id) < 0){
+                    pushFlow(node_id, edge_id, residual);
+                }
+            }
+        }
+        queue_head_ = 0;
+        queue_size_ = 0;
+        for(int node_id = 0; node_id < node_count_; node_id++){
+            current_edge_[node_id] = graph_.getFirstEdge(node_id);
+            queued_[node_id] = 0;
+            enqueue(node_id);
+        }
+        while(queue_size_ > 0){
+            const int node_id = queue_[queue_head_];
+            queue_head_ = queue_head_ + 1 < node_count_ ? queue_head_ + 1 : 0;
+            queue_size_--;
+            queued_[node_id] = 0;
+            discharge(node_id, epsilon);
+        }
+    }
+
+    /* Push the whole excess of a node away, lowering its price as often as needed */
+    void discharge(int node_id, long long epsilon){
+        while(excess_[node_id] > 0){
+            int& edge_id = current_edge_[node_id];
+            if(edge_id == graph_.getLastEdge(node_id)){
+                relabel(node_id, epsilon);
+                continue;
+            }
+            const capacityType residual = graph_.getResidualCapacity(edge_id);
+            if(residual > 0 && getReducedCost(node_id, edge_id) < 0){
+                const capacityType amount = excess_[node_id] < (flowType)residual ? (capacityType)excess_[node_id] : residual;
+                pushFlow(node_id, edge_id, amount);
+                enqueue(graph_.getHead(edge_id));
+                if(amount == residual){
+                    edge_id++;
+                }
+            } else {
+                edge_id++;
+            }
+        }
+    }
+
+    /* Lower the price of a node just enough that its cheapest residual edge gets a reduced cost of -epsilon */
+    void relabel(int node_id, long long epsilon){
+        SOLVER_COUNT(relabels, 1);
+        long long highest = LLONG_MIN;
+        for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+            if(graph_.getResidualCapacity(edge_id) > 0){
+                const long long price = price_[graph_.getHead(edge_id)] - graph_.getCost(edge_id) * scale_;
+                if(price > highest){
+                    highest = price;
+                }
+            }
+        }
+        price_[node_id] = highest - epsilon;
+        current_edge_[node_id] = graph_.getFirstEdge(node_id);
+    }
+
+    Graph& graph_;
+    scratchArena* arena_; /* For the max flow, NULL for the heap */
+    int node_count_;
+    long long scale_; /* Factor of the costs, V + 1 */
+    nodeArray<long long, Graph::STATIC_NODE_COUNT> price_;
+    nodeArray<flowType, Graph::STATIC_NODE_COUNT> excess_;
+    nodeArray<int, Graph::STATIC_NODE_COUNT> current_edge_; /* Next edge to try per node */
+    nodeArray<int, Graph::STATIC_NODE_COUNT> queue_; /* Ring buffer of the nodes with excess */
+    nodeArray<char, Graph::STATIC_NODE_COUNT> queued_; /* 1 while a node is in queue_ */
+    int queue_head_;
+    int queue_size_;
+};
+
+/*
+ * @brief   Minimum cost maximum flow with cost scaling, see costScalingSolver.
+ *
+ * @param [in]  graph   A residual graph with back edges and costs, without flow
+ * @param [out] result  Receives the flow value and its cost
+ * @param [in]  arena   Scratch arena for the per node buffers, NULL to use the
+ *                      heap. The default value is NULL.
+ *
+ * @return  False if the costs are too large for the scaled prices, see costScalingSolver::solve()
+ */
+template<class Graph>
+bool costScaling(Graph& graph, minCostFlowResult<typename Graph::flowType>& result, scratchArena* arena = NULL)
+{
+    scratchScope scope(arena);
+    costScalingSolver<Graph> solver(graph, arena);
+    return solver.solve(result);
+}
+
+/*
+ * @brief   Compute a minimum cost maximum flow with the given engine. Cost
+ *          scaling needs integer capacities, graphs of floating point
+ *          capacities run successive shortest paths for it.
+ *
+ * @param [in]  graph       A residual graph with back edges and costs, without flow.
+ *                          It is left holding the flow.
+ * @param [in]  engine      One of the MIN_COST_FLOW_* engine ids
+ * @param [out] result      Receives the flow value and its cost
+ * @param [in]  workspace   Search buffers and scratch arena, NULL uses the heap. The
+ *                          default value is NULL.
+ *
+ * @return  False if the engine failed, see successiveShortestPaths() and costScaling().
+ *          A cycle of negative cost makes successive shortest paths fail while cost
+ *          scaling cancels it, as a minimum cost circulation would.
+ */
+template<class Graph>
+bool solveMinCostFlow(Graph& graph, int engine,
+        minCostFlowResult<typename Graph::flowType>& result,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL)
+{
+    if constexpr(isIntegralValue<typename Graph::capacityType>::value){
+        if(engine == MIN_COST_FLOW_COST_SCALING){
+            return costScaling(graph, result, workspace != NULL ? &workspace->getArena() : NULL);
+        }
+    }
+    return successiveShortestPaths(graph, result, workspace);
+}
+
+#endif
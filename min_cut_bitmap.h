@@ -0,0 +1,128 @@
+#ifndef MIN_CUT_BITMAP_H
+#define MIN_CUT_BITMAP_H
+
+#include<cstdint>
+#include<iterator>
+#include<vector>
+
+/*
+ * @brief    Nodes of one side of a cut, read straight from the words of a
+ *          minCutBitmap. Iterating it yields the node ids in increasing
+ *          order, 64 nodes per word load, without building a list of them.
+ *          The view is only valid as long as the bitmap is not changed.
+ */
+class minCutNodeView{
+public:
+    class iterator{
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef int value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const int* pointer;
+        typedef int reference;
+
+        iterator(const minCutNodeView* view, int word_index) : view_(view), word_index_(word_index), bits_(0){
+            if(word_index_ < view_->word_count_){
+                bits_ = view_->getWord(word_index_);
+                skipEmptyWords();
+            }
+        }
+
+        int operator*() const{return word_index_ * 64 + __builtin_ctzll(bits_);}
+        iterator& operator++(){
+            bits_ &= bits_ - 1;
+            skipEmptyWords();
+            return *this;
+        }
+        iterator operator++(int){
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        bool operator==(const iterator& other) const{return word_index_ == other.word_index_ && bits_ == other.bits_;}
+        bool operator!=(const iterator& other) const{return !(*this == other);}
+    private:
+        void skipEmptyWords(){
+            while(bits_ == 0 && ++word_index_ < view_->word_count_){
+                bits_ = view_->getWord(word_index_);
+            }
+        }
+
+        const minCutNodeView* view_;
+        int word_index_;
+        uint64_t bits_; /* Nodes of the current word not returned yet */
+    };
+
+    minCutNodeView(const uint64_t* words, int node_count, bool complement) :
+        words_(words),
+        word_count_((node_count + 63) / 64),
+        flip_(complement ? ~(uint64_t)0 : 0),
+        tail_mask_(node_count % 64 != 0 ? ((uint64_t)1 << (node_count % 64)) - 1 : ~(uint64_t)0)
+    {
+    }
+
+    iterator begin() const{return iterator(this, 0);}
+    iterator end() const{return iterator(this, word_count_);}
+private:
+    /* Bits of the nodes of the side in a word, never a bit past the last node */
+    uint64_t getWord(int word_index) const{
+        uint64_t word = words_[word_index] ^ flip_;
+        return word_index + 1 == word_count_ ? word & tail_mask_ : word;
+    }
+
+    const uint64_t* words_;
+    int word_count_;
+    uint64_t flip_; /* All ones for the t side, which is stored as the clear bits */
+    uint64_t tail_mask_; /* Bits of the last word that are nodes */
+};
+
+/*
+ * @brief    s-t cut as one bit per node, set for the nodes of the s side.
+ *          A graph of V nodes takes V / 8 bytes, a 32nd of a list of node ids.
+ *          computeMinCut() fills it and computeCutEdges() lists the edges
+ *          that cross it.
+ */
+class minCutBitmap{
+public:
+    minCutBitmap() : node_count_(0){
+    }
+
+    /* Resize to node_count nodes, all on the t side. The memory is kept. */
+    void reset(int node_count){
+        node_count_ = node_count;
+        words_.assign((node_count + 63) / 64, 0);
+    }
+
+    int getNodeCount() const{return node_count_;}
+    bool isSourceSide(int node_id) const{return (words_[node_id >> 6] >> (node_id & 63)) & 1;}
+    void setSourceSide(int node_id){words_[node_id >> 6] |= (uint64_t)1 << (node_id & 63);}
+
+    /* Number of nodes on the s side, one popcount per word */
+    int getSourceSideCount() const{
+        int count = 0;
+        for(size_t i = 0; i < words_.size(); i++){
+            count += __builtin_popcountll(words_[i]);
+        }
+        return count;
+    }
+
+    minCutNodeView getSourceSide() const{return minCutNodeView(words_.data(), node_count_, false);}
+    minCutNodeView getTargetSide() const{return minCutNodeView(words_.data(), node_count_, true);}
+
+    /* Raw words for filling the bitmap a word at a time, nodes 64 * i .. 64 * i + 63 in word i */
+    int getWordCount() const{return (int)words_.size();}
+    uint64_t* getWords(){return words_.data();}
+    const uint64_t* getWords() const{return words_.data();}
+
+    /* Clear the bits past the last node after whole words were written */
+    void clearTail(){
+        if(node_count_ % 64 != 0){
+            words_.back() &= ((uint64_t)1 << (node_count_ % 64)) - 1;
+        }
+    }
+private:
+    int node_count_;
+    std::vector<uint64_t> words_;
+};
+
+#endif
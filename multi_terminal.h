@@ -0,0 +1,281 @@
+#ifndef MULTI_TERMINAL_H
+#define MULTI_TERMINAL_H
+
+#include<iostream>
+#include<limits>
+#include<vector>
+
+#include "maxflow_mincut.h"
+
+/*
+ * @brief    Sources and sinks of a flow network with several terminals, kept
+ *          next to the residual graph instead of a super source and a super
+ *          sink added to it.
+ *
+ *          Every source has a supply, the most flow it can send, and every
+ *          sink a demand, the most flow it can take; both default to
+ *          unlimited. Both are flow values, as a source can send more than
+ *          any one edge holds. They play the part of the edges from the super source
+ *          and into the super sink: compact arrays indexed by terminal hold
+ *          their capacities and what is left of them, and one array of the
+ *          node count maps a node to its terminal slot. The residual graph is
+ *          left exactly as built, its own source and sink are not used.
+ */
+template<class Capacity = residualCapacityStorage>
+class flowTerminals{
+public:
+    typedef typename flowValue<Capacity>::type flowType;
+
+    flowTerminals(int node_count = 0){
+        reset(node_count);
+    }
+
+    /* Drop every terminal, for a graph of node_count nodes. */
+    void reset(int node_count){
+        sources_.clear();
+        sinks_.clear();
+        slots_.assign(node_count, INVALID_PARENT);
+    }
+
+    /*
+     * @brief   Make a node a source. Adding the same source again adds to its supply.
+     *
+     * @param[in] node_id   Id of the node
+     * @param[in] supply    Most flow the node can send. The default value is unlimited.
+     *
+     * @return  False if the node is already a sink
+     */
+    bool addSource(int node_id, flowType supply = std::numeric_limits<flowType>::max()){
+        return addTerminal(sources_, node_id, supply, SOURCE_SLOT_BIT);
+    }
+
+    /*
+     * @brief   Make a node a sink. Adding the same sink again adds to its demand.
+     *
+     * @param[in] node_id   Id of the node
+     * @param[in] demand    Most flow the node can take. The default value is unlimited.
+     *
+     * @return  False if the node is already a source
+     */
+    bool addSink(int node_id, flowType demand = std::numeric_limits<flowType>::max()){
+        return addTerminal(sinks_, node_id, demand, 0);
+    }
+
+    int getSourceCount(){return (int)sources_.size();}
+    int getSinkCount(){return (int)sinks_.size();}
+    int getSource(int index){return sources_[index].node_id;}
+    int getSink(int index){return sinks_[index].node_id;}
+    /* Supply the source or demand the sink still has */
+    flowType getSourceResidual(int index){return sources_[index].residual;}
+    flowType getSinkResidual(int index){return sinks_[index].residual;}
+    /* Flow sent by a source or taken by a sink so far */
+    flowType getSourceFlow(int index){return sources_[index].capacity - sources_[index].residual;}
+    flowType getSinkFlow(int index){return sinks_[index].capacity - sinks_[index].residual;}
+
+    /* Index of a node in the sources or the sinks, INVALID_PARENT if the node is not one */
+    int getSourceIndex(int node_id){
+        return slots_[node_id] != INVALID_PARENT && (slots_[node_id] & SOURCE_SLOT_BIT) != 0 ? slots_[node_id] & ~SOURCE_SLOT_BIT : INVALID_PARENT;
+    }
+    int getSinkIndex(int node_id){
+        return slots_[node_id] != INVALID_PARENT && (slots_[node_id] & SOURCE_SLOT_BIT) == 0 ? slots_[node_id] : INVALID_PARENT;
+    }
+
+    /* Record amount of flow from the source at source_index to the sink at sink_index. */
+    void sendFlow(int source_index, int sink_index, flowType amount){
+        sources_[source_index].residual -= amount;
+        sinks_[sink_index].residual -= amount;
+    }
+
+    /* Forget the flow sent, for a graph whose flow was cleared too. */
+    void clearFlow(){
+        for(size_t i = 0; i < sources_.size(); i++){
+            sources_[i].residual = sources_[i].capacity;
+        }
+        for(size_t i = 0; i < sinks_.size(); i++){
+            sinks_[i].residual = sinks_[i].capacity;
+        }
+    }
+private:
+    /* Set in the slot of a source, clear in the slot of a sink */
+    static const int SOURCE_SLOT_BIT = 1 << 30;
+
+    struct terminal{
+        int node_id;
+        flowType capacity;
+        flowType residual;
+    };
+
+    bool addTerminal(std::vector<terminal>& terminals, int node_id, flowType capacity, int kind_bit){
+        int slot = slots_[node_id];
+        if(slot == INVALID_PARENT){
+            terminal added = {node_id, 0, 0};
+            slots_[node_id] = (int)terminals.size() | kind_bit;
+            terminals.push_back(added);
+        } else if((slot & SOURCE_SLOT_BIT) != kind_bit){
+            std::cerr<<"Node "<<node_id<<" can not be both a source and a sink\n";
+            return false;
+        }
+        terminal& entry = terminals[slots_[node_id] & ~SOURCE_SLOT_BIT];
+        /* Unlimited stays unlimited */
+        const flowType sent = entry.capacity - entry.residual;
+        entry.capacity = saturatingAdd(entry.capacity, capacity);
+        entry.residual = entry.capacity - sent;
+        return true;
+    }
+
+    std::vector<terminal> sources_;
+    std::vector<terminal> sinks_;
+    std::vector<int32_t> slots_; /* Terminal index of each node, with SOURCE_SLOT_BIT for sources, or INVALID_PARENT */
+};
+
+/*
+ *  @brief  BFS from every source with supply left at once, which stops at the
+ *          first sink with demand left that it reaches. The path to it can be
+ *          read from the parents of the workspace back to a node without
+ *          parent, the source it starts at.
+ *
+ *          With s_side the search visits every node it can reach instead and
+ *          marks them, which is the s side of a minimum cut once no sink can
+ *          be reached any more.
+ *
+ *  @param[in]             graph      The graph to traverse.
+ *  @param[in]             terminals  Sources and sinks of the graph
+ *  @param[out] (optional) s_side     Reset to the node count, with the bits of the nodes reached
+ *                                    set. The default value is NULL.
+ *  @param[in]  (optional) workspace  Search buffers, left holding the search tree. NULL uses a
+ *                                    temporary one. The default value is NULL.
+ *
+ *  @return Returns the first sink reached, INVALID_PARENT if no sink with demand left can be reached
+ */
+template<class Graph>
+int multiTerminalBfs(Graph& graph,
+        flowTerminals<typename Graph::capacityStorage>& terminals,
+        minCutBitmap* s_side = NULL,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL)
+{
+    const int node_count = graph.getNodeCount();
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? node_count : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& search = workspace != NULL ? *workspace : local_workspace;
+    SOLVER_PHASE_TIMER(SOLVER_PHASE_SEARCH);
+    SOLVER_COUNT(bfs_calls, 1);
+
+    search.beginSearch(node_count);
+    for(int i = 0; i < terminals.getSourceCount(); i++){
+        if(terminals.getSourceResidual(i) > 0){
+            const int source = terminals.getSource(i);
+            search.setVisited(source);
+            search.setParent(source, INVALID_PARENT, INVALID_PARENT);
+            search.push(source);
+        }
+    }
+    int reached_sink = INVALID_PARENT;
+    while(!search.isQueueEmpty() && (s_side != NULL || reached_sink == INVALID_PARENT)){
+        int node_id = search.pop();
+        SOLVER_COUNT(nodes_dequeued, 1);
+        SOLVER_COUNT(arcs_scanned, graph.getLastEdge(node_id) - graph.getFirstEdge(node_id));
+        forEachResidualArc(graph, node_id, [&](int edge_id){
+            int next_node = graph.getHead(edge_id);
+            if(!search.isVisited(next_node)){
+                search.setVisited(next_node);
+                search.setParent(next_node, node_id, edge_id);
+                search.push(next_node);
+                int sink_index = terminals.getSinkIndex(next_node);
+                if(reached_sink == INVALID_PARENT && sink_index != INVALID_PARENT && terminals.getSinkResidual(sink_index) > 0){
+                    reached_sink = next_node;
+                }
+            }
+        });
+    }
+
+    if(s_side != NULL){
+        s_side->reset(node_count);
+        for(int i = 0; i < node_count; i++){
+            if(search.isVisited(i)){
+                s_side->setSourceSide(i);
+            }
+        }
+    }
+    return reached_sink;
+}
+
+/*
+ * @brief   Ford Fulkerson on a flow network with several sources and sinks.
+ *          Each augmenting path runs from a source with supply left to a sink
+ *          with demand left, and is limited by both as well as by its edges,
+ *          the same paths as through a super source and a super sink.
+ *
+ * @param [in]  graph       A flow network transformed into a residual graph with
+ *                          back edges. Its own source and sink are ignored.
+ * @param [in]  terminals   Sources and sinks of the network, left holding the flow
+ *                          each of them sent or took
+ * @param [in]  workspace   Search buffers, as for fordFulkerson(). The default value is NULL.
+ *
+ * @return  Returns the maximum flow from all sources to all sinks together
+ */
+template<class Graph>
+typename Graph::flowType multiTerminalFordFulkerson(Graph& graph,
+        flowTerminals<typename Graph::capacityStorage>& terminals,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL)
+{
+    typedef typename Graph::capacityType capacityType;
+    typedef typename Graph::flowType flowType;
+    solverWorkspace<Graph::STATIC_NODE_COUNT> local_workspace(workspace == NULL ? graph.getNodeCount() : 0);
+    solverWorkspace<Graph::STATIC_NODE_COUNT>& augmentingPath = workspace != NULL ? *workspace : local_workspace;
+    flowType max_flow = 0;
+
+    for(int sink = multiTerminalBfs(graph, terminals, NULL, &augmentingPath); sink != INVALID_PARENT;
+            sink = multiTerminalBfs(graph, terminals, NULL, &augmentingPath)){
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_AUGMENT);
+        int* path_edges = augmentingPath.getPathEdges();
+        int path_length = 0;
+        int source = sink;
+        for(; augmentingPath.getParentNode(source) != INVALID_PARENT; source = augmentingPath.getParentNode(source)){
+            path_edges[path_length++] = augmentingPath.getParentEdge(source);
+        }
+
+        const int source_index = terminals.getSourceIndex(source);
+        const int sink_index = terminals.getSinkIndex(sink);
+        capacityType min_flow_in_path = minResidual(graph.getResidualCapacities(), path_edges, path_length);
+        if(terminals.getSourceResidual(source_index) < (flowType)min_flow_in_path){
+            min_flow_in_path = (capacityType)terminals.getSourceResidual(source_index);
+        }
+        if(terminals.getSinkResidual(sink_index) < (flowType)min_flow_in_path){
+            min_flow_in_path = (capacityType)terminals.getSinkResidual(sink_index);
+        }
+        SOLVER_COUNT_AUGMENTATION(path_length, min_flow_in_path);
+        max_flow += min_flow_in_path;
+
+        for(int i = 0; i < path_length; i++){
+            int edge_id = path_edges[i];
+            int back_edge = graph.getReverse(edge_id);
+            graph.setResidualCapacity(edge_id, graph.getResidualCapacity(edge_id) - min_flow_in_path);
+            graph.setResidualCapacity(back_edge, graph.getResidualCapacity(back_edge) + min_flow_in_path);
+        }
+        terminals.sendFlow(source_index, sink_index, min_flow_in_path);
+    }
+    return max_flow;
+}
+
+/*
+ * @brief   Minimum cut between all sources and all sinks after
+ *          multiTerminalFordFulkerson(), as a bitmap. A source whose supply is
+ *          used up and that the others can not reach is on the t side, as its
+ *          supply is part of the cut.
+ *
+ * @param[in]  graph        A residual graph holding a maximum flow
+ * @param[in]  terminals    Its sources and sinks
+ * @param[out] s_side       Reset to the node count, with the bits of the s side set
+ * @param[in]  workspace    Search buffers, NULL uses a temporary one. The default value is NULL.
+ *
+ * @return  False if a sink with demand left can still be reached, so there is no cut yet
+ */
+template<class Graph>
+bool computeMultiTerminalMinCut(Graph& graph,
+        flowTerminals<typename Graph::capacityStorage>& terminals,
+        minCutBitmap& s_side,
+        solverWorkspace<Graph::STATIC_NODE_COUNT>* workspace = NULL)
+{
+    return multiTerminalBfs(graph, terminals, &s_side, workspace) == INVALID_PARENT;
+}
+
+#endif
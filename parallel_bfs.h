@@ -0,0 +1,357 @@
+#ifndef PARALLEL_BFS_H
+#define PARALLEL_BFS_H
+
+#include<atomic>
+#include<condition_variable>
+#include<cstdint>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include "residual_graph.h"
+#include "spin_barrier.h"
+#include "solver_counters.h"
+
+/* Direction switching thresholds from Beamer et al., "Direction-Optimizing Breadth-First Search" */
+#define BFS_TOP_DOWN_ALPHA 14 /* Go bottom up once the frontier has more than 1/ALPHA of the unvisited edges */
+#define BFS_BOTTOM_UP_BETA 24 /* Go back top down once the frontier has less than 1/BETA of the nodes */
+#define BFS_CHUNK_WORDS 16 /* Bitmap words (64 nodes each) a thread claims at a time */
+
+/*
+ * @brief    Level synchronous parallel BFS over the residual edges of a graph.
+ *
+ *          The current and the next frontier are bitmaps and the visited
+ *          flags are a bitmap updated with atomic fetch_or, so the thread
+ *          that sets a node's bit is the only one that writes its parent
+ *          edge. Each level runs either top down (frontier nodes scan their
+ *          edges) or bottom up (unvisited nodes look for a parent in the
+ *          frontier and stop at the first one), switching on frontier size
+ *          as in direction optimizing BFS. Threads claim chunks of bitmap
+ *          words from a shared counter and meet at a barrier after every
+ *          level.
+ *
+ *          It can also search backwards from the target, following residual
+ *          edges in reverse, to find every node that can reach the target.
+ *
+ *          The object owns every buffer and a pool of worker threads, started
+ *          once and parked between searches, so one instance should be kept
+ *          for all searches on the same graph. run() must not be called from
+ *          several threads at the same time.
+ */
+template<class Graph>
+class parallelBfs{
+public:
+    /*
+     * @param[in] node_count    Number of nodes of the graphs it will search
+     * @param[in] thread_count  Threads to use, including the caller of run(). 0 means
+     *                          one per hardware thread, and more than that are not
+     *                          started as the spinning barrier needs a core per thread.
+     */
+    parallelBfs(int node_count, int thread_count = 0) :
+        node_count_(node_count),
+        word_count_((node_count + 63) / 64),
+        thread_count_(getPoolSize(thread_count)),
+        visited_(new std::atomic<uint64_t>[word_count_]),
+        frontier_(new std::atomic<uint64_t>[word_count_]),
+        next_frontier_(new std::atomic<uint64_t>[word_count_]),
+        parent_edge_(node_count),
+        level_(node_count),
+        barrier_(thread_count_),
+        stop_(false),
+        generation_(0),
+        running_(0)
+    {
+        for(int i = 1; i < thread_count_; i++){
+            workers_.push_back(std::thread(&parallelBfs::poolWorker, this, i));
+        }
+    }
+
+    ~parallelBfs(){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for(size_t i = 0; i < workers_.size(); i++){
+            workers_[i].join();
+        }
+    }
+
+    /*
+     * @brief   Search from the source of the graph along edges with residual capacity.
+     *
+     * @param[in] graph         The graph to traverse
+     * @param[in] stop_at_sink  Stop after the level that reaches the other terminal, enough
+     *                          for finding an augmenting path. Use false to visit everything
+     *                          reachable, as the min cut needs.
+     * @param[in] reverse       Search from the target along reverse residual edges instead.
+     *                          The default value is false.
+     *
+     * @return True if the target node is reachable from the source
+     */
+    bool run(Graph& graph, bool stop_at_sink, bool reverse = false){
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_SEARCH);
+        SOLVER_COUNT(bfs_calls, 1);
+        graph_ = &graph;
+        stop_at_sink_ = stop_at_sink;
+        reverse_ = reverse;
+        for(int i = 0; i < word_count_; i++){
+            visited_[i].store(0, std::memory_order_relaxed);
+            frontier_[i].store(0, std::memory_order_relaxed);
+            next_frontier_[i].store(0, std::memory_order_relaxed);
+        }
+        const int source = reverse ? graph.getSink() : graph.getSource();
+        setBit(visited_.get(), source);
+        setBit(frontier_.get(), source);
+        parent_edge_[source] = INVALID_PARENT;
+        level_[source] = 0;
+        current_level_ = 0;
+
+        frontier_nodes_ = 1;
+        frontier_edges_ = graph.getLastEdge(source) - graph.getFirstEdge(source);
+        unvisited_edges_ = graph.getEdgeCount() - frontier_edges_;
+        bottom_up_ = false;
+        done_ = false;
+        next_chunk_.store(0, std::memory_order_relaxed);
+        found_nodes_.store(0, std::memory_order_relaxed);
+        found_edges_.store(0, std::memory_order_relaxed);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = thread_count_ - 1;
+            generation_++;
+        }
+        start_.notify_all();
+        worker(0);
+
+        /* The pool threads still read done_ after the last level */
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            while(running_ > 0){
+                finish_.wait(lock);
+            }
+        }
+        return isVisited(reverse ? graph.getSource() : graph.getSink());
+    }
+
+    bool isVisited(int node_id){
+        return (visited_[node_id >> 6].load(std::memory_order_relaxed) >> (node_id & 63)) & 1;
+    }
+
+    /* Visited flags of nodes 64 * word_index .. 64 * word_index + 63, one bit each */
+    uint64_t getVisitedWord(int word_index){return visited_[word_index].load(std::memory_order_relaxed);}
+
+    /*
+     * Edge between the node and the one it was reached from, only valid for
+     * visited nodes other than the start. It points away from the start node
+     * in a forward search and towards it in a reverse search, so it is always
+     * the edge whose residual capacity made the step possible.
+     */
+    int getParentEdge(int node_id){return parent_edge_[node_id];}
+
+    /* Number of residual edges between the start and the node, only valid for visited nodes. */
+    int getLevel(int node_id){return level_[node_id];}
+
+    int getThreadCount(){return thread_count_;}
+
+    /*
+     * Threads a search asked for thread_count threads runs on. With one the
+     * serial BFS of the callers is faster, so they only build a parallelBfs
+     * when this is more than one.
+     */
+    static int getPoolSize(int thread_count){
+        const int hardware_threads = (int)std::thread::hardware_concurrency();
+        if(thread_count <= 0 || (hardware_threads > 0 && thread_count > hardware_threads)){
+            thread_count = hardware_threads;
+        }
+        return thread_count < 1 ? 1 : thread_count;
+    }
+private:
+    parallelBfs(const parallelBfs&);
+    parallelBfs& operator=(const parallelBfs&);
+
+    static bool testBit(std::atomic<uint64_t>* bitmap, int node_id){
+        return (bitmap[node_id >> 6].load(std::memory_order_relaxed) >> (node_id & 63)) & 1;
+    }
+
+    /* Returns true if this call set the bit. */
+    static bool setBit(std::atomic<uint64_t>* bitmap, int node_id){
+        uint64_t mask = (uint64_t)1 << (node_id & 63);
+        return !(bitmap[node_id >> 6].fetch_or(mask, std::memory_order_relaxed) & mask);
+    }
+
+    void visit(int node_id, int parent_edge, long long& found_nodes, long long& found_edges){
+        parent_edge_[node_id] = parent_edge;
+        level_[node_id] = current_level_ + 1;
+        setBit(next_frontier_.get(), node_id);
+        found_nodes++;
+        found_edges += graph_->getLastEdge(node_id) - graph_->getFirstEdge(node_id);
+    }
+
+    void topDownStep(long long& found_nodes, long long& found_edges){
+        Graph& graph = *graph_;
+        while(true){
+            int first_word = next_chunk_.fetch_add(BFS_CHUNK_WORDS, std::memory_order_relaxed);
+            if(first_word >= word_count_){
+                return;
+            }
+            int last_word = first_word + BFS_CHUNK_WORDS < word_count_ ? first_word + BFS_CHUNK_WORDS : word_count_;
+            for(int word = first_word; word < last_word; word++){
+                uint64_t bits = frontier_[word].load(std::memory_order_relaxed);
+                while(bits != 0){
+                    int node_id = word * 64 + __builtin_ctzll(bits);
+                    bits &= bits - 1;
+                    for(int edge_id = graph.getFirstEdge(node_id); edge_id < graph.getLastEdge(node_id); edge_id++){
+                        int next_node = graph.getHead(edge_id);
+                        int step_edge = reverse_ ? graph.getReverse(edge_id) : edge_id;
+                        if(graph.getResidualCapacity(step_edge) > 0 && !testBit(visited_.get(), next_node)
+                                && setBit(visited_.get(), next_node)){
+                            visit(next_node, step_edge, found_nodes, found_edges);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void bottomUpStep(long long& found_nodes, long long& found_edges){
+        Graph& graph = *graph_;
+        while(true){
+            int first_word = next_chunk_.fetch_add(BFS_CHUNK_WORDS, std::memory_order_relaxed);
+            if(first_word >= word_count_){
+                return;
+            }
+            int last_word = first_word + BFS_CHUNK_WORDS < word_count_ ? first_word + BFS_CHUNK_WORDS : word_count_;
+            for(int word = first_word; word < last_word; word++){
+                uint64_t unvisited = ~visited_[word].load(std::memory_order_relaxed);
+                if(word == word_count_ - 1 && (node_count_ & 63) != 0){
+                    unvisited &= ((uint64_t)1 << (node_count_ & 63)) - 1;
+                }
+                while(unvisited != 0){
+                    int node_id = word * 64 + __builtin_ctzll(unvisited);
+                    unvisited &= unvisited - 1;
+                    for(int edge_id = graph.getFirstEdge(node_id); edge_id < graph.getLastEdge(node_id); edge_id++){
+                        /* A forward search needs residual capacity from the parent towards this node */
+                        int step_edge = reverse_ ? edge_id : graph.getReverse(edge_id);
+                        if(testBit(frontier_.get(), graph.getHead(edge_id))
+                                && graph.getResidualCapacity(step_edge) > 0){
+                            setBit(visited_.get(), node_id);
+                            visit(node_id, step_edge, found_nodes, found_edges);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /* Runs on thread 0 between the two barriers of a level. */
+    void finishLevel(){
+        long long found_nodes = found_nodes_.load(std::memory_order_relaxed);
+        long long found_edges = found_edges_.load(std::memory_order_relaxed);
+        found_nodes_.store(0, std::memory_order_relaxed);
+        found_edges_.store(0, std::memory_order_relaxed);
+        next_chunk_.store(0, std::memory_order_relaxed);
+        /* Counted on thread 0, which is the thread that called run(). Bottom up steps scan less. */
+        SOLVER_COUNT(nodes_dequeued, frontier_nodes_);
+        SOLVER_COUNT(arcs_scanned, frontier_edges_);
+
+        unvisited_edges_ -= found_edges;
+        frontier_nodes_ = found_nodes;
+        frontier_edges_ = found_edges;
+        if(found_nodes == 0 || (stop_at_sink_ && isVisited(reverse_ ? graph_->getSource() : graph_->getSink()))){
+            done_ = true;
+            return;
+        }
+
+        if(!bottom_up_ && frontier_edges_ * BFS_TOP_DOWN_ALPHA > unvisited_edges_){
+            bottom_up_ = true;
+        } else if(bottom_up_ && frontier_nodes_ * BFS_BOTTOM_UP_BETA < node_count_){
+            bottom_up_ = false;
+        }
+
+        current_level_++;
+        frontier_.swap(next_frontier_);
+        for(int i = 0; i < word_count_; i++){
+            next_frontier_[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /* Pool thread, runs one worker() per search until the pool stops */
+    void poolWorker(int thread_id){
+        unsigned generation = 0;
+        while(true){
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                while(!stop_ && generation_ == generation){
+                    start_.wait(lock);
+                }
+                if(stop_){
+                    return;
+                }
+                generation = generation_;
+            }
+            worker(thread_id);
+            std::lock_guard<std::mutex> lock(mutex_);
+            if(--running_ == 0){
+                finish_.notify_one();
+            }
+        }
+    }
+
+    void worker(int thread_id){
+        while(true){
+            long long found_nodes = 0;
+            long long found_edges = 0;
+            if(bottom_up_){
+                bottomUpStep(found_nodes, found_edges);
+            } else {
+                topDownStep(found_nodes, found_edges);
+            }
+            found_nodes_.fetch_add(found_nodes, std::memory_order_relaxed);
+            found_edges_.fetch_add(found_edges, std::memory_order_relaxed);
+            barrier_.wait();
+            if(thread_id == 0){
+                finishLevel();
+            }
+            barrier_.wait();
+            if(done_){
+                return;
+            }
+        }
+    }
+
+    int node_count_;
+    int word_count_; /* 64 bit words per bitmap */
+    int thread_count_;
+    std::unique_ptr<std::atomic<uint64_t>[]> visited_; /* Bit per node, set once reached */
+    std::unique_ptr<std::atomic<uint64_t>[]> frontier_; /* Nodes of the current level */
+    std::unique_ptr<std::atomic<uint64_t>[]> next_frontier_; /* Nodes of the next level */
+    std::vector<int> parent_edge_; /* Edge each visited node was reached by */
+    std::vector<int> level_; /* BFS level of each visited node */
+
+    spinBarrier barrier_; /* Meets the threads after every level */
+    std::vector<std::thread> workers_; /* Pool threads, the caller of run() is thread 0 */
+    std::mutex mutex_; /* Guards the counters below */
+    std::condition_variable start_; /* Signalled when a search starts or the pool stops */
+    std::condition_variable finish_; /* Signalled when the last pool thread is done with a search */
+    bool stop_;
+    unsigned generation_; /* Bumped for every search */
+    int running_; /* Pool threads still working on the current search */
+
+    Graph* graph_; /* Graph of the running search */
+    bool stop_at_sink_;
+    bool reverse_; /* Searching from the target */
+    bool bottom_up_; /* Direction of the current level, only changed by thread 0 */
+    bool done_; /* Set by thread 0 when the search is over */
+    int current_level_; /* Level of the current frontier */
+    long long frontier_nodes_;
+    long long frontier_edges_; /* Edges out of the frontier */
+    long long unvisited_edges_; /* Edges out of nodes not visited yet */
+    std::atomic<int> next_chunk_; /* First bitmap word not claimed by a thread in this level */
+    std::atomic<long long> found_nodes_; /* Nodes added to the next frontier in this level */
+    std::atomic<long long> found_edges_; /* Edges out of those nodes */
+};
+
+#endif
@@ -0,0 +1,339 @@
+#ifndef PARALLEL_PUSH_RELABEL_H
+#define PARALLEL_PUSH_RELABEL_H
+
+#include<atomic>
+#include<deque>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include "residual_graph.h"
+#include "parallel_bfs.h"
+#include "push_relabel.h"
+#include "spin_barrier.h"
+#include "solver_counters.h"
+
+/*
+ * @brief    Per worker queue of active nodes. The owner works through it in
+ *          FIFO order, which keeps the labels close to exact between global
+ *          relabels, while idle workers steal the newest nodes from the back.
+ */
+class workStealingQueue{
+public:
+    void push(int node_id){
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodes_.push_back(node_id);
+    }
+    bool pop(int& node_id){
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(nodes_.empty()){
+            return false;
+        }
+        node_id = nodes_.front();
+        nodes_.pop_front();
+        return true;
+    }
+    bool steal(int& node_id){
+        std::lock_guard<std::mutex> lock(mutex_);
+        if(nodes_.empty()){
+            return false;
+        }
+        node_id = nodes_.back();
+        nodes_.pop_back();
+        return true;
+    }
+    void clear(){
+        std::lock_guard<std::mutex> lock(mutex_);
+        nodes_.clear();
+    }
+private:
+    std::mutex mutex_;
+    std::deque<int> nodes_;
+};
+
+/*
+ * @brief    Multithreaded push-relabel engine.
+ *
+ *          Pushes follow the lock free scheme of Hong: a worker owning an
+ *          active node pushes to its lowest residual neighbour if the node is
+ *          higher, and otherwise relabels it to one above that neighbour.
+ *          Residual capacities and excesses are changed with atomic fetch-add
+ *          only, heights are read without synchronisation.
+ *
+ *          Every active node has exactly one owner. Only the owner lowers the
+ *          excess of its node, so it keeps the node until its own update
+ *          brings the excess to 0. A worker whose push raises an excess from
+ *          0 becomes the owner of that node and queues it on its own deque.
+ *          Idle workers steal from the other deques.
+ *
+ *          Once the relabel work exceeds GLOBAL_RELABEL_ALPHA * V + E the
+ *          workers finish their current node and stop at a barrier, the
+ *          labels are recomputed by a parallel reverse BFS from the target
+ *          with the same number of threads, and the deques are refilled.
+ *          The same exact relabel runs when the workers run out of active
+ *          nodes, and the solve only ends when it finds none either.
+ *
+ *          Like pushRelabelSolver it first computes a maximum preflow, and
+ *          turns it into a flow only in PUSH_RELABEL_FULL_FLOW mode.
+ *
+ *          The excesses are 64 bit atomics, so the capacities must be
+ *          integers of at most 32 bits, see parallelPushRelabelSupports.
+ */
+/*
+ * True if parallelPushRelabel() can solve Graph: the excess of a node is a
+ * 64 bit atomic, which no sum of 32 bit capacities overflows.
+ */
+template<class Graph>
+struct parallelPushRelabelSupports{
+    static const bool value = std::is_integral<typename Graph::capacityType>::value
+        && sizeof(typename Graph::capacityType) <= 4;
+};
+
+template<class Graph>
+class parallelPushRelabelSolver{
+    static_assert(parallelPushRelabelSupports<Graph>::value, "Parallel push-relabel needs integral capacities of at most 32 bits");
+public:
+    typedef typename Graph::capacityType capacityType;
+
+    /*
+     * @param[in] graph         A flow network transformed into a residual graph
+     * @param[in] thread_count  Worker threads, 0 means one per hardware thread
+     */
+    parallelPushRelabelSolver(Graph& graph, int thread_count = 0) :
+        graph_(graph),
+        node_count_(graph.getNodeCount()),
+        height_(new std::atomic<int>[node_count_]),
+        excess_(new std::atomic<long long>[node_count_])
+    {
+        thread_count_ = thread_count > 0 ? thread_count : (int)std::thread::hardware_concurrency();
+        if(thread_count_ < 1){
+            thread_count_ = 1;
+        }
+        queues_.reset(new workStealingQueue[thread_count_]);
+    }
+
+    /*
+     * @brief   Compute a maximum preflow in the residual graph.
+     *
+     * @return  Returns the maximum flow possible in that flow network
+     */
+    long long computePreflow(){
+        const int source = graph_.getSource();
+        const int sink = graph_.getSink();
+        if(source == sink){
+            return 0;
+        }
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_PREFLOW);
+
+        for(int i = 0; i < node_count_; i++){
+            excess_[i].store(0, std::memory_order_relaxed);
+        }
+        for(int edge_id = graph_.getFirstEdge(source); edge_id < graph_.getLastEdge(source); edge_id++){
+            if(graph_.getResidualCapacity(edge_id) > 0 && graph_.getHead(edge_id) != source){
+                capacityType delta = graph_.getResidualCapacity(edge_id);
+                pushFlow(edge_id, delta);
+                excess_[graph_.getHead(edge_id)].fetch_add(delta, std::memory_order_relaxed);
+            }
+        }
+
+        globalRelabel();
+        spinBarrier barrier(thread_count_);
+        solverCountersFork counters(thread_count_);
+        std::vector<std::thread> workers;
+        for(int i = 1; i < thread_count_; i++){
+            workers.push_back(std::thread(&parallelPushRelabelSolver::worker, this, &barrier, i, counters.getThreadCounters(i)));
+        }
+        worker(&barrier, 0, counters.getThreadCounters(0));
+        for(size_t i = 0; i < workers.size(); i++){
+            workers[i].join();
+        }
+        return excess_[sink].load(std::memory_order_relaxed);
+    }
+
+    /* Turn the preflow into a flow, see pushRelabelSolver::convertPreflowToFlow(). */
+    void convertPreflowToFlow(){
+        pushRelabelSolver<Graph> serial(graph_);
+        serial.convertPreflowToFlow();
+    }
+
+    int getThreadCount(){return thread_count_;}
+private:
+    void pushFlow(int edge_id, capacityType delta){
+        SOLVER_COUNT(pushes, 1);
+        graph_.fetchAddResidualCapacity(edge_id, -delta);
+        graph_.fetchAddResidualCapacity(graph_.getReverse(edge_id), delta);
+    }
+
+    /*
+     * Exact labels from a parallel reverse BFS. Only runs while every worker
+     * is stopped, then hands out the active nodes round robin.
+     */
+    void globalRelabel(){
+        const int source = graph_.getSource();
+        const int sink = graph_.getSink();
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_GLOBAL_RELABEL);
+        SOLVER_COUNT(global_relabels, 1);
+        if(search_.get() == NULL){
+            search_.reset(new parallelBfs<Graph>(node_count_, thread_count_));
+        }
+        search_->run(graph_, false, true);
+
+        int active = 0;
+        for(int i = 0; i < thread_count_; i++){
+            queues_[i].clear();
+        }
+        for(int i = 0; i < node_count_; i++){
+            int height = i != source && search_->isVisited(i) ? search_->getLevel(i) : node_count_;
+            height_[i].store(height, std::memory_order_relaxed);
+            if(i != source && i != sink && height < node_count_ && excess_[i].load(std::memory_order_relaxed) > 0){
+                queues_[active % thread_count_].push(i);
+                active++;
+            }
+        }
+        active_count_.store(active, std::memory_order_relaxed);
+        relabel_work_.store(0, std::memory_order_relaxed);
+        relabel_requested_.store(false, std::memory_order_relaxed);
+    }
+
+    bool nextNode(int thread_id, int& node_id){
+        if(queues_[thread_id].pop(node_id)){
+            return true;
+        }
+        for(int i = 1; i < thread_count_; i++){
+            if(queues_[(thread_id + i) % thread_count_].steal(node_id)){
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+     * Push the excess of an owned node until it is used up or the node is
+     * lifted out of reach of the target. Returns early, with the node queued
+     * again, if a global relabel was requested.
+     */
+    void discharge(int thread_id, int node_id){
+        const int sink = graph_.getSink();
+        const int source = graph_.getSource();
+        const int work_limit = GLOBAL_RELABEL_ALPHA * node_count_ + graph_.getEdgeCount();
+        while(true){
+            if(relabel_requested_.load(std::memory_order_relaxed)){
+                queues_[thread_id].push(node_id);
+                return;
+            }
+
+            long long excess = excess_[node_id].load(std::memory_order_relaxed);
+            int height = height_[node_id].load(std::memory_order_relaxed);
+            int best_edge = INVALID_PARENT;
+            int best_height = INT_MAX;
+            for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+                if(graph_.loadResidualCapacity(edge_id) > 0){
+                    int next_height = height_[graph_.getHead(edge_id)].load(std::memory_order_relaxed);
+                    if(next_height < best_height){
+                        best_height = next_height;
+                        best_edge = edge_id;
+                    }
+                }
+            }
+
+            if(best_edge != INVALID_PARENT && height > best_height){
+                int next_node = graph_.getHead(best_edge);
+                capacityType residual = graph_.loadResidualCapacity(best_edge);
+                capacityType delta = excess < (long long)residual ? (capacityType)excess : residual;
+                pushFlow(best_edge, delta);
+                if(excess_[next_node].fetch_add(delta, std::memory_order_relaxed) == 0
+                        && next_node != sink && next_node != source){
+                    /* This push activated the node, so this worker owns it now */
+                    active_count_.fetch_add(1, std::memory_order_relaxed);
+                    queues_[thread_id].push(next_node);
+                }
+                if(excess_[node_id].fetch_sub(delta, std::memory_order_relaxed) == (long long)delta){
+                    active_count_.fetch_sub(1, std::memory_order_relaxed);
+                    return;
+                }
+                continue;
+            }
+
+            /* Relabel one above the lowest residual neighbour */
+            SOLVER_COUNT(relabels, 1);
+            int new_height = best_edge == INVALID_PARENT || best_height >= node_count_ ? node_count_ : best_height + 1;
+            height_[node_id].store(new_height, std::memory_order_relaxed);
+            int work = GLOBAL_RELABEL_BETA + graph_.getLastEdge(node_id) - graph_.getFirstEdge(node_id);
+            if(relabel_work_.fetch_add(work, std::memory_order_relaxed) + work > work_limit){
+                relabel_requested_.store(true, std::memory_order_relaxed);
+            }
+            if(new_height >= node_count_){
+                /* Can not reach the target any more, its excess stays for phase two */
+                active_count_.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+
+    void worker(spinBarrier* barrier, int thread_id, solverCounters* counters){
+        solverCountersScope counters_scope(counters);
+        while(true){
+            while(active_count_.load(std::memory_order_relaxed) > 0
+                    && !relabel_requested_.load(std::memory_order_relaxed)){
+                int node_id;
+                if(nextNode(thread_id, node_id)){
+                    discharge(thread_id, node_id);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+            barrier->wait();
+            if(thread_id == 0){
+                /*
+                 * Labels read without synchronisation can be stale, so a node
+                 * may have been given up too early. Only exact labels can
+                 * prove that no excess can reach the target any more.
+                 */
+                globalRelabel();
+                done_ = active_count_.load(std::memory_order_relaxed) == 0;
+            }
+            barrier->wait();
+            if(done_){
+                return;
+            }
+        }
+    }
+
+    Graph& graph_;
+    int node_count_;
+    int thread_count_;
+    std::unique_ptr<std::atomic<int>[]> height_; /* Distance label, V means out of reach of the target */
+    std::unique_ptr<std::atomic<long long>[]> excess_; /* Inflow minus outflow per node */
+    std::unique_ptr<workStealingQueue[]> queues_; /* One deque of owned active nodes per worker */
+    std::unique_ptr<parallelBfs<Graph> > search_; /* Reverse BFS used by the global relabel */
+    std::atomic<int> active_count_; /* Owned active nodes, queued or being discharged */
+    std::atomic<int> relabel_work_; /* Relabel work since the last global relabel */
+    std::atomic<bool> relabel_requested_;
+    bool done_; /* Set by worker 0 between the barriers */
+};
+
+/*
+ * @brief   Compute the maximum flow with the multithreaded push-relabel engine.
+ *
+ * @param [in]  graph           A flow network transformed into a residual graph
+ *                              with back edges
+ * @param [in]  thread_count    Worker threads, 0 means one per hardware thread.
+ *                              The default value is 0.
+ * @param [in]  mode            PUSH_RELABEL_FULL_FLOW or PUSH_RELABEL_PREFLOW_ONLY,
+ *                              as for pushRelabel(). The default value is
+ *                              PUSH_RELABEL_FULL_FLOW.
+ *
+ * @return  Returns the maximum flow possible in that flow network
+ */
+template<class Graph>
+long long parallelPushRelabel(Graph& graph, int thread_count = 0, int mode = PUSH_RELABEL_FULL_FLOW){
+    parallelPushRelabelSolver<Graph> solver(graph, thread_count);
+    long long max_flow = solver.computePreflow();
+    if(mode == PUSH_RELABEL_FULL_FLOW){
+        solver.convertPreflowToFlow();
+    }
+    return max_flow;
+}
+
+#endif
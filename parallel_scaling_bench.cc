@@ -0,0 +1,64 @@
+#include<iostream>
+#include<cstdlib>
+#include<chrono>
+#include<thread>
+
+#include "max_flow.h"
+#include "graph_generators.h"
+
+using namespace std;
+
+/*
+ * @brief   Strong scaling benchmark of the parallel push-relabel engine. The
+ *          serial push-relabel engine is the baseline, then the parallel one
+ *          runs on the same graph with 1, 2, 4, ... threads up to the number
+ *          of hardware threads, each on a fresh copy of the graph.
+ *
+ *          Build: g++ -std=c++17 -O2 -pthread parallel_scaling_bench.cc -o parallel_scaling_bench
+ *          Usage: parallel_scaling_bench [layers] [width] [degree] [max threads]
+ *
+ * @return Returns 0 on success, 1 if an engine disagrees on the flow value
+ */
+int main(int argc, char** argv){
+    const int layers = argc > 1 ? atoi(argv[1]) : 64;
+    const int width = argc > 2 ? atoi(argv[2]) : 2048;
+    const int degree = argc > 3 ? atoi(argv[3]) : 4;
+    int max_threads = argc > 4 ? atoi(argv[4]) : (int)thread::hardware_concurrency();
+    if(layers < 1 || width < 1 || degree < 1){
+        cerr<<"Usage: parallel_scaling_bench [layers] [width] [degree] [max threads]\n";
+        return 1;
+    }
+    if(max_threads < 1){
+        max_threads = 1;
+    }
+
+    residualGraph<>* graph = buildLayeredGraph(layers, width, degree, 1);
+    cout<<"Layered graph: "<<graph->getNodeCount()<<" nodes, "<<graph->getEdgeCount()<<" edges\n";
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    const long long expected_flow = pushRelabel(*graph);
+    double serial_seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    delete graph;
+    cout<<"serial push-relabel: flow "<<expected_flow<<", "<<serial_seconds<<" s\n";
+
+    for(int threads = 1; ; threads *= 2){
+        if(threads > max_threads){
+            threads = max_threads;
+        }
+        graph = buildLayeredGraph(layers, width, degree, 1);
+        start = chrono::steady_clock::now();
+        long long max_flow = parallelPushRelabel(*graph, threads);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        delete graph;
+        cout<<"parallel push-relabel, "<<threads<<" threads: flow "<<max_flow<<", "<<seconds
+            <<" s, speedup "<<serial_seconds / seconds<<"\n";
+        if(max_flow != expected_flow){
+            cerr<<"Flow mismatch with the serial engine\n";
+            return 1;
+        }
+        if(threads == max_threads){
+            break;
+        }
+    }
+
+    return 0;
+}
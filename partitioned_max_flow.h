@@ -0,0 +1,590 @@
+#ifndef PARTITIONED_MAX_FLOW_H
+#define PARTITIONED_MAX_FLOW_H
+
+#include<algorithm>
+#include<cstdint>
+#include<iostream>
+#include<utility>
+#include<vector>
+
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+#include "graph_file.h"
+#include "min_cut_bitmap.h"
+#include "push_relabel.h"
+#include "solver_counters.h"
+
+#define PARTITIONED_QUEUE_COMPACTION 4096 /* Discharged entries at the front of the queue before they are dropped */
+
+/*
+ * @brief    Region push-relabel max flow on a graph file whose edges do not
+ *          have to fit in memory, after Delong and Boykov.
+ *
+ *          The nodes are split into shards of consecutive ids with about the
+ *          same number of edges. As the edges of a graph file are grouped by
+ *          tail node, the edges of a shard are one range of each section, and
+ *          only the shard being worked on is mapped: heads and back edges
+ *          read only, residual capacities shared and writable, so the file
+ *          itself ends up holding the flow. What stays in memory is per node:
+ *          the edge offsets, a label and an excess, about 16 bytes a node.
+ *
+ *          Before every round a global relabel sets every label to the exact
+ *          distance to the target, in sweeps over the shards, see
+ *          relabelAll(). A round then discharges every shard with active
+ *          nodes in turn. The labels of a shard are first raised to the exact distances to the
+ *          target that the labels outside it allow, a BFS inside the shard
+ *          seeded from the edges that leave it. Then its active nodes are
+ *          discharged FIFO as in push-relabel, pushing into nodes outside
+ *          the shard like into the target, over edges going one label down,
+ *          and relabeling the shard again when relabels get expensive.
+ *          The only state shared between shards is the labels and excesses,
+ *          which stay in memory, and the residual capacity added to the back
+ *          edge of every edge flow left the shard over. That boundary change
+ *          belongs to the shard of the other end and is queued for it until
+ *          it is mapped again. Labels never decrease and stay valid across
+ *          shards, so the rounds end with a maximum preflow once no node
+ *          below label V has any excess.
+ *
+ *          Like pushRelabel() in PUSH_RELABEL_PREFLOW_ONLY mode, the file is
+ *          left with a maximum preflow: the flow value and a minimum cut are
+ *          exact, the flows of single edges are not a flow. The file must
+ *          hold no flow when solve() starts; copy it first to keep it.
+ */
+class partitionedMaxFlow{
+public:
+    typedef capacityValue<residualCapacityStorage>::type capacityType;
+    typedef flowValue<residualCapacityStorage>::type flowType;
+
+    partitionedMaxFlow() :
+        fd_(-1),
+        node_count_(0),
+        edge_count_(0),
+        source_(0),
+        sink_(0),
+        round_count_(0),
+        load_count_(0),
+        solved_(false),
+        shard_(INVALID_PARENT),
+        relabel_work_(0)
+    {
+    }
+
+    ~partitionedMaxFlow(){close();}
+
+    /*
+     * @brief   Open a graph file written by writeGraphFile() for solving in
+     *          place and split it into shards. Only the header and the edge
+     *          offsets are read.
+     *
+     * @param[in] path          Graph file, which must be writable
+     * @param[in] shard_count   Shards to split the nodes into, fewer if there are
+     *                          not that many nodes. The edges of one shard are what
+     *                          has to fit in memory.
+     *
+     * @return  True if the file is a valid graph file
+     */
+    bool open(const char* path, int shard_count){
+        close();
+        fd_ = ::open(path, O_RDWR);
+        if(fd_ < 0){
+            std::cerr<<"Failed to open the graph file "<<path<<" for writing\n";
+            return false;
+        }
+        struct stat file_stat;
+        if(fstat(fd_, &file_stat) != 0 || pread(fd_, &header_, sizeof(header_), 0) != (ssize_t)sizeof(header_)
+                || !checkGraphFileHeader(header_, file_stat.st_size)){
+            std::cerr<<"The graph file "<<path<<" is invalid or was written with another capacity type\n";
+            close();
+            return false;
+        }
+        node_count_ = header_.node_count;
+        edge_count_ = header_.edge_count;
+        source_ = header_.source;
+        sink_ = header_.sink;
+        offsets_.resize(node_count_ + 1);
+        const ssize_t offset_bytes = sizeof(int32_t) * (node_count_ + 1);
+        if(pread(fd_, offsets_.data(), offset_bytes, header_.offsets_offset) != offset_bytes
+                || offsets_[0] != 0 || offsets_[node_count_] != edge_count_){
+            std::cerr<<"The graph file "<<path<<" has inconsistent edge offsets\n";
+            close();
+            return false;
+        }
+
+        /* Shard k starts at the first node whose edges start at k E / K or later */
+        shard_count = std::max(1, std::min(shard_count, node_count_));
+        shard_first_.assign(1, 0);
+        for(int k = 1; k < shard_count; k++){
+            const int32_t first_edge = (int32_t)((long long)edge_count_ * k / shard_count);
+            const int first = (int)(std::lower_bound(offsets_.begin(), offsets_.end() - 1, first_edge) - offsets_.begin());
+            if(first > shard_first_.back() && first < node_count_){
+                shard_first_.push_back(first);
+            }
+        }
+        shard_first_.push_back(node_count_);
+        int largest = 0;
+        for(int k = 0; k + 1 < (int)shard_first_.size(); k++){
+            largest = std::max(largest, shard_first_[k + 1] - shard_first_[k]);
+        }
+        labels_.assign(node_count_, 0);
+        excess_.assign(node_count_, 0);
+        current_edge_.resize(largest);
+        queued_.resize(largest);
+        bfs_labels_.resize(largest);
+        boundary_changes_.assign(getShardCount(), std::vector<boundaryChange>());
+        active_.assign(getShardCount(), 0);
+        return true;
+    }
+
+    /* Close the file, writing back the boundary changes still queued. */
+    void close(){
+        if(fd_ >= 0){
+            unloadShard();
+            for(int k = 0; k < getShardCount(); k++){
+                if(!boundary_changes_[k].empty() && loadShard(k)){
+                    unloadShard();
+                }
+            }
+            ::close(fd_);
+        }
+        fd_ = -1;
+        node_count_ = 0;
+        edge_count_ = 0;
+        round_count_ = 0;
+        solved_ = false;
+        std::vector<int32_t>().swap(offsets_);
+        std::vector<int>().swap(shard_first_);
+        std::vector<int>().swap(labels_);
+        std::vector<flowType>().swap(excess_);
+        std::vector<std::vector<boundaryChange> >().swap(boundary_changes_);
+        std::vector<char>().swap(active_);
+    }
+
+    /*
+     * @brief   Compute a maximum preflow into the file, see the class.
+     *
+     * @param[out] max_flow     Receives the maximum flow possible in the network
+     *
+     * @return  False if no file is open or a shard could not be mapped
+     */
+    bool solve(flowType& max_flow){
+        if(fd_ < 0){
+            return false;
+        }
+        if(node_count_ == 0){
+            max_flow = 0;
+            solved_ = true;
+            return true;
+        }
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_PREFLOW);
+        round_count_ = 0;
+        load_count_ = 0;
+        solved_ = false;
+        for(int i = 0; i < node_count_; i++){
+            labels_[i] = 0;
+            excess_[i] = 0;
+        }
+        labels_[source_] = node_count_;
+        if(source_ != sink_){
+            /* Saturate every edge out of the source */
+            const int source_shard = getShardOf(source_);
+            if(!loadShard(source_shard)){
+                return false;
+            }
+            for(int edge_id = offsets_[source_]; edge_id < offsets_[source_ + 1]; edge_id++){
+                if(getResidual(edge_id) > 0 && getHead(edge_id) != source_){
+                    pushFlow(source_, edge_id, getResidual(edge_id));
+                }
+            }
+            active_[source_shard] = 1;
+            unloadShard();
+        }
+        /* The last global relabel gives the labels of the cut and writes back the last boundary changes */
+        while(true){
+            if(!relabelAll()){
+                return false;
+            }
+            if(std::find(active_.begin(), active_.end(), 1) == active_.end()){
+                break;
+            }
+            round_count_++;
+            for(int k = 0; k < getShardCount(); k++){
+                if(active_[k] != 0 && !dischargeShard(k)){
+                    return false;
+                }
+            }
+        }
+        max_flow = source_ != sink_ ? excess_[sink_] : 0;
+        solved_ = true;
+        return true;
+    }
+
+    /*
+     * @brief   Minimum cut of the last solve: the s side is every node that can
+     *          no longer reach the target, as MIN_CUT_FROM_TARGET takes it.
+     *
+     * @return  False if nothing was solved yet
+     */
+    bool getMinCut(minCutBitmap& s_side){
+        if(!solved_){
+            return false;
+        }
+        s_side.reset(node_count_);
+        for(int i = 0; i < node_count_; i++){
+            if(labels_[i] >= node_count_ && i != sink_){
+                s_side.setSourceSide(i);
+            }
+        }
+        return true;
+    }
+
+    int getNodeCount(){return node_count_;}
+    int getEdgeCount(){return edge_count_;}
+    int getShardCount(){return shard_first_.empty() ? 0 : (int)shard_first_.size() - 1;}
+    /* Nodes of shard k are [getShardFirstNode(k), getShardFirstNode(k + 1)) */
+    int getShardFirstNode(int shard){return shard_first_[shard];}
+    /* Rounds over the active shards the last solve took */
+    int getRoundCount(){return round_count_;}
+    /* Times the last solve mapped a shard, each reads and writes back its edges once */
+    long long getShardLoadCount(){return load_count_;}
+private:
+    partitionedMaxFlow(const partitionedMaxFlow&);
+    partitionedMaxFlow& operator=(const partitionedMaxFlow&);
+
+    /* Residual capacity to add to an edge of another shard */
+    struct boundaryChange{
+        int edge_id;
+        capacityType amount;
+    };
+
+    /* One section range of the mapped shard */
+    struct sectionMapping{
+        void* base;
+        size_t length;
+    };
+
+    int getShardOf(int node_id){
+        return (int)(std::upper_bound(shard_first_.begin(), shard_first_.end(), node_id) - shard_first_.begin()) - 1;
+    }
+    bool isInShard(int node_id){return node_id >= first_node_ && node_id < last_node_;}
+
+    /* Edges of the mapped shard, by edge id */
+    int getHead(int edge_id){return heads_[edge_id - first_edge_];}
+    int getReverse(int edge_id){return reverses_[edge_id - first_edge_];}
+    capacityType getResidual(int edge_id){return residual_capacities_[edge_id - first_edge_];}
+    void addResidual(int edge_id, capacityType amount){residual_capacities_[edge_id - first_edge_] += amount;}
+
+    /* Map count values at byte offset offset of the file, NULL if it fails */
+    template<class T>
+    T* mapSection(uint64_t offset, int count, int protection, sectionMapping& mapping){
+        const uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+        const uint64_t start = offset / page * page;
+        mapping.length = (size_t)(offset - start + sizeof(T) * (uint64_t)count);
+        mapping.base = mmap(NULL, mapping.length, protection, MAP_SHARED, fd_, (off_t)start);
+        if(mapping.base == MAP_FAILED){
+            mapping.base = NULL;
+            return NULL;
+        }
+        madvise(mapping.base, mapping.length, MADV_WILLNEED);
+        return reinterpret_cast<T*>(static_cast<char*>(mapping.base) + (offset - start));
+    }
+
+    /* Map the edges of a shard and apply the boundary changes queued for it, false if it can not be mapped */
+    bool loadShard(int shard){
+        unloadShard();
+        first_node_ = shard_first_[shard];
+        last_node_ = shard_first_[shard + 1];
+        first_edge_ = offsets_[first_node_];
+        const int count = offsets_[last_node_] - first_edge_;
+        for(int i = 0; i < 3; i++){
+            mappings_[i].base = NULL;
+        }
+        if(count > 0){
+            heads_ = mapSection<const int32_t>(header_.heads_offset + sizeof(int32_t) * (uint64_t)first_edge_, count, PROT_READ, mappings_[0]);
+            reverses_ = mapSection<const int32_t>(header_.reverses_offset + sizeof(int32_t) * (uint64_t)first_edge_, count, PROT_READ, mappings_[1]);
+            residual_capacities_ = mapSection<residualCapacityStorage>(header_.residual_offset + sizeof(residualCapacityStorage) * (uint64_t)first_edge_,
+                count, PROT_READ | PROT_WRITE, mappings_[2]);
+            if(heads_ == NULL || reverses_ == NULL || residual_capacities_ == NULL){
+                shard_ = shard;
+                unloadShard();
+                return false;
+            }
+        }
+        shard_ = shard;
+        load_count_++;
+        std::vector<boundaryChange>& changes = boundary_changes_[shard];
+        for(size_t i = 0; i < changes.size(); i++){
+            addResidual(changes[i].edge_id, changes[i].amount);
+        }
+        changes.clear();
+        return true;
+    }
+
+    void unloadShard(){
+        if(shard_ == INVALID_PARENT){
+            return;
+        }
+        for(int i = 0; i < 3; i++){
+            if(mappings_[i].base != NULL){
+                munmap(mappings_[i].base, mappings_[i].length);
+                mappings_[i].base = NULL;
+            }
+        }
+        shard_ = INVALID_PARENT;
+    }
+
+    /* Push over an edge of the mapped shard, queueing the back edge change if it leaves the shard */
+    void pushFlow(int node_id, int edge_id, capacityType amount){
+        const int next_node = getHead(edge_id);
+        addResidual(edge_id, -amount);
+        excess_[node_id] -= amount;
+        excess_[next_node] += amount;
+        SOLVER_COUNT(pushes, 1);
+        if(isInShard(next_node)){
+            addResidual(getReverse(edge_id), amount);
+            enqueue(next_node);
+            return;
+        }
+        const int next_shard = getShardOf(next_node);
+        boundaryChange change = {getReverse(edge_id), amount};
+        boundary_changes_[next_shard].push_back(change);
+        if(next_node != sink_ && next_node != source_){
+            active_[next_shard] = 1;
+        }
+    }
+
+    void enqueue(int node_id){
+        const int index = node_id - first_node_;
+        if(node_id != source_ && node_id != sink_ && queued_[index] == 0
+                && excess_[node_id] > 0 && labels_[node_id] < node_count_){
+            queued_[index] = 1;
+            queue_.push_back(node_id);
+        }
+    }
+
+    /* Lowest label a node can take, one above its lowest residual neighbour, at most V */
+    void relabel(int node_id){
+        SOLVER_COUNT(relabels, 1);
+        int lowest = node_count_ - 1;
+        for(int edge_id = offsets_[node_id]; edge_id < offsets_[node_id + 1]; edge_id++){
+            if(getResidual(edge_id) > 0){
+                lowest = std::min(lowest, labels_[getHead(edge_id)]);
+            }
+        }
+        labels_[node_id] = lowest + 1;
+        current_edge_[node_id - first_node_] = offsets_[node_id];
+        relabel_work_ += GLOBAL_RELABEL_BETA + offsets_[node_id + 1] - offsets_[node_id];
+    }
+
+    void discharge(int node_id){
+        while(excess_[node_id] > 0 && labels_[node_id] < node_count_){
+            int& edge_id = current_edge_[node_id - first_node_];
+            if(edge_id == offsets_[node_id + 1]){
+                relabel(node_id);
+                continue;
+            }
+            const capacityType residual = getResidual(edge_id);
+            if(residual > 0 && labels_[node_id] == labels_[getHead(edge_id)] + 1){
+                const capacityType amount = excess_[node_id] < (flowType)residual ? (capacityType)excess_[node_id] : residual;
+                pushFlow(node_id, edge_id, amount);
+                if(amount == residual){
+                    edge_id++;
+                }
+            } else {
+                edge_id++;
+            }
+        }
+    }
+
+    /*
+     * @brief   Discharge every active node of a shard, FIFO. The labels of the
+     *          shard are made exact again once the relabel work is over
+     *          GLOBAL_RELABEL_ALPHA * V + E of the shard, as in pushRelabel().
+     */
+    bool dischargeShard(int shard){
+        if(!loadShard(shard)){
+            return false;
+        }
+        active_[shard] = 0;
+        const int work_limit = GLOBAL_RELABEL_ALPHA * (last_node_ - first_node_) + offsets_[last_node_] - offsets_[first_node_];
+        restartShard();
+        size_t head = 0;
+        while(head < queue_.size()){
+            const int node_id = queue_[head++];
+            queued_[node_id - first_node_] = 0;
+            discharge(node_id);
+            if(relabel_work_ > work_limit){
+                restartShard();
+                head = 0;
+            } else if(head >= PARTITIONED_QUEUE_COMPACTION && 2 * head >= queue_.size()){
+                queue_.erase(queue_.begin(), queue_.begin() + head);
+                head = 0;
+            }
+        }
+        unloadShard();
+        return true;
+    }
+
+    /* Relabel the mapped shard and queue its active nodes again */
+    void restartShard(){
+        relabelShard();
+        relabel_work_ = 0;
+        queue_.clear();
+        for(int node_id = first_node_; node_id < last_node_; node_id++){
+            current_edge_[node_id - first_node_] = offsets_[node_id];
+            queued_[node_id - first_node_] = 0;
+            enqueue(node_id);
+        }
+    }
+
+    /*
+     * @brief   Distances to the target through the mapped shard into
+     *          bfs_labels_, with the labels outside it taken as the distances
+     *          of those nodes. A node one edge away from a node v outside
+     *          starts at the label of v plus one, those seeds are expanded in
+     *          label order over the back edges inside the shard.
+     */
+    void searchShard(){
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_GLOBAL_RELABEL);
+        SOLVER_COUNT(global_relabels, 1);
+        seeds_.clear();
+        for(int node_id = first_node_; node_id < last_node_; node_id++){
+            bfs_labels_[node_id - first_node_] = node_count_;
+            if(node_id == sink_){
+                seeds_.push_back(std::make_pair(0, node_id));
+            }
+            if(node_id == source_ || node_id == sink_){
+                continue;
+            }
+            int seed = node_count_;
+            for(int edge_id = offsets_[node_id]; edge_id < offsets_[node_id + 1]; edge_id++){
+                const int next_node = getHead(edge_id);
+                if(!isInShard(next_node) && getResidual(edge_id) > 0){
+                    seed = std::min(seed, labels_[next_node] + 1);
+                }
+            }
+            if(seed < node_count_){
+                seeds_.push_back(std::make_pair(seed, node_id));
+            }
+        }
+        std::sort(seeds_.begin(), seeds_.end());
+
+        /* Both the seeds and the queue come in label order, merge them */
+        queue_.clear();
+        size_t next_seed = 0;
+        size_t head = 0;
+        while(next_seed < seeds_.size() || head < queue_.size()){
+            int node_id;
+            int label;
+            if(head == queue_.size() || (next_seed < seeds_.size()
+                    && seeds_[next_seed].first <= bfs_labels_[queue_[head] - first_node_])){
+                label = seeds_[next_seed].first;
+                node_id = seeds_[next_seed].second;
+                next_seed++;
+                if(label >= bfs_labels_[node_id - first_node_]){
+                    continue;
+                }
+                bfs_labels_[node_id - first_node_] = label;
+            } else {
+                node_id = queue_[head++];
+                label = bfs_labels_[node_id - first_node_];
+            }
+            SOLVER_COUNT(nodes_dequeued, 1);
+            SOLVER_COUNT(arcs_scanned, offsets_[node_id + 1] - offsets_[node_id]);
+            for(int edge_id = offsets_[node_id]; edge_id < offsets_[node_id + 1]; edge_id++){
+                const int previous = getHead(edge_id);
+                if(isInShard(previous) && previous != source_ && previous != sink_
+                        && label + 1 < bfs_labels_[previous - first_node_] && getResidual(getReverse(edge_id)) > 0){
+                    bfs_labels_[previous - first_node_] = label + 1;
+                    queue_.push_back(previous);
+                }
+            }
+        }
+    }
+
+    /*
+     * @brief   Raise the labels of the mapped shard as far as the labels
+     *          outside it allow, a global relabel restricted to the shard.
+     *          Valid labels never exceed those distances.
+     */
+    void relabelShard(){
+        searchShard();
+        for(int node_id = first_node_; node_id < last_node_; node_id++){
+            if(node_id != source_ && node_id != sink_){
+                labels_[node_id] = std::max(labels_[node_id], bfs_labels_[node_id - first_node_]);
+            }
+        }
+    }
+
+    /*
+     * @brief   Global relabel: set every label to the exact distance to the
+     *          target, V if there is none. Starting from V, the labels of each
+     *          shard are lowered to searchShard() in sweeps over the shards,
+     *          alternately forward and backward, until a sweep changes none.
+     *          Every label stays at least the distance, so this takes about as
+     *          many sweeps as the shortest paths cross shards. Raising the
+     *          current labels instead would count up to V one boundary
+     *          crossing at a time for the nodes that can not reach the target.
+     */
+    bool relabelAll(){
+        for(int i = 0; i < node_count_; i++){
+            labels_[i] = node_count_;
+        }
+        labels_[sink_] = 0;
+        bool changed = true;
+        for(int sweep = 0; changed; sweep++){
+            changed = false;
+            for(int i = 0; i < getShardCount(); i++){
+                const int shard = sweep % 2 == 0 ? i : getShardCount() - 1 - i;
+                if(!loadShard(shard)){
+                    return false;
+                }
+                searchShard();
+                for(int node_id = first_node_; node_id < last_node_; node_id++){
+                    if(bfs_labels_[node_id - first_node_] < labels_[node_id] && node_id != source_ && node_id != sink_){
+                        labels_[node_id] = bfs_labels_[node_id - first_node_];
+                        changed = true;
+                    }
+                }
+                unloadShard();
+            }
+        }
+        return true;
+    }
+
+    int fd_;
+    graphFileHeader header_;
+    int node_count_;
+    int edge_count_;
+    int source_; /* Id of the source node */
+    int sink_; /* Id of the target node */
+    int round_count_;
+    long long load_count_;
+    bool solved_;
+    std::vector<int32_t> offsets_; /* Edge offsets of the file, node_count_ + 1 entries */
+    std::vector<int> shard_first_; /* First node of each shard, node_count_ at the end */
+    std::vector<int> labels_; /* Distance label of each node, V for those that can not reach the target */
+    std::vector<flowType> excess_; /* Flow into each node minus flow out of it */
+    std::vector<std::vector<boundaryChange> > boundary_changes_; /* Queued changes by shard */
+    std::vector<char> active_; /* 1 for the shards that may have active nodes */
+
+    int shard_; /* Mapped shard, INVALID_PARENT for none */
+    int first_node_; /* Nodes [first_node_, last_node_) of the mapped shard */
+    int last_node_;
+    int first_edge_; /* Edge id of heads_[0] */
+    const int32_t* heads_;
+    const int32_t* reverses_;
+    residualCapacityStorage* residual_capacities_;
+    sectionMapping mappings_[3]; /* Heads, back edges and residual capacities */
+
+    int relabel_work_; /* Work done by relabels since the shard was last relabeled */
+    std::vector<int> current_edge_; /* Next edge to try by node of the mapped shard */
+    std::vector<char> queued_; /* 1 while a node of the mapped shard is in queue_ */
+    std::vector<int> bfs_labels_; /* Labels found by relabelShard() by node of the mapped shard */
+    std::vector<int> queue_; /* Active nodes, or the BFS queue of relabelShard() */
+    std::vector<std::pair<int, int> > seeds_; /* Label and node of the BFS starts */
+};
+
+#endif
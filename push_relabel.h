@@ -0,0 +1,429 @@
+#ifndef PUSH_RELABEL_H
+#define PUSH_RELABEL_H
+
+#include<climits>
+#include<type_traits>
+
+#include "residual_graph.h"
+#include "solver_counters.h"
+
+#define PUSH_RELABEL_FULL_FLOW 0 /* Compute a preflow and convert it into a flow */
+#define PUSH_RELABEL_PREFLOW_ONLY 1 /* Stop after the minimum cut is known */
+
+/* Global relabeling runs once the relabel work exceeds GLOBAL_RELABEL_ALPHA * V + E */
+#define GLOBAL_RELABEL_ALPHA 6
+#define GLOBAL_RELABEL_BETA 12 /* Fixed work charged for every relabel */
+
+/*
+ * @brief    Highest label push-relabel max flow engine in the style of HIPR.
+ *
+ *          Phase one (computePreflow) discharges active nodes highest label
+ *          first. Active nodes are kept in one bucket per label and every node
+ *          below the removal label V is also kept in a doubly linked list per
+ *          label, which is what the gap heuristic needs: when the last node of
+ *          a label is relabeled, every node above it can no longer reach the
+ *          target and is removed at once. Labels are periodically recomputed
+ *          exactly by a reverse BFS from the target (global relabeling).
+ *
+ *          At the end of phase one the residual graph holds a maximum
+ *          preflow. The flow value is known and the nodes that can still
+ *          reach the target form the t side of a minimum cut, so
+ *          findMinCut(graph, MIN_CUT_FROM_TARGET) can be used directly.
+ *          Phase two (convertPreflowToFlow) sends the remaining excess back
+ *          to the source, after which the residual graph holds a proper flow
+ *          just like the other engines leave it.
+ *
+ *          The excess tests are exact, so the capacities must be integers,
+ *          see pushRelabelSupports.
+ */
+/*
+ * True if pushRelabel() can solve Graph. With floating point capacities
+ * rounding leaves tiny excesses that no admissible edge can take, and the
+ * discharge loops never end.
+ */
+template<class Graph>
+struct pushRelabelSupports{
+    static const bool value = std::is_integral<typename Graph::capacityType>::value;
+};
+
+template<class Graph>
+class pushRelabelSolver{
+    static_assert(pushRelabelSupports<Graph>::value, "Push-relabel needs integral capacities");
+public:
+    typedef typename Graph::capacityType capacityType;
+    typedef typename Graph::flowType flowType;
+
+    /*
+     * @param[in] graph  A flow network transformed into a residual graph
+     * @param[in] arena  Scratch arena for the per node buffers, NULL to use the heap.
+     *                   The buffers stay in the arena until the caller's scratchScope ends.
+     */
+    pushRelabelSolver(Graph& graph, scratchArena* arena = NULL) :
+        graph_(graph),
+        node_count_(graph.getNodeCount()),
+        label_(node_count_, arena),
+        excess_(node_count_, arena),
+        current_edge_(node_count_, arena),
+        active_head_(node_count_, arena),
+        next_active_(node_count_, arena),
+        label_head_(node_count_, arena),
+        label_next_(node_count_, arena),
+        label_prev_(node_count_, arena)
+    {
+    }
+
+    /*
+     * @brief   Phase one. Computes a maximum preflow in the residual graph.
+     *
+     * @return  Returns the maximum flow possible in that flow network
+     */
+    flowType computePreflow(){
+        const int source = graph_.getSource();
+        const int sink = graph_.getSink();
+        if(source == sink){
+            return 0;
+        }
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_PREFLOW);
+
+        for(int i = 0; i < node_count_; i++){
+            excess_[i] = 0;
+        }
+        /* Saturate every edge out of the source */
+        for(int edge_id = graph_.getFirstEdge(source); edge_id < graph_.getLastEdge(source); edge_id++){
+            if(graph_.getResidualCapacity(edge_id) > 0 && graph_.getHead(edge_id) != source){
+                pushFlow(edge_id, graph_.getResidualCapacity(edge_id));
+            }
+        }
+
+        globalRelabel();
+        while(max_active_ >= 0){
+            int node_id = active_head_[max_active_];
+            if(node_id == INVALID_PARENT){
+                max_active_--;
+                continue;
+            }
+            active_head_[max_active_] = next_active_[node_id];
+            discharge(node_id);
+
+            if(relabel_work_ > GLOBAL_RELABEL_ALPHA * node_count_ + graph_.getEdgeCount()){
+                globalRelabel();
+            }
+        }
+        return excess_[sink];
+    }
+
+    /*
+     * @brief   Phase two. Returns the excess left at the nodes by
+     *          computePreflow() to the source, turning the maximum preflow
+     *          into a maximum flow. The flow value does not change.
+     */
+    void convertPreflowToFlow(){
+        const int source = graph_.getSource();
+        const int sink = graph_.getSink();
+        if(source == sink){
+            return;
+        }
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_FLOW_CONVERSION);
+
+        /*
+         * Recompute the excess from the residual graph, so this phase does not
+         * depend on any state kept by phase one. For every edge out of a node
+         * the residual minus the original capacity is the flow it receives
+         * over that edge pair.
+         */
+        for(int node_id = 0; node_id < node_count_; node_id++){
+            flowType excess = 0;
+            for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+                excess += (flowType)graph_.getResidualCapacity(edge_id) - (flowType)graph_.getOriginalCapacity(edge_id);
+            }
+            excess_[node_id] = excess;
+        }
+
+        /*
+         * Exact distances to the source in the residual graph. The target
+         * keeps its excess, so it is never labeled and never pushed into.
+         * label_head_ is reused as the BFS queue and as the FIFO of nodes
+         * that still have excess; each node is in it at most once.
+         */
+        for(int i = 0; i < node_count_; i++){
+            label_[i] = INVALID_PARENT;
+            current_edge_[i] = graph_.getFirstEdge(i);
+        }
+        int q_head = 0;
+        int q_tail = 0;
+        label_[source] = 0;
+        label_head_[q_tail++] = source;
+        while(q_head != q_tail){
+            int node_id = label_head_[q_head++];
+            for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+                int prev_node = graph_.getHead(edge_id);
+                if(label_[prev_node] == INVALID_PARENT && prev_node != sink
+                        && graph_.getResidualCapacity(graph_.getReverse(edge_id)) > 0){
+                    label_[prev_node] = label_[node_id] + 1;
+                    label_head_[q_tail++] = prev_node;
+                }
+            }
+        }
+
+        /* FIFO discharge towards the source, next_active_ marks queued nodes */
+        q_head = 0;
+        q_tail = 0;
+        int queued = 0;
+        for(int i = 0; i < node_count_; i++){
+            next_active_[i] = false;
+            if(i != source && i != sink && excess_[i] > 0){
+                next_active_[i] = true;
+                label_head_[q_tail] = i;
+                q_tail = (q_tail + 1) % node_count_;
+                queued++;
+            }
+        }
+        while(queued > 0){
+            int node_id = label_head_[q_head];
+            q_head = (q_head + 1) % node_count_;
+            queued--;
+            next_active_[node_id] = false;
+
+            while(excess_[node_id] > 0){
+                int& edge_id = current_edge_[node_id];
+                for(; edge_id < graph_.getLastEdge(node_id); edge_id++){
+                    int next_node = graph_.getHead(edge_id);
+                    if(graph_.getResidualCapacity(edge_id) > 0 && next_node != sink
+                            && label_[node_id] == label_[next_node] + 1){
+                        pushFlow(edge_id, pushAmount(node_id, edge_id));
+                        if(next_node != source && !next_active_[next_node]){
+                            next_active_[next_node] = true;
+                            label_head_[q_tail] = next_node;
+                            q_tail = (q_tail + 1) % node_count_;
+                            queued++;
+                        }
+                        if(excess_[node_id] == 0){
+                            break;
+                        }
+                    }
+                }
+                if(excess_[node_id] == 0){
+                    break;
+                }
+
+                /* Relabel, the excess can always flow back along the edges it came in by */
+                int new_label = INT_MAX;
+                for(int e = graph_.getFirstEdge(node_id); e < graph_.getLastEdge(node_id); e++){
+                    int next_node = graph_.getHead(e);
+                    if(graph_.getResidualCapacity(e) > 0 && next_node != sink && label_[next_node] != INVALID_PARENT
+                            && label_[next_node] + 1 < new_label){
+                        new_label = label_[next_node] + 1;
+                    }
+                }
+                label_[node_id] = new_label;
+                current_edge_[node_id] = graph_.getFirstEdge(node_id);
+                SOLVER_COUNT(relabels, 1);
+            }
+        }
+    }
+private:
+    /* Move delta units over an edge and update the excess at both ends. */
+    void pushFlow(int edge_id, capacityType delta){
+        SOLVER_COUNT(pushes, 1);
+        int back_edge = graph_.getReverse(edge_id);
+        graph_.setResidualCapacity(edge_id, graph_.getResidualCapacity(edge_id) - delta);
+        graph_.setResidualCapacity(back_edge, graph_.getResidualCapacity(back_edge) + delta);
+        excess_[graph_.getHead(back_edge)] -= delta;
+        excess_[graph_.getHead(edge_id)] += delta;
+    }
+
+    /* Excess of a node that fits over an edge, the smaller of the two always fits a capacity */
+    capacityType pushAmount(int node_id, int edge_id){
+        const capacityType residual = graph_.getResidualCapacity(edge_id);
+        return excess_[node_id] < (flowType)residual ? (capacityType)excess_[node_id] : residual;
+    }
+
+    void addActive(int node_id){
+        int label = label_[node_id];
+        next_active_[node_id] = active_head_[label];
+        active_head_[label] = node_id;
+        if(label > max_active_){
+            max_active_ = label;
+        }
+    }
+
+    void addToLabel(int node_id){
+        int label = label_[node_id];
+        label_prev_[node_id] = INVALID_PARENT;
+        label_next_[node_id] = label_head_[label];
+        if(label_head_[label] != INVALID_PARENT){
+            label_prev_[label_head_[label]] = node_id;
+        }
+        label_head_[label] = node_id;
+        if(label > max_label_){
+            max_label_ = label;
+        }
+    }
+
+    void removeFromLabel(int node_id){
+        int label = label_[node_id];
+        if(label_prev_[node_id] != INVALID_PARENT){
+            label_next_[label_prev_[node_id]] = label_next_[node_id];
+        } else {
+            label_head_[label] = label_next_[node_id];
+        }
+        if(label_next_[node_id] != INVALID_PARENT){
+            label_prev_[label_next_[node_id]] = label_prev_[node_id];
+        }
+    }
+
+    /*
+     * Recompute every label as the exact residual distance to the target
+     * with a BFS over reverse residual edges. Nodes that can not reach the
+     * target get the removal label V and take no further part in phase one.
+     */
+    void globalRelabel(){
+        const int source = graph_.getSource();
+        const int sink = graph_.getSink();
+        SOLVER_PHASE_TIMER(SOLVER_PHASE_GLOBAL_RELABEL);
+        SOLVER_COUNT(global_relabels, 1);
+        for(int i = 0; i < node_count_; i++){
+            label_[i] = node_count_;
+            active_head_[i] = INVALID_PARENT;
+            label_head_[i] = INVALID_PARENT;
+        }
+
+        /* current_edge_ doubles as the BFS queue, it is reset below */
+        int q_head = 0;
+        int q_tail = 0;
+        label_[sink] = 0;
+        current_edge_[q_tail++] = sink;
+        while(q_head != q_tail){
+            int node_id = current_edge_[q_head++];
+            for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+                int prev_node = graph_.getHead(edge_id);
+                if(label_[prev_node] == node_count_ && prev_node != source
+                        && graph_.getResidualCapacity(graph_.getReverse(edge_id)) > 0){
+                    label_[prev_node] = label_[node_id] + 1;
+                    current_edge_[q_tail++] = prev_node;
+                }
+            }
+        }
+
+        max_active_ = INVALID_PARENT;
+        max_label_ = INVALID_PARENT;
+        for(int i = 0; i < node_count_; i++){
+            current_edge_[i] = graph_.getFirstEdge(i);
+            if(i == source || i == sink || label_[i] == node_count_){
+                continue;
+            }
+            addToLabel(i);
+            if(excess_[i] > 0){
+                addActive(i);
+            }
+        }
+        relabel_work_ = 0;
+    }
+
+    /* Every node above an empty label is cut off from the target. */
+    void gap(int empty_label){
+        SOLVER_COUNT(gaps, 1);
+        for(int label = empty_label + 1; label <= max_label_; label++){
+            for(int node_id = label_head_[label]; node_id != INVALID_PARENT; node_id = label_next_[node_id]){
+                label_[node_id] = node_count_;
+            }
+            label_head_[label] = INVALID_PARENT;
+            active_head_[label] = INVALID_PARENT;
+        }
+        max_label_ = empty_label - 1;
+        if(max_active_ > max_label_){
+            max_active_ = max_label_;
+        }
+    }
+
+    void relabel(int node_id){
+        SOLVER_COUNT(relabels, 1);
+        int old_label = label_[node_id];
+        removeFromLabel(node_id);
+        if(label_head_[old_label] == INVALID_PARENT){
+            label_[node_id] = node_count_;
+            gap(old_label);
+            return;
+        }
+
+        int new_label = node_count_;
+        int new_edge = graph_.getFirstEdge(node_id);
+        for(int edge_id = graph_.getFirstEdge(node_id); edge_id < graph_.getLastEdge(node_id); edge_id++){
+            if(graph_.getResidualCapacity(edge_id) > 0 && label_[graph_.getHead(edge_id)] + 1 < new_label){
+                new_label = label_[graph_.getHead(edge_id)] + 1;
+                new_edge = edge_id;
+            }
+        }
+        relabel_work_ += GLOBAL_RELABEL_BETA + graph_.getLastEdge(node_id) - graph_.getFirstEdge(node_id);
+        label_[node_id] = new_label;
+        current_edge_[node_id] = new_edge;
+        if(new_label < node_count_){
+            addToLabel(node_id);
+        }
+    }
+
+    /* Push the excess of an active node along admissible edges, relabel it once if it is not used up. */
+    void discharge(int node_id){
+        const int sink = graph_.getSink();
+        int& edge_id = current_edge_[node_id];
+        for(; edge_id < graph_.getLastEdge(node_id); edge_id++){
+            int next_node = graph_.getHead(edge_id);
+            if(graph_.getResidualCapacity(edge_id) > 0 && label_[node_id] == label_[next_node] + 1){
+                bool was_inactive = excess_[next_node] == 0;
+                pushFlow(edge_id, pushAmount(node_id, edge_id));
+                if(was_inactive && next_node != sink){
+                    addActive(next_node);
+                }
+                if(excess_[node_id] == 0){
+                    return;
+                }
+            }
+        }
+
+        relabel(node_id);
+        if(label_[node_id] < node_count_){
+            addActive(node_id);
+        }
+    }
+
+    Graph& graph_;
+    int node_count_;
+    nodeArray<int, Graph::STATIC_NODE_COUNT> label_; /* Distance label, V means removed */
+    nodeArray<flowType, Graph::STATIC_NODE_COUNT> excess_; /* Inflow minus outflow per node */
+    nodeArray<int, Graph::STATIC_NODE_COUNT> current_edge_; /* Next edge to try per node */
+    nodeArray<int, Graph::STATIC_NODE_COUNT> active_head_; /* First active node per label */
+    nodeArray<int, Graph::STATIC_NODE_COUNT> next_active_; /* Next active node with the same label */
+    nodeArray<int, Graph::STATIC_NODE_COUNT> label_head_; /* First node per label, for the gap heuristic */
+    nodeArray<int, Graph::STATIC_NODE_COUNT> label_next_; /* Next node with the same label */
+    nodeArray<int, Graph::STATIC_NODE_COUNT> label_prev_; /* Previous node with the same label */
+    int max_active_; /* Highest label that may have an active node */
+    int max_label_; /* Highest label that may have any node */
+    int relabel_work_; /* Work done by relabels since the last global relabel */
+};
+
+/*
+ * @brief   Compute the maximum flow with the highest label push-relabel engine.
+ *
+ * @param [in]  graph   A flow network transformed into a residual graph
+ *                      with back edges
+ * @param [in]  mode    PUSH_RELABEL_FULL_FLOW leaves a flow in the residual graph
+ *                      like fordFulkerson() does. PUSH_RELABEL_PREFLOW_ONLY stops
+ *                      after phase one, use findMinCut(graph, MIN_CUT_FROM_TARGET)
+ *                      on the result. The default value is PUSH_RELABEL_FULL_FLOW.
+ * @param [in]  arena   Scratch arena for the buffers of the solver, NULL to use
+ *                      the heap. The default value is NULL.
+ *
+ * @return  Returns the maximum flow possible in that flow network
+ */
+template<class Graph>
+typename Graph::flowType pushRelabel(Graph& graph, int mode = PUSH_RELABEL_FULL_FLOW, scratchArena* arena = NULL){
+    scratchScope scope(arena);
+    pushRelabelSolver<Graph> solver(graph, arena);
+    typename Graph::flowType max_flow = solver.computePreflow();
+    if(mode == PUSH_RELABEL_FULL_FLOW){
+        solver.convertPreflowToFlow();
+    }
+    return max_flow;
+}
+
+#endif
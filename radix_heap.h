@@ -0,0 +1,93 @@
+#ifndef RADIX_HEAP_H
+#define RADIX_HEAP_H
+
+#include<cstddef>
+#include<vector>
+
+#define RADIX_HEAP_BUCKETS 65 /* One for the last key popped, one per bit where a key can differ from it */
+
+/*
+ * @brief    Monotone priority queue of integer keys, for Dijkstra's algorithm
+ *          on non negative edge lengths.
+ *
+ *          Bucket b > 0 holds the entries whose key first differs from the
+ *          last key popped in bit b - 1, counting from the lowest, and
+ *          bucket 0 those equal to it. Popping from an empty bucket 0
+ *          takes the first non empty bucket, makes its smallest key the last
+ *          one and spreads its entries over the buckets below, so every
+ *          entry moves down at most 64 times and push and pop cost O(1) and
+ *          amortized O(log C) for keys up to C. Keys pushed must not be below
+ *          the last key popped. There is no decrease key: push the node again
+ *          and skip the stale entries when they come out.
+ *
+ *          clear() keeps the bucket memory, so a heap kept across searches
+ *          stops allocating once it has seen the largest one.
+ */
+template<class Value>
+class radixHeap{
+public:
+    radixHeap() : last_key_(0), size_(0){}
+
+    void clear(){
+        for(int i = 0; i < RADIX_HEAP_BUCKETS; i++){
+            buckets_[i].clear();
+        }
+        last_key_ = 0;
+        size_ = 0;
+    }
+
+    bool isEmpty(){return size_ == 0;}
+    size_t getSize(){return size_;}
+
+    void push(unsigned long long key, Value value){
+        entry item = {key, value};
+        buckets_[getBucket(key)].push_back(item);
+        size_++;
+    }
+
+    /*
+     * @brief   Take an entry of the smallest key out. The heap must not be empty.
+     *
+     * @param[out] key      Receives the smallest key
+     * @param[out] value    Receives the value pushed with it
+     */
+    void pop(unsigned long long& key, Value& value){
+        if(buckets_[0].empty()){
+            int bucket = 1;
+            while(buckets_[bucket].empty()){
+                bucket++;
+            }
+            std::vector<entry>& items = buckets_[bucket];
+            unsigned long long smallest = items[0].key;
+            for(size_t i = 1; i < items.size(); i++){
+                if(items[i].key < smallest){
+                    smallest = items[i].key;
+                }
+            }
+            last_key_ = smallest;
+            for(size_t i = 0; i < items.size(); i++){
+                buckets_[getBucket(items[i].key)].push_back(items[i]);
+            }
+            items.clear();
+        }
+        key = buckets_[0].back().key;
+        value = buckets_[0].back().value;
+        buckets_[0].pop_back();
+        size_--;
+    }
+private:
+    struct entry{
+        unsigned long long key;
+        Value value;
+    };
+
+    int getBucket(unsigned long long key){
+        return key == last_key_ ? 0 : 64 - __builtin_clzll(key ^ last_key_);
+    }
+
+    std::vector<entry> buckets_[RADIX_HEAP_BUCKETS];
+    unsigned long long last_key_; /* Key popped last, no key in the heap is smaller */
+    size_t size_;
+};
+
+#endif
@@ -0,0 +1,466 @@
+#ifndef RESIDUAL_GRAPH_H
+#define RESIDUAL_GRAPH_H
+
+#include<vector>
+#include<string>
+#include<cstring>
+#include<stdexcept>
+#include<cstdint>
+#include<iostream>
+#include<type_traits>
+
+#include "scratch_arena.h"
+#include "graph_memory.h"
+#include "capacity_arithmetic.h"
+
+#define INVALID_PARENT -1
+#define DYNAMIC_NODE_COUNT 0
+
+/*
+ * Default type the residual and original capacities are stored in. Define
+ * RESIDUAL_CAPACITY_16BIT for small instances to halve the capacity arrays;
+ * every residual capacity must then fit in 0 .. 65535, and the residual
+ * capacity of u->v can grow to the capacity of u->v plus that of v->u.
+ * The Capacity parameter of residualGraph picks another type, for example
+ * int64_t for wide capacity ranges or double for real valued capacities.
+ */
+#ifdef RESIDUAL_CAPACITY_16BIT
+typedef uint16_t residualCapacityStorage;
+#else
+typedef int32_t residualCapacityStorage;
+#endif
+
+/*
+ * Type a graph storing its capacities as Capacity takes and returns them
+ * in. Storage types narrower than int are handled as int.
+ */
+template<class Capacity>
+struct capacityValue{
+    typedef typename std::conditional<(sizeof(Capacity) < sizeof(int)), int, Capacity>::type type;
+};
+
+/*
+ * Type the engines add capacities up in: total flows, node excesses and the
+ * flow of an edge. It is signed and wider than one capacity, so 32 bit
+ * capacities keep the edge arrays compact while the flow of a huge graph is
+ * still exact: with fewer than 2^31 edges 64 bits can not overflow. 64 bit
+ * capacities add up in __int128 where the compiler has it, floating point
+ * capacities in their own type.
+ */
+template<class Capacity>
+struct flowValue{
+    typedef typename capacityValue<Capacity>::type capacityType;
+#ifdef __SIZEOF_INT128__
+    typedef typename std::conditional<(sizeof(capacityType) > 4), __int128, long long>::type integralType;
+#else
+    typedef long long integralType;
+#endif
+    typedef typename std::conditional<std::is_floating_point<capacityType>::value, capacityType, integralType>::type type;
+};
+
+/*
+ * @brief    Per node buffer used by the solvers. With a compile time node
+ *          count it is a plain array that lives wherever its owner lives,
+ *          otherwise it is a vector sized once at construction, or a
+ *          buffer of the given scratch arena if there is one. Either way
+ *          the elements start value initialised.
+ */
+template<class T, int N>
+class nodeArray{
+public:
+    nodeArray(int node_count, scratchArena* arena = NULL){(void)node_count; (void)arena;}
+    void resize(int node_count){(void)node_count;}
+    T& operator[](int node_id){return data_[node_id];}
+    T& at(int node_id){return data_[node_id];}
+private:
+    T data_[N];
+};
+
+template<class T>
+class nodeArray<T, DYNAMIC_NODE_COUNT>{
+public:
+    nodeArray(int node_count, scratchArena* arena = NULL) : size_(node_count){
+        if(arena == NULL){
+            owned_.resize(node_count);
+            data_ = owned_.data();
+            return;
+        }
+        data_ = arena->allocate<T>(node_count);
+        for(int i = 0; i < node_count; i++){
+            new(&data_[i]) T();
+        }
+    }
+    /* Change the size of an array that was built without an arena. The contents are kept. */
+    void resize(int node_count){
+        owned_.resize(node_count);
+        data_ = owned_.data();
+        size_ = node_count;
+    }
+    T& operator[](int node_id){return data_[node_id];}
+    T& at(int node_id){
+        if(node_id < 0 || node_id >= size_){
+            throw std::out_of_range("nodeArray::at");
+        }
+        return data_[node_id];
+    }
+private:
+    nodeArray(const nodeArray&);
+    nodeArray& operator=(const nodeArray&);
+
+    T* data_; /* Points into owned_ or into the arena */
+    int size_;
+    std::vector<T> owned_; /* Used when there is no arena */
+};
+
+/*
+ * @brief    Residual graph of a tiny flow network whose node count N is known
+ *          at compile time.
+ *
+ *          Edges are kept as a dense N x N matrix in the object itself, so the
+ *          graph needs no heap memory and every per node edge range has the
+ *          constant length N, which lets the compiler unroll the solver loops.
+ *          The edge u->v has index u * N + v and its back edge is v * N + u,
+ *          so heads and back edges are computed and only the capacities are
+ *          stored. If both u->v and v->u are input edges they share their
+ *          residual capacities, exactly like the former matrix representation.
+ *
+ *          Use it for small fixed topologies that are solved many times; use
+ *          residualGraph<> for everything else.
+ */
+template<int N = DYNAMIC_NODE_COUNT, class Capacity = residualCapacityStorage>
+class residualGraph{
+public:
+    static const int STATIC_NODE_COUNT = N;
+    typedef Capacity capacityStorage;
+    typedef typename capacityValue<Capacity>::type capacityType;
+    typedef typename flowValue<Capacity>::type flowType;
+
+    residualGraph(int source, int sink){
+        source_ = source;
+        sink_ = sink;
+        for(int i = 0; i < N * N; i++){
+            residual_capacity_[i] = 0;
+            original_capacity_[i] = 0;
+        }
+        for(int i = 0; i < N; i++){
+            node_names_[i] = NULL;
+        }
+    }
+
+    /*
+     * @brief   Add the edge from -> to, or add to its capacity if it exists.
+     *
+     * @return  False, leaving the graph unchanged, if from or to is not a node of the
+     *          graph, the capacity is negative or the residual capacities of the edge
+     *          pair no longer fit Capacity
+     */
+    bool addEdge(int from, int to, capacityType capacity){
+        if(from < 0 || from >= N || to < 0 || to >= N){
+            std::cerr<<"The edge "<<from<<" -> "<<to<<" does not join two of the "<<N<<" nodes\n";
+            return false;
+        }
+        capacityType forward;
+        capacityType pair;
+        if(!fitsCapacityStorage<Capacity>(capacity) || !checkedAdd((capacityType)original_capacity_[from * N + to], capacity, forward)
+                || !checkedAdd(forward, (capacityType)original_capacity_[to * N + from], pair)
+                || !fitsCapacityStorage<Capacity>(pair)){
+            std::cerr<<"The capacity of the edge "<<from<<" -> "<<to<<" does not fit the capacity type\n";
+            return false;
+        }
+        residual_capacity_[from * N + to] += capacity;
+        original_capacity_[from * N + to] = forward;
+        return true;
+    }
+
+    /* Nothing to build, the matrix is usable as soon as the edges are added. */
+    void finalize(){}
+
+    int getNodeCount(){return N;}
+    int getEdgeCount(){return N * N;}
+    int getSource(){return source_;}
+    int getSink(){return sink_;}
+    /* Solve for other terminals, call clearFlow() first if the graph holds a flow. */
+    void setTerminals(int source, int sink){
+        source_ = source;
+        sink_ = sink;
+    }
+    /* Remove the flow of the last solve, every residual capacity is the original one again. */
+    void clearFlow(){
+        for(int i = 0; i < N * N; i++){
+            residual_capacity_[i] = original_capacity_[i];
+        }
+    }
+    int getFirstEdge(int node_id){return node_id * N;}
+    int getLastEdge(int node_id){return node_id * N + N;}
+
+    int getHead(int edge_id){return edge_id % N;}
+    int getReverse(int edge_id){return edge_id % N * N + edge_id / N;}
+    capacityType getResidualCapacity(int edge_id){return residual_capacity_[edge_id];}
+    void setResidualCapacity(int edge_id, capacityType residual_capacity){residual_capacity_[edge_id] = residual_capacity;}
+    capacityType getOriginalCapacity(int edge_id){return original_capacity_[edge_id];}
+    void setOriginalCapacity(int edge_id, capacityType original_capacity){original_capacity_[edge_id] = original_capacity;}
+    /* Atomic access for the parallel engines. The fetch variant returns the previous value. */
+    capacityType loadResidualCapacity(int edge_id){return __atomic_load_n(&residual_capacity_[edge_id], __ATOMIC_RELAXED);}
+    capacityType fetchAddResidualCapacity(int edge_id, capacityType delta){
+        return __atomic_fetch_add(&residual_capacity_[edge_id], (Capacity)delta, __ATOMIC_RELAXED);
+    }
+    /* Residual capacities of all edges by id, for the vector scans. */
+    const Capacity* getResidualCapacities(){return residual_capacity_;}
+    /* Overwrite every residual capacity, getEdgeCount() values by edge id, see residualSnapshot. */
+    void setResidualCapacities(const Capacity* residual_capacities){
+        memcpy(residual_capacity_, residual_capacities, sizeof(residual_capacity_));
+    }
+
+    /* The name is not copied, it must outlive the graph. */
+    void setNodeName(int node_id, const char* name){node_names_[node_id] = name;}
+    std::string getNodeName(int node_id){
+        return node_names_[node_id] != NULL ? std::string(node_names_[node_id]) : std::to_string(node_id);
+    }
+private:
+    int source_; /* Id of the source node */
+    int sink_; /* Id of the target node */
+    Capacity residual_capacity_[N * N]; /* Residual capacity of the edge u->v at u * N + v */
+    Capacity original_capacity_[N * N]; /* Input capacity of the edge u->v at u * N + v */
+    const char* node_names_[N]; /* Optional printable names, NULL means use the id */
+};
+
+/*
+ * @brief    Residual graph stored in compressed sparse row form.
+ *
+ *          The outgoing edges of node u are the contiguous range
+ *          [getFirstEdge(u), getLastEdge(u)) of the edge arrays. Every
+ *          input edge u->v is stored together with a back edge v->u of
+ *          0 original capacity, and each of the two keeps the index of
+ *          the other one so that augmenting a path is O(1) per edge.
+ *
+ *          The edges are a structure of arrays: head, back edge, residual
+ *          capacity and original capacity each have their own contiguous
+ *          array, of 32 bit values for the heads and back edges and of
+ *          Capacity values for the capacities. The searches only stream
+ *          through the heads and the residual capacities, so no cache line
+ *          they load is spent on the original capacities.
+ *
+ *          The node count, source and sink are given at construction.
+ *          Edges are collected with addEdge() and the CSR arrays are
+ *          allocated and filled once by finalize(). residualGraphBuilder
+ *          builds the same arrays into a graph that is reused.
+ *
+ *          The arrays come from graphArrayAllocator, which backs the large
+ *          ones with huge pages, see setGraphMemoryPolicy().
+ *
+ *          Edges can also have a cost per unit of flow, for the min cost flow
+ *          engines; a back edge costs minus its input edge. The cost array is
+ *          only allocated once a cost other than 0 is given, so max flow
+ *          graphs stay as they were.
+ */
+template<class Capacity>
+class residualGraph<DYNAMIC_NODE_COUNT, Capacity>{
+public:
+    static const int STATIC_NODE_COUNT = DYNAMIC_NODE_COUNT;
+    typedef Capacity capacityStorage;
+    typedef typename capacityValue<Capacity>::type capacityType;
+    typedef typename flowValue<Capacity>::type flowType;
+    typedef int costType;
+
+    /*
+     * @param[in] node_count  Number of nodes, ids are 0 .. node_count - 1
+     * @param[in] source      Id of the source node
+     * @param[in] sink        Id of the target node
+     * @param[in] edge_count  Expected number of addEdge() calls, used to size
+     *                        the edge buffer up front. The default value is 0.
+     */
+    residualGraph(int node_count, int source, int sink, int edge_count = 0){
+        reset(node_count, source, sink);
+        pending_edges_.reserve(edge_count);
+    }
+
+    /*
+     * @brief   Drop every edge and name and start over as an empty graph with
+     *          new nodes and terminals. The buffers keep their memory, so a
+     *          graph rebuilt for instances of about the same size does not
+     *          allocate.
+     */
+    void reset(int node_count, int source, int sink){
+        node_count_ = node_count;
+        source_ = source;
+        sink_ = sink;
+        offsets_.assign(node_count_ + 1, 0);
+        pending_edges_.clear();
+        heads_.clear();
+        reverses_.clear();
+        residual_capacities_.clear();
+        original_capacities_.clear();
+        costs_.clear();
+        node_names_.clear();
+    }
+
+    /*
+     * @brief   Queue an edge from -> to. Only valid before finalize() is called.
+     *
+     * @param[in] cost  Cost per unit of flow, for the min cost flow engines. The
+     *                  default value is 0.
+     *
+     * @return  False, leaving the edge out, if from or to is not a node of the graph, or the
+     *          capacity is negative or does not fit Capacity
+     */
+    bool addEdge(int from, int to, capacityType capacity, costType cost = 0){
+        if(from < 0 || from >= node_count_ || to < 0 || to >= node_count_){
+            std::cerr<<"The edge "<<from<<" -> "<<to<<" does not join two of the "<<node_count_<<" nodes\n";
+            return false;
+        }
+        if(!fitsCapacityStorage<Capacity>(capacity)){
+            std::cerr<<"The capacity of the edge "<<from<<" -> "<<to<<" does not fit the capacity type\n";
+            return false;
+        }
+        pendingEdge edge = {from, to, capacity, cost};
+        pending_edges_.push_back(edge);
+        offsets_[from + 1]++;
+        offsets_[to + 1]++;
+        return true;
+    }
+
+    /* Build the CSR arrays from the queued edges with a counting sort on the tail node. */
+    void finalize(){
+        for(int i = 0; i < node_count_; i++){
+            offsets_[i + 1] += offsets_[i];
+        }
+
+        std::vector<int32_t> next_slot(offsets_.begin(), offsets_.end() - 1);
+        const int edge_count = offsets_[node_count_];
+        heads_.resize(edge_count);
+        reverses_.resize(edge_count);
+        residual_capacities_.resize(edge_count);
+        original_capacities_.resize(edge_count);
+        for(size_t i = 0; i < pending_edges_.size(); i++){
+            const pendingEdge& edge = pending_edges_[i];
+            setEdgePair(next_slot[edge.from]++, next_slot[edge.to]++, edge.from, edge.to, edge.capacity, edge.cost);
+        }
+        std::vector<pendingEdge>().swap(pending_edges_);
+    }
+
+    /*
+     * @brief   Bulk construction for loaders that place every edge themselves,
+     *          used instead of addEdge() and finalize(). Sizes the edge arrays
+     *          from the number of edges of each node, back edges included; the
+     *          edges are then stored with setEdgePair().
+     *
+     * @param[in] degrees  Edges of node u at index u, node_count entries
+     */
+    void allocateEdges(const std::vector<int32_t>& degrees){
+        offsets_[0] = 0;
+        for(int i = 0; i < node_count_; i++){
+            offsets_[i + 1] = offsets_[i] + degrees[i];
+        }
+        const int edge_count = offsets_[node_count_];
+        heads_.resize(edge_count);
+        reverses_.resize(edge_count);
+        residual_capacities_.resize(edge_count);
+        original_capacities_.resize(edge_count);
+    }
+
+    /*
+     * @brief   Store the input edge from -> to at index forward and its back
+     *          edge at index backward, which must lie in the edge ranges of
+     *          from and to. Different slots may be set from different threads,
+     *          as long as every cost is 0.
+     *
+     * @param[in] cost  Cost per unit of flow, see setEdgeCost(). The default value is 0.
+     */
+    void setEdgePair(int forward, int backward, int from, int to, capacityType capacity, costType cost = 0){
+        heads_[forward] = to;
+        reverses_[forward] = backward;
+        residual_capacities_[forward] = capacity;
+        original_capacities_[forward] = capacity;
+        heads_[backward] = from;
+        reverses_[backward] = forward;
+        residual_capacities_[backward] = 0;
+        original_capacities_[backward] = 0;
+        if(cost != 0 || !costs_.empty()){
+            setEdgeCost(forward, cost);
+        }
+    }
+
+    int getNodeCount(){return node_count_;}
+    int getEdgeCount(){return (int)heads_.size();}
+    int getSource(){return source_;}
+    int getSink(){return sink_;}
+    /* Solve for other terminals, call clearFlow() first if the graph holds a flow. */
+    void setTerminals(int source, int sink){
+        source_ = source;
+        sink_ = sink;
+    }
+    /* Remove the flow of the last solve, every residual capacity is the original one again. */
+    void clearFlow(){
+        residual_capacities_.assign(original_capacities_.begin(), original_capacities_.end());
+    }
+    int getFirstEdge(int node_id){return offsets_[node_id];}
+    int getLastEdge(int node_id){return offsets_[node_id + 1];}
+
+    int getHead(int edge_id){return heads_[edge_id];}
+    int getReverse(int edge_id){return reverses_[edge_id];}
+    capacityType getResidualCapacity(int edge_id){return residual_capacities_[edge_id];}
+    void setResidualCapacity(int edge_id, capacityType residual_capacity){residual_capacities_[edge_id] = residual_capacity;}
+    capacityType getOriginalCapacity(int edge_id){return original_capacities_[edge_id];}
+    void setOriginalCapacity(int edge_id, capacityType original_capacity){original_capacities_[edge_id] = original_capacity;}
+    /* Atomic access for the parallel engines. The fetch variant returns the previous value. */
+    capacityType loadResidualCapacity(int edge_id){return __atomic_load_n(&residual_capacities_[edge_id], __ATOMIC_RELAXED);}
+    capacityType fetchAddResidualCapacity(int edge_id, capacityType delta){
+        return __atomic_fetch_add(&residual_capacities_[edge_id], (Capacity)delta, __ATOMIC_RELAXED);
+    }
+    /* Residual capacities of all edges by id, for the vector scans. */
+    const Capacity* getResidualCapacities(){return residual_capacities_.data();}
+    /* Overwrite every residual capacity, getEdgeCount() values by edge id, see residualSnapshot. */
+    void setResidualCapacities(const Capacity* residual_capacities){
+        if(!residual_capacities_.empty()){
+            memcpy(residual_capacities_.data(), residual_capacities, residual_capacities_.size() * sizeof(Capacity));
+        }
+    }
+
+    /* Cost per unit of flow of an edge, 0 for every edge of a graph without costs */
+    costType getCost(int edge_id){return costs_.empty() ? 0 : costs_[edge_id];}
+    /* Set the cost of an input edge and minus it on its back edge. Not thread safe. */
+    void setEdgeCost(int edge_id, costType cost){
+        if(costs_.empty()){
+            costs_.assign(heads_.size(), 0);
+        }
+        costs_[edge_id] = cost;
+        costs_[reverses_[edge_id]] = -cost;
+    }
+    /* False if no edge was given a cost, they are all 0 then */
+    bool hasCosts(){return !costs_.empty();}
+
+    /* Names are optional. The buffer is only allocated when the first name is set. */
+    void setNodeName(int node_id, const char* name){
+        if(node_names_.empty()){
+            node_names_.resize(node_count_);
+        }
+        node_names_[node_id] = name;
+    }
+    std::string getNodeName(int node_id){
+        if(node_names_.empty() || node_names_[node_id].empty()){
+            return std::to_string(node_id);
+        }
+        return node_names_[node_id];
+    }
+private:
+    struct pendingEdge{
+        int from;
+        int to;
+        capacityType capacity;
+        costType cost;
+    };
+
+    int node_count_; /* Number of nodes in the graph */
+    int source_; /* Id of the source node */
+    int sink_; /* Id of the target node */
+    std::vector<pendingEdge> pending_edges_; /* Edges added before finalize() */
+    std::vector<int32_t, graphArrayAllocator<int32_t> > offsets_; /* Per node start offset into the edge arrays, node_count_ + 1 entries */
+    std::vector<int32_t, graphArrayAllocator<int32_t> > heads_; /* Node each edge points to, edges grouped by tail node */
+    std::vector<int32_t, graphArrayAllocator<int32_t> > reverses_; /* Index of the paired back edge of each edge */
+    std::vector<Capacity, graphArrayAllocator<Capacity> > residual_capacities_; /* Residual capacity of each edge */
+    std::vector<Capacity, graphArrayAllocator<Capacity> > original_capacities_; /* Input capacity of each edge, 0 for back edges */
+    std::vector<int32_t, graphArrayAllocator<int32_t> > costs_; /* Cost of each edge, minus that of the input edge for back edges, empty if all are 0 */
+    std::vector<std::string> node_names_; /* Optional printable names */
+};
+
+#endif
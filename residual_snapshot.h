@@ -0,0 +1,244 @@
+#ifndef RESIDUAL_SNAPSHOT_H
+#define RESIDUAL_SNAPSHOT_H
+
+#include<cstring>
+#include<iostream>
+#include<vector>
+
+#include "residual_graph.h"
+#include "parallel_push_relabel.h"
+
+/*
+ * Two ways to bring a residual graph back to an earlier state without
+ * building it again. residualSnapshot copies all the residual capacities
+ * into one flat buffer and back, two memcpy of E values. undoLoggedGraph
+ * records the arcs a solve or a capacity change touches, so going back
+ * costs only the number of arcs that changed, for branch and bound and
+ * for trying capacity scenarios one after the other.
+ */
+
+/*
+ * @brief    Copy of the residual capacities of a graph, by edge id, in the
+ *          storage type of the graph. The buffer is plain data: it can be
+ *          written out with getData() and getByteCount() and read back with
+ *          load(), on a graph of the same topology and storage type.
+ */
+template<class Graph>
+class residualSnapshot{
+public:
+    typedef typename Graph::capacityStorage capacityStorage;
+
+    /* Store the current residual capacities of graph. */
+    void capture(Graph& graph){
+        residual_capacities_.resize(graph.getEdgeCount());
+        if(getByteCount() != 0){
+            memcpy(residual_capacities_.data(), graph.getResidualCapacities(), getByteCount());
+        }
+    }
+
+    /*
+     * @brief   Put the stored residual capacities back into graph.
+     *
+     * @return  False, leaving the graph unchanged, if the snapshot holds another
+     *          number of edges than the graph
+     */
+    bool restore(Graph& graph){
+        if((size_t)graph.getEdgeCount() != residual_capacities_.size()){
+            std::cerr<<"The snapshot holds "<<residual_capacities_.size()<<" edges, the graph "<<graph.getEdgeCount()<<"\n";
+            return false;
+        }
+        graph.setResidualCapacities(residual_capacities_.data());
+        return true;
+    }
+
+    /*
+     * @brief   Fill the snapshot from a buffer written out from getData().
+     *
+     * @return  False, leaving the snapshot unchanged, if bytes is not a whole
+     *          number of capacities
+     */
+    bool load(const void* data, size_t bytes){
+        if(bytes % sizeof(capacityStorage) != 0){
+            std::cerr<<"A snapshot of "<<bytes<<" bytes does not hold whole capacities\n";
+            return false;
+        }
+        residual_capacities_.resize(bytes / sizeof(capacityStorage));
+        if(bytes != 0){
+            memcpy(residual_capacities_.data(), data, bytes);
+        }
+        return true;
+    }
+
+    const void* getData(){return residual_capacities_.data();}
+    size_t getByteCount(){return residual_capacities_.size() * sizeof(capacityStorage);}
+    int getEdgeCount(){return (int)residual_capacities_.size();}
+private:
+    std::vector<capacityStorage> residual_capacities_; /* Residual capacity of each edge at capture() */
+};
+
+/*
+ * @brief    View of a finalized graph that logs the first change of every
+ *          arc after a checkpoint, so rollback() restores the graph as it was
+ *          at that checkpoint in O(changed arcs).
+ *
+ *          It has the interface the engines use, so a solve, updateMaxFlow()
+ *          or direct capacity changes run on it unchanged. Each log entry
+ *          holds the residual and original capacity an arc had before its
+ *          first change, and a per edge stamp of the checkpoint it was last
+ *          logged in keeps arcs that change many times to one entry per
+ *          checkpoint. Checkpoints nest: rolling back to one also undoes the
+ *          checkpoints taken after it.
+ *
+ *          The log is not thread safe, so MAX_FLOW_PARALLEL_PUSH_RELABEL runs
+ *          serial push-relabel on it and the other engines must be given a
+ *          single thread. Changes made to the underlying graph directly are
+ *          not logged.
+ */
+template<class Graph>
+class undoLoggedGraph{
+public:
+    static const int STATIC_NODE_COUNT = Graph::STATIC_NODE_COUNT;
+    typedef typename Graph::capacityStorage capacityStorage;
+    typedef typename Graph::capacityType capacityType;
+    typedef typename Graph::flowType flowType;
+
+    /* graph must be finalized and outlive the view. The log starts empty. */
+    undoLoggedGraph(Graph& graph) :
+        graph_(graph),
+        stamps_(graph.getEdgeCount(), 0),
+        epoch_(1),
+        next_checkpoint_id_(0)
+    {
+    }
+
+    /*
+     * @brief   Start logging changes against the current state.
+     *
+     * @return  Returns the checkpoint to give rollback()
+     */
+    int checkpoint(){
+        nextEpoch();
+        liveCheckpoint live = {next_checkpoint_id_++, log_.size()};
+        checkpoints_.push_back(live);
+        return live.id;
+    }
+
+    /*
+     * @brief   Undo every change made since checkpoint was taken, newest first.
+     *          The checkpoint and every checkpoint taken after it are dropped.
+     *
+     * @return  False, leaving the graph unchanged, if checkpoint was already
+     *          rolled back, dropped by clear() or by the rollback of an
+     *          earlier checkpoint
+     */
+    bool rollback(int checkpoint){
+        size_t index = checkpoints_.size();
+        while(index > 0 && checkpoints_[index - 1].id != checkpoint){
+            index--;
+        }
+        if(index == 0){
+            return false;
+        }
+        size_t log_length = checkpoints_[index - 1].log_length;
+        while(log_.size() > log_length){
+            const undoEntry& entry = log_.back();
+            graph_.setResidualCapacity(entry.edge_id, entry.residual_capacity);
+            graph_.setOriginalCapacity(entry.edge_id, entry.original_capacity);
+            log_.pop_back();
+        }
+        checkpoints_.resize(index - 1);
+        nextEpoch();
+        return true;
+    }
+
+    /* Keep the current state and forget every checkpoint. */
+    void clear(){
+        log_.clear();
+        checkpoints_.clear();
+        nextEpoch();
+    }
+
+    /* Arcs the log would restore, at most one per arc and checkpoint */
+    int getLoggedArcCount(){return (int)log_.size();}
+    Graph& getGraph(){return graph_;}
+
+    int getNodeCount(){return graph_.getNodeCount();}
+    int getEdgeCount(){return graph_.getEdgeCount();}
+    int getSource(){return graph_.getSource();}
+    int getSink(){return graph_.getSink();}
+    void setTerminals(int source, int sink){graph_.setTerminals(source, sink);}
+    /* Logged like any other change, only the arcs holding flow are written. */
+    void clearFlow(){
+        for(int edge_id = 0; edge_id < graph_.getEdgeCount(); edge_id++){
+            if(graph_.getResidualCapacity(edge_id) != graph_.getOriginalCapacity(edge_id)){
+                setResidualCapacity(edge_id, graph_.getOriginalCapacity(edge_id));
+            }
+        }
+    }
+    int getFirstEdge(int node_id){return graph_.getFirstEdge(node_id);}
+    int getLastEdge(int node_id){return graph_.getLastEdge(node_id);}
+
+    int getHead(int edge_id){return graph_.getHead(edge_id);}
+    int getReverse(int edge_id){return graph_.getReverse(edge_id);}
+    capacityType getResidualCapacity(int edge_id){return graph_.getResidualCapacity(edge_id);}
+    void setResidualCapacity(int edge_id, capacityType residual_capacity){
+        logArc(edge_id);
+        graph_.setResidualCapacity(edge_id, residual_capacity);
+    }
+    capacityType getOriginalCapacity(int edge_id){return graph_.getOriginalCapacity(edge_id);}
+    void setOriginalCapacity(int edge_id, capacityType original_capacity){
+        logArc(edge_id);
+        graph_.setOriginalCapacity(edge_id, original_capacity);
+    }
+    capacityType loadResidualCapacity(int edge_id){return graph_.loadResidualCapacity(edge_id);}
+    const capacityStorage* getResidualCapacities(){return graph_.getResidualCapacities();}
+
+    void setNodeName(int node_id, const char* name){graph_.setNodeName(node_id, name);}
+    std::string getNodeName(int node_id){return graph_.getNodeName(node_id);}
+private:
+    undoLoggedGraph(const undoLoggedGraph&);
+    undoLoggedGraph& operator=(const undoLoggedGraph&);
+
+    struct undoEntry{
+        int edge_id;
+        capacityStorage residual_capacity;
+        capacityStorage original_capacity;
+    };
+
+    struct liveCheckpoint{
+        int id;
+        size_t log_length; /* Entries logged before the checkpoint was taken */
+    };
+
+    void logArc(int edge_id){
+        if(stamps_[edge_id] != epoch_){
+            stamps_[edge_id] = epoch_;
+            undoEntry entry = {edge_id, (capacityStorage)graph_.getResidualCapacity(edge_id),
+                (capacityStorage)graph_.getOriginalCapacity(edge_id)};
+            log_.push_back(entry);
+        }
+    }
+
+    /* Every arc has to be logged again after a checkpoint or a rollback */
+    void nextEpoch(){
+        if(++epoch_ == 0){
+            stamps_.assign(stamps_.size(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    Graph& graph_;
+    std::vector<undoEntry> log_; /* Arcs as they were before their first change, oldest first */
+    std::vector<unsigned> stamps_; /* Epoch each edge was last logged in, 0 for none */
+    unsigned epoch_; /* Epoch of the current checkpoint */
+    std::vector<liveCheckpoint> checkpoints_; /* Checkpoints rollback() accepts, oldest first */
+    int next_checkpoint_id_; /* Id of the next checkpoint, ids are never reused */
+};
+
+/* The log is written from one thread only */
+template<class Graph>
+struct parallelPushRelabelSupports<undoLoggedGraph<Graph> >{
+    static const bool value = false;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include<cstddef>
+#include<memory>
+#include<new>
+#include<type_traits>
+#include<vector>
+
+/*
+ * @brief    Bump allocator for the temporary buffers of the solvers.
+ *
+ *          Buffers are carved one after another out of a single block and are
+ *          all given back at once when the scratchScope that was open at
+ *          their allocation ends. When a solve needs more than the block
+ *          holds, the rest is served from extra blocks, and once the
+ *          outermost scope ends they are replaced by one block big enough
+ *          for the largest solve seen so far. After the first few instances
+ *          of a batch the arena therefore stops touching the heap.
+ *
+ *          An arena is not thread safe, every thread needs its own.
+ */
+class scratchArena{
+public:
+    scratchArena(size_t capacity = 0) : capacity_(0), used_(0), peak_(0){
+        reserve(capacity);
+    }
+
+    /*
+     * @brief   Get an uninitialised buffer for count objects of type T. It
+     *          stays valid until the enclosing scratchScope ends.
+     */
+    template<class T>
+    T* allocate(size_t count){
+        static_assert(std::is_trivially_destructible<T>::value, "arena buffers are never destroyed");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over aligned types are not supported");
+        size_t offset = (used_ + alignof(T) - 1) & ~(alignof(T) - 1);
+        size_t bytes = sizeof(T) * count;
+        used_ = offset + bytes;
+        if(used_ > peak_){
+            peak_ = used_;
+        }
+        if(used_ <= capacity_){
+            return reinterpret_cast<T*>(reinterpret_cast<char*>(block_.get()) + offset);
+        }
+        overflowBlock overflow = {offset, std::unique_ptr<std::max_align_t[]>(new std::max_align_t[blockUnits(bytes)])};
+        overflow_.push_back(std::move(overflow));
+        return reinterpret_cast<T*>(overflow_.back().block.get());
+    }
+
+    size_t mark(){return used_;}
+
+    /* Give back everything allocated since mark() returned the given value. */
+    void release(size_t mark){
+        used_ = mark;
+        while(!overflow_.empty() && overflow_.back().offset >= mark){
+            overflow_.pop_back();
+        }
+        if(used_ == 0 && peak_ > capacity_){
+            reserve(peak_);
+        }
+    }
+
+    /* Make sure solves that need up to capacity bytes never allocate. Only valid while nothing is allocated. */
+    void reserve(size_t capacity){
+        if(capacity > capacity_){
+            block_.reset(new std::max_align_t[blockUnits(capacity)]);
+            capacity_ = blockUnits(capacity) * sizeof(std::max_align_t);
+        }
+    }
+
+    size_t getCapacity(){return capacity_;}
+private:
+    struct overflowBlock{
+        size_t offset; /* Logical offset of the buffer it holds */
+        std::unique_ptr<std::max_align_t[]> block;
+    };
+
+    static size_t blockUnits(size_t bytes){
+        return (bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+    }
+
+    std::unique_ptr<std::max_align_t[]> block_; /* Main block, buffers are carved from its start */
+    size_t capacity_; /* Bytes in block_ */
+    size_t used_; /* Logical bytes handed out, including those in overflow_ */
+    size_t peak_; /* Largest used_ seen, the size of the next main block */
+    std::vector<overflowBlock> overflow_; /* Buffers that did not fit into block_, newest last */
+};
+
+/*
+ * @brief    Gives back all arena buffers allocated during its lifetime when it
+ *          goes out of scope. A NULL arena is allowed and does nothing, so
+ *          the solvers can open a scope whether or not they got an arena.
+ */
+class scratchScope{
+public:
+    scratchScope(scratchArena* arena) : arena_(arena), mark_(arena != NULL ? arena->mark() : 0){}
+    ~scratchScope(){
+        if(arena_ != NULL){
+            arena_->release(mark_);
+        }
+    }
+private:
+    scratchScope(const scratchScope&);
+    scratchScope& operator=(const scratchScope&);
+
+    scratchArena* arena_;
+    size_t mark_;
+};
+
+#endif
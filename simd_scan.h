@@ -0,0 +1,242 @@
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+#include<climits>
+#include<cstdint>
+#include<limits>
+
+#include "residual_graph.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(RESIDUAL_CAPACITY_16BIT)
+#define SIMD_SCAN_X86 1
+#include<immintrin.h>
+#endif
+
+/* Instruction sets the scans can run on, in increasing order */
+#define SIMD_SCAN_SCALAR 0
+#define SIMD_SCAN_AVX2 1
+#define SIMD_SCAN_AVX512 2
+
+#define SIMD_SCAN_MIN_ARCS 16 /* Arc blocks shorter than this are scanned with a plain loop */
+#define SIMD_SCAN_BLOCK 64 /* Arcs per mask, one bit each */
+
+/*
+ * Vector kernels for the hot residual capacity scans of the serial engines:
+ * a compare over a node's block of arcs that returns a bit per arc with
+ * more residual capacity than a floor, 0 unless capacity scaling, and a
+ * gather based minimum of the residual capacities along a path of edge ids.
+ *
+ * Each kernel has a scalar, an AVX2 and an AVX-512 version. The vector
+ * versions are compiled with target attributes, so the rest of the build
+ * needs no -mavx flags, and the best one the CPU supports is picked at run
+ * time. They work on the default 32 bit capacity storage; with
+ * RESIDUAL_CAPACITY_16BIT, other capacity types or on other architectures
+ * only the scalar versions exist.
+ */
+
+template<class Capacity>
+inline uint64_t positiveResidualMaskScalar(const Capacity* residual, int count, typename capacityValue<Capacity>::type floor){
+    uint64_t mask = 0;
+    for(int i = 0; i < count; i++){
+        mask |= (uint64_t)(residual[i] > floor) << i;
+    }
+    return mask;
+}
+
+template<class Capacity>
+inline typename capacityValue<Capacity>::type minResidualScalar(const Capacity* residual, const int* edge_ids, int count){
+    typename capacityValue<Capacity>::type min_residual = std::numeric_limits<typename capacityValue<Capacity>::type>::max();
+    for(int i = 0; i < count; i++){
+        if(residual[edge_ids[i]] < min_residual){
+            min_residual = residual[edge_ids[i]];
+        }
+    }
+    return min_residual;
+}
+
+#ifdef SIMD_SCAN_X86
+__attribute__((target("avx2")))
+inline uint64_t positiveResidualMaskAvx2(const residualCapacityStorage* residual, int count, int floor){
+    const __m256i floors = _mm256_set1_epi32(floor);
+    uint64_t mask = 0;
+    int i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256i values = _mm256_loadu_si256((const __m256i*)(residual + i));
+        __m256i positive = _mm256_cmpgt_epi32(values, floors);
+        mask |= (uint64_t)(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(positive)) << i;
+    }
+    for(; i < count; i++){
+        mask |= (uint64_t)(residual[i] > floor) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+inline int minResidualAvx2(const residualCapacityStorage* residual, const int* edge_ids, int count){
+    __m256i min_values = _mm256_set1_epi32(INT_MAX);
+    int i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256i ids = _mm256_loadu_si256((const __m256i*)(edge_ids + i));
+        min_values = _mm256_min_epi32(min_values, _mm256_i32gather_epi32((const int*)residual, ids, 4));
+    }
+    __m128i half = _mm_min_epi32(_mm256_castsi256_si128(min_values), _mm256_extracti128_si256(min_values, 1));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    int min_residual = _mm_cvtsi128_si32(half);
+    for(; i < count; i++){
+        if(residual[edge_ids[i]] < min_residual){
+            min_residual = residual[edge_ids[i]];
+        }
+    }
+    return min_residual;
+}
+
+__attribute__((target("avx512f")))
+inline uint64_t positiveResidualMaskAvx512(const residualCapacityStorage* residual, int count, int floor){
+    const __m512i floors = _mm512_set1_epi32(floor);
+    uint64_t mask = 0;
+    for(int i = 0; i < count; i += 16){
+        /* Masked loads do not touch the lanes past the end of the block */
+        __mmask16 lanes = count - i >= 16 ? (__mmask16)0xffff : (__mmask16)((1u << (count - i)) - 1);
+        __m512i values = _mm512_maskz_loadu_epi32(lanes, residual + i);
+        mask |= (uint64_t)_mm512_mask_cmpgt_epi32_mask(lanes, values, floors) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx512f")))
+inline int minResidualAvx512(const residualCapacityStorage* residual, const int* edge_ids, int count){
+    __m512i min_values = _mm512_set1_epi32(INT_MAX);
+    for(int i = 0; i < count; i += 16){
+        __mmask16 lanes = count - i >= 16 ? (__mmask16)0xffff : (__mmask16)((1u << (count - i)) - 1);
+        __m512i ids = _mm512_maskz_loadu_epi32(lanes, edge_ids + i);
+        __m512i values = _mm512_mask_i32gather_epi32(min_values, lanes, ids, residual, 4);
+        min_values = _mm512_mask_min_epi32(min_values, lanes, min_values, values);
+    }
+    /* Horizontal minimum in memory, the reduce intrinsics trip -Wuninitialized on some compilers */
+    int lane_values[16];
+    _mm512_storeu_si512(lane_values, min_values);
+    int min_residual = INT_MAX;
+    for(int i = 0; i < 16; i++){
+        if(lane_values[i] < min_residual){
+            min_residual = lane_values[i];
+        }
+    }
+    return min_residual;
+}
+#endif
+
+/* Best instruction set the running CPU supports */
+inline int detectSimdScanLevel(){
+#ifdef SIMD_SCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        return SIMD_SCAN_AVX512;
+    }
+    if(__builtin_cpu_supports("avx2")){
+        return SIMD_SCAN_AVX2;
+    }
+#endif
+    return SIMD_SCAN_SCALAR;
+}
+
+inline int& simdScanLevelSetting(){
+    static int level = detectSimdScanLevel();
+    return level;
+}
+
+inline int getSimdScanLevel(){return simdScanLevelSetting();}
+
+/*
+ * @brief   Choose the kernels to use, for benchmarks and for checking the
+ *          vector versions against the scalar ones. Levels the CPU does not
+ *          support are lowered to the best one it does.
+ */
+inline void setSimdScanLevel(int level){
+    int supported = detectSimdScanLevel();
+    simdScanLevelSetting() = level < supported ? level : supported;
+}
+
+/*
+ * @brief   Bit i of the result is set if residual[i] > floor.
+ *
+ * @param[in] residual  First residual capacity of the block
+ * @param[in] count     Arcs in the block, at most SIMD_SCAN_BLOCK
+ * @param[in] floor     Residual capacity an arc must exceed. The default value is 0.
+ */
+inline uint64_t positiveResidualMask(const residualCapacityStorage* residual, int count, int floor = 0){
+    switch(simdScanLevelSetting()){
+#ifdef SIMD_SCAN_X86
+    case SIMD_SCAN_AVX512:
+        return positiveResidualMaskAvx512(residual, count, floor);
+    case SIMD_SCAN_AVX2:
+        return positiveResidualMaskAvx2(residual, count, floor);
+#endif
+    default:
+        return positiveResidualMaskScalar(residual, count, floor);
+    }
+}
+
+/* Other capacity types only have the scalar version. */
+template<class Capacity>
+inline uint64_t positiveResidualMask(const Capacity* residual, int count, typename capacityValue<Capacity>::type floor = 0){
+    return positiveResidualMaskScalar(residual, count, floor);
+}
+
+/*
+ * @brief   Smallest residual capacity of the edges of a path.
+ *
+ * @param[in] residual  Residual capacity array of the graph
+ * @param[in] edge_ids  Edge ids along the path
+ * @param[in] count     Edges on the path
+ *
+ * @return  The bottleneck of the path, the largest capacity value for an empty path
+ */
+inline int minResidual(const residualCapacityStorage* residual, const int* edge_ids, int count){
+    switch(simdScanLevelSetting()){
+#ifdef SIMD_SCAN_X86
+    case SIMD_SCAN_AVX512:
+        return minResidualAvx512(residual, edge_ids, count);
+    case SIMD_SCAN_AVX2:
+        return minResidualAvx2(residual, edge_ids, count);
+#endif
+    default:
+        return minResidualScalar(residual, edge_ids, count);
+    }
+}
+
+template<class Capacity>
+inline typename capacityValue<Capacity>::type minResidual(const Capacity* residual, const int* edge_ids, int count){
+    return minResidualScalar(residual, edge_ids, count);
+}
+
+/*
+ * @brief   Call visit(edge_id) for every edge out of node_id with more residual
+ *          capacity than floor, in edge order. Long arc blocks are scanned with
+ *          positiveResidualMask(), short ones with a plain loop. visit must
+ *          not change the residual capacities of the arcs of node_id.
+ */
+template<class Graph, class Visitor>
+inline void forEachResidualArc(Graph& graph, int node_id, Visitor visit, typename Graph::capacityType floor = 0){
+    const int first_edge = graph.getFirstEdge(node_id);
+    const int last_edge = graph.getLastEdge(node_id);
+    if(last_edge - first_edge < SIMD_SCAN_MIN_ARCS){
+        const typename Graph::capacityStorage* residual = graph.getResidualCapacities();
+        for(int edge_id = first_edge; edge_id < last_edge; edge_id++){
+            if(residual[edge_id] > floor){
+                visit(edge_id);
+            }
+        }
+        return;
+    }
+    for(int block = first_edge; block < last_edge; block += SIMD_SCAN_BLOCK){
+        int count = last_edge - block < SIMD_SCAN_BLOCK ? last_edge - block : SIMD_SCAN_BLOCK;
+        uint64_t mask = positiveResidualMask(graph.getResidualCapacities() + block, count, floor);
+        while(mask != 0){
+            visit(block + __builtin_ctzll(mask));
+            mask &= mask - 1;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,249 @@
+#ifndef SOLVE_CONTROL_H
+#define SOLVE_CONTROL_H
+
+#include<atomic>
+#include<chrono>
+#include<mutex>
+#include<vector>
+
+#include "residual_graph.h"
+#include "min_cut_bitmap.h"
+#include "simd_scan.h"
+
+/* Where a solve run with a solveControl stands, see solveControl::getStatus() */
+#define SOLVE_STATUS_RUNNING 0 /* Not started or not finished yet */
+#define SOLVE_STATUS_OPTIMAL 1 /* The flow is a maximum flow */
+#define SOLVE_STATUS_CANCELLED 2 /* Stopped by cancel(), the flow is the best found */
+#define SOLVE_STATUS_DEADLINE 3 /* Stopped at the deadline, the flow is the best found */
+
+#define SOLVE_PROGRESS_INTERVAL 0.1 /* Default seconds between two progress reports */
+
+/*
+ * @brief    Cancellation, deadline and progress of one solve, shared between
+ *          the thread that runs it and any other thread.
+ *
+ *          The engines that can be stopped, Ford Fulkerson in every path
+ *          order and Dinic, call shouldStop() between augmentations. The
+ *          residual graph holds a feasible flow at those points, so stopping
+ *          there leaves the best flow found so far. Every progress interval,
+ *          and once more when the solve stops, shouldStop() also looks for a
+ *          cut: a BFS over the residual graph numbers the nodes by distance
+ *          from the source, and the nodes closer than some level k form an
+ *          s-t cut whose capacity is the current flow plus the residual
+ *          capacity from level k - 1 to level k. The smallest one found is
+ *          an upper bound on the maximum flow, and it is exactly the maximum
+ *          flow once the target can not be reached any more.
+ *
+ *          The other engines always run to completion. A solve is only
+ *          prevented from starting when it is cancelled or past its deadline
+ *          already.
+ *
+ *          A control is meant for one solve. cancel(), isCancelled(),
+ *          getStatus() and getProgress() can be called from any thread, the
+ *          other methods from the solving thread or before the solve starts.
+ */
+template<class Flow = long long>
+class solveControl{
+public:
+    /* Called from the solving thread with the flow and the best upper bound so far */
+    typedef void (*progressCallback)(void* context, Flow flow, Flow upper_bound);
+
+    solveControl() :
+        cancelled_(false),
+        status_(SOLVE_STATUS_RUNNING),
+        has_deadline_(false),
+        callback_(NULL),
+        callback_context_(NULL),
+        interval_(SOLVE_PROGRESS_INTERVAL),
+        flow_(0),
+        upper_bound_(0),
+        has_cut_(false)
+    {
+        next_progress_ = std::chrono::steady_clock::now();
+    }
+
+    /* Ask the solve to stop at its next check, from any thread. */
+    void cancel(){cancelled_.store(true, std::memory_order_relaxed);}
+    bool isCancelled(){return cancelled_.load(std::memory_order_relaxed);}
+
+    /* Stop the solve once the steady clock reaches deadline. */
+    void setDeadline(std::chrono::steady_clock::time_point deadline){
+        deadline_ = deadline;
+        has_deadline_ = true;
+    }
+    /* Stop the solve seconds from now. */
+    void setTimeLimit(double seconds){
+        setDeadline(std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds)));
+    }
+
+    /*
+     * @brief   Have the progress reported to a function as well.
+     *
+     * @param[in] callback  Called from the solving thread, it should return quickly
+     * @param[in] context   Passed to callback unchanged
+     * @param[in] interval  Seconds between two reports, also how often a cut is looked
+     *                      for. The default value is SOLVE_PROGRESS_INTERVAL.
+     */
+    void setProgressCallback(progressCallback callback, void* context, double interval = SOLVE_PROGRESS_INTERVAL){
+        callback_ = callback;
+        callback_context_ = context;
+        interval_ = interval;
+    }
+
+    /* One of the SOLVE_STATUS_* values */
+    int getStatus(){return status_.load(std::memory_order_acquire);}
+
+    /*
+     * @brief   Latest progress of the solve, from any thread.
+     *
+     * @param[out] flow         Flow sent so far
+     * @param[out] upper_bound  Capacity of the smallest cut found so far, the maximum
+     *                          flow can not be more. 0 before the first report.
+     */
+    void getProgress(Flow& flow, Flow& upper_bound){
+        std::lock_guard<std::mutex> lock(mutex_);
+        flow = flow_;
+        upper_bound = upper_bound_;
+    }
+
+    /*
+     * @brief   s side of the smallest cut the checks found, for a solve that
+     *          was stopped. Use computeMinCut() after an optimal one.
+     *
+     * @return  False if no cut was looked for
+     */
+    bool getBestCut(minCutBitmap& cut){
+        if(!has_cut_){
+            return false;
+        }
+        cut = cut_;
+        return true;
+    }
+
+    /*
+     * @brief   Check of the engines, between augmentations, while graph holds
+     *          a feasible flow of value flow. Looks for a cut and reports
+     *          progress when the interval is over or the solve has to stop.
+     *
+     * @return  True if the engine must stop, getStatus() then says why
+     */
+    template<class Graph>
+    bool shouldStop(Graph& graph, Flow flow){
+        int reason = SOLVE_STATUS_RUNNING;
+        if(isCancelled()){
+            reason = SOLVE_STATUS_CANCELLED;
+        }
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if(reason == SOLVE_STATUS_RUNNING && has_deadline_ && now >= deadline_){
+            reason = SOLVE_STATUS_DEADLINE;
+        }
+        if(reason != SOLVE_STATUS_RUNNING || now >= next_progress_){
+            findCut(graph, flow);
+            next_progress_ = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(interval_));
+        }
+        if(reason != SOLVE_STATUS_RUNNING){
+            status_.store(reason, std::memory_order_release);
+            return true;
+        }
+        return false;
+    }
+
+    /* Record that the engine finished with a maximum flow of value flow. */
+    void setOptimal(Flow flow){
+        report(flow, flow);
+        status_.store(SOLVE_STATUS_OPTIMAL, std::memory_order_release);
+    }
+private:
+    solveControl(const solveControl&);
+    solveControl& operator=(const solveControl&);
+
+    void report(Flow flow, Flow upper_bound){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flow_ = flow;
+            upper_bound_ = upper_bound;
+        }
+        if(callback_ != NULL){
+            callback_(callback_context_, flow, upper_bound);
+        }
+    }
+
+    /* Cut with the least residual capacity between two BFS levels, kept if it beats the best one */
+    template<class Graph>
+    void findCut(Graph& graph, Flow flow){
+        const int node_count = graph.getNodeCount();
+        const int source = graph.getSource();
+        const int sink = graph.getSink();
+        levels_.assign(node_count, INVALID_PARENT);
+        queue_.resize(node_count);
+        int q_tail = 0;
+        levels_[source] = 0;
+        queue_[q_tail++] = source;
+        for(int q_head = 0; q_head != q_tail; q_head++){
+            const int node_id = queue_[q_head];
+            forEachResidualArc(graph, node_id, [&](int edge_id){
+                const int next_node = graph.getHead(edge_id);
+                if(levels_[next_node] == INVALID_PARENT){
+                    levels_[next_node] = levels_[node_id] + 1;
+                    queue_[q_tail++] = next_node;
+                }
+            });
+        }
+
+        /* Without a path to the target the reached nodes are a cut of no residual capacity */
+        int cut_level = node_count;
+        Flow residual = 0;
+        if(levels_[sink] > 0){
+            const int sink_level = levels_[sink];
+            level_residuals_.assign(sink_level + 1, 0);
+            for(int i = 0; i < q_tail && levels_[queue_[i]] < sink_level; i++){
+                const int node_id = queue_[i];
+                forEachResidualArc(graph, node_id, [&](int edge_id){
+                    if(levels_[graph.getHead(edge_id)] == levels_[node_id] + 1){
+                        level_residuals_[levels_[node_id] + 1] += graph.getResidualCapacity(edge_id);
+                    }
+                });
+            }
+            cut_level = 1;
+            for(int level = 2; level <= sink_level; level++){
+                if(level_residuals_[level] < level_residuals_[cut_level]){
+                    cut_level = level;
+                }
+            }
+            residual = level_residuals_[cut_level];
+        }
+
+        Flow upper_bound = upper_bound_;
+        if(!has_cut_ || flow + residual < upper_bound){
+            upper_bound = flow + residual;
+            cut_.reset(node_count);
+            for(int i = 0; i < q_tail && levels_[queue_[i]] < cut_level; i++){
+                cut_.setSourceSide(queue_[i]);
+            }
+            has_cut_ = true;
+        }
+        report(flow, upper_bound);
+    }
+
+    std::atomic<bool> cancelled_;
+    std::atomic<int> status_;
+    bool has_deadline_;
+    std::chrono::steady_clock::time_point deadline_;
+    std::chrono::steady_clock::time_point next_progress_; /* When shouldStop() looks for a cut again */
+    progressCallback callback_;
+    void* callback_context_;
+    double interval_; /* Seconds between two progress reports */
+
+    std::mutex mutex_; /* Guards flow_ and upper_bound_ */
+    Flow flow_;
+    Flow upper_bound_;
+
+    bool has_cut_;
+    minCutBitmap cut_; /* s side of the cut of capacity upper_bound_ */
+    std::vector<int> levels_; /* BFS level of each node, INVALID_PARENT if not reached */
+    std::vector<int> queue_; /* BFS queue, the reached nodes in level order afterwards */
+    std::vector<Flow> level_residuals_; /* Residual capacity from level k - 1 to level k at k */
+};
+
+#endif
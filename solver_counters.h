@@ -0,0 +1,283 @@
+#ifndef SOLVER_COUNTERS_H
+#define SOLVER_COUNTERS_H
+
+#include<chrono>
+#include<cmath>
+#include<ostream>
+#include<string>
+#include<vector>
+
+/*
+ * Instrumentation of the engines. Build with MAX_FLOW_INSTRUMENTATION defined
+ * (for the whole program, the engines are templates) to compile the counters
+ * and phase timers in; without it every SOLVER_COUNT and SOLVER_PHASE_TIMER
+ * expands to nothing and solves cost exactly what they did before.
+ *
+ * The engines count into the solverCounters of the innermost
+ * solverCountersScope of the calling thread, nothing is counted outside of a
+ * scope. Worker threads of the parallel engines count into their own copies,
+ * which are added to the scope of the calling thread once they are joined.
+ */
+
+#define SOLVER_BOTTLENECK_BUCKETS 32 /* Bucket b counts bottlenecks in [2^b, 2^(b+1)) */
+
+/* Phases timed by SOLVER_PHASE_TIMER, a phase can run inside another one */
+#define SOLVER_PHASE_SEARCH 0 /* Augmenting path searches and level graphs */
+#define SOLVER_PHASE_AUGMENT 1 /* Sending flow along paths and blocking flows */
+#define SOLVER_PHASE_PREFLOW 2 /* Phase one of push-relabel, global relabels included */
+#define SOLVER_PHASE_GLOBAL_RELABEL 3
+#define SOLVER_PHASE_FLOW_CONVERSION 4 /* Phase two of push-relabel */
+#define SOLVER_PHASE_ORPHANS 5 /* Orphan adoption of Boykov-Kolmogorov */
+#define SOLVER_PHASE_COUNT 6
+
+static const char* const solverPhaseNames[SOLVER_PHASE_COUNT] = {
+    "search", "augment", "preflow", "global_relabel", "flow_conversion", "orphans"
+};
+
+/* What the engines did, summed over every solve run in a solverCountersScope */
+struct solverCounters{
+    long long bfs_calls; /* Graph searches, serial or parallel */
+    long long nodes_dequeued; /* Nodes expanded by the searches */
+    long long arcs_scanned; /* Edges looked at by the searches */
+    long long augmentations; /* Augmenting paths sent */
+    long long path_edges; /* Edges of all augmenting paths */
+    long long bottleneck_histogram[SOLVER_BOTTLENECK_BUCKETS]; /* Augmentations by bottleneck */
+    long long pushes; /* Push-relabel pushes */
+    long long relabels; /* Push-relabel relabels */
+    long long gaps; /* Gap heuristic hits */
+    long long global_relabels;
+    long long orphans; /* Boykov-Kolmogorov orphans */
+    double phase_seconds[SOLVER_PHASE_COUNT]; /* Wall time by SOLVER_PHASE_* */
+
+    solverCounters(){reset();}
+
+    void reset(){
+        bfs_calls = nodes_dequeued = arcs_scanned = 0;
+        augmentations = path_edges = 0;
+        pushes = relabels = gaps = global_relabels = orphans = 0;
+        for(int i = 0; i < SOLVER_BOTTLENECK_BUCKETS; i++){
+            bottleneck_histogram[i] = 0;
+        }
+        for(int i = 0; i < SOLVER_PHASE_COUNT; i++){
+            phase_seconds[i] = 0;
+        }
+    }
+
+    /* Add the counts of another set of counters, e.g. of a worker thread */
+    void add(const solverCounters& other){
+        bfs_calls += other.bfs_calls;
+        nodes_dequeued += other.nodes_dequeued;
+        arcs_scanned += other.arcs_scanned;
+        augmentations += other.augmentations;
+        path_edges += other.path_edges;
+        pushes += other.pushes;
+        relabels += other.relabels;
+        gaps += other.gaps;
+        global_relabels += other.global_relabels;
+        orphans += other.orphans;
+        for(int i = 0; i < SOLVER_BOTTLENECK_BUCKETS; i++){
+            bottleneck_histogram[i] += other.bottleneck_histogram[i];
+        }
+        for(int i = 0; i < SOLVER_PHASE_COUNT; i++){
+            phase_seconds[i] += other.phase_seconds[i];
+        }
+    }
+
+    double getAveragePathLength() const{
+        return augmentations > 0 ? (double)path_edges / augmentations : 0;
+    }
+
+    /* Count one augmenting path of path_length edges */
+    template<class Capacity>
+    void addAugmentation(int path_length, Capacity bottleneck){
+        augmentations++;
+        path_edges += path_length;
+        int bucket = (double)bottleneck >= 1 ? std::ilogb((double)bottleneck) : 0;
+        bottleneck_histogram[bucket < SOLVER_BOTTLENECK_BUCKETS ? bucket : SOLVER_BOTTLENECK_BUCKETS - 1]++;
+    }
+};
+
+/* Counters the current thread counts into, NULL outside of any solverCountersScope */
+inline solverCounters*& activeSolverCounters(){
+    static thread_local solverCounters* counters = NULL;
+    return counters;
+}
+
+/*
+ * @brief   Receives the counters of a solverCountersScope when it ends, to
+ *          ship them to a monitoring system. forEachSolverCounter() lists
+ *          them as flat name and value pairs.
+ */
+class solverCountersExporter{
+public:
+    virtual ~solverCountersExporter(){}
+    virtual void exportCounters(const solverCounters& counters) = 0;
+};
+
+/*
+ * @brief   Make the engines run by this thread count into counters until the
+ *          scope ends. Scopes nest, the previous counters are restored at the
+ *          end, and the exporter if any is then called with the counters.
+ */
+class solverCountersScope{
+public:
+    solverCountersScope(solverCounters* counters, solverCountersExporter* exporter = NULL) :
+        counters_(counters),
+        previous_(activeSolverCounters()),
+        exporter_(exporter)
+    {
+        activeSolverCounters() = counters;
+    }
+    ~solverCountersScope(){
+        activeSolverCounters() = previous_;
+        if(exporter_ != NULL && counters_ != NULL){
+            exporter_->exportCounters(*counters_);
+        }
+    }
+private:
+    solverCountersScope(const solverCountersScope&);
+    solverCountersScope& operator=(const solverCountersScope&);
+
+    solverCounters* counters_;
+    solverCounters* previous_;
+    solverCountersExporter* exporter_;
+};
+
+/*
+ * @brief   Counters for the worker threads of a parallel engine. Thread 0 is
+ *          the calling thread and counts into its own scope, every other
+ *          thread gets a copy that is added to it when the fork ends, after
+ *          the workers are joined. Without a scope on the calling thread, or
+ *          without MAX_FLOW_INSTRUMENTATION, nothing is counted.
+ */
+class solverCountersFork{
+public:
+    solverCountersFork(int thread_count) :
+        parent_(activeSolverCounters()),
+        threads_(parent_ != NULL && thread_count > 1 ? thread_count - 1 : 0)
+    {
+    }
+    ~solverCountersFork(){
+        for(size_t i = 0; i < threads_.size(); i++){
+            parent_->add(threads_[i]);
+        }
+    }
+
+    /* Counters for a solverCountersScope on the worker with this id */
+    solverCounters* getThreadCounters(int thread_id){
+        if(parent_ == NULL || thread_id == 0){
+            return parent_;
+        }
+        return &threads_[thread_id - 1];
+    }
+private:
+    solverCountersFork(const solverCountersFork&);
+    solverCountersFork& operator=(const solverCountersFork&);
+
+    solverCounters* parent_;
+    std::vector<solverCounters> threads_;
+};
+
+/* Adds the time until the end of the enclosing block to a phase of the active counters */
+class solverPhaseTimer{
+public:
+    solverPhaseTimer(int phase) :
+        counters_(activeSolverCounters()),
+        phase_(phase)
+    {
+        if(counters_ != NULL){
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+    ~solverPhaseTimer(){
+        if(counters_ != NULL){
+            counters_->phase_seconds[phase_] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+        }
+    }
+private:
+    solverPhaseTimer(const solverPhaseTimer&);
+    solverPhaseTimer& operator=(const solverPhaseTimer&);
+
+    solverCounters* counters_;
+    int phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#ifdef MAX_FLOW_INSTRUMENTATION
+#define SOLVER_COUNTERS_ENABLED 1
+/* Add amount to a member of the active counters */
+#define SOLVER_COUNT(counter, amount) \
+    do{ \
+        solverCounters* solver_counters_ = activeSolverCounters(); \
+        if(solver_counters_ != NULL){ \
+            solver_counters_->counter += (amount); \
+        } \
+    }while(0)
+/* Count one augmenting path */
+#define SOLVER_COUNT_AUGMENTATION(path_length, bottleneck) \
+    do{ \
+        solverCounters* solver_counters_ = activeSolverCounters(); \
+        if(solver_counters_ != NULL){ \
+            solver_counters_->addAugmentation((path_length), (bottleneck)); \
+        } \
+    }while(0)
+#define SOLVER_PHASE_TIMER_NAME(line) solver_phase_timer_##line
+#define SOLVER_PHASE_TIMER_LINE(phase, line) solverPhaseTimer SOLVER_PHASE_TIMER_NAME(line)(phase)
+/* Time the rest of the enclosing block as a SOLVER_PHASE_* phase */
+#define SOLVER_PHASE_TIMER(phase) SOLVER_PHASE_TIMER_LINE(phase, __LINE__)
+#else
+#define SOLVER_COUNTERS_ENABLED 0
+/* The arguments are not evaluated, sizeof only keeps the variables counted from looking unused */
+#define SOLVER_COUNT(counter, amount) do{(void)sizeof(amount);}while(0)
+#define SOLVER_COUNT_AUGMENTATION(path_length, bottleneck) do{(void)sizeof(path_length); (void)sizeof(bottleneck);}while(0)
+#define SOLVER_PHASE_TIMER(phase) do{}while(0)
+#endif
+
+/*
+ * @brief   Call visit(name, value) for every counter, with the histogram as
+ *          bottleneck_<b> for the non empty buckets and the phases as
+ *          <phase>_seconds, the flat form most monitoring systems take.
+ */
+template<class Visit>
+void forEachSolverCounter(const solverCounters& counters, Visit visit){
+    visit("bfs_calls", (double)counters.bfs_calls);
+    visit("nodes_dequeued", (double)counters.nodes_dequeued);
+    visit("arcs_scanned", (double)counters.arcs_scanned);
+    visit("augmentations", (double)counters.augmentations);
+    visit("path_edges", (double)counters.path_edges);
+    visit("average_path_length", counters.getAveragePathLength());
+    visit("pushes", (double)counters.pushes);
+    visit("relabels", (double)counters.relabels);
+    visit("gaps", (double)counters.gaps);
+    visit("global_relabels", (double)counters.global_relabels);
+    visit("orphans", (double)counters.orphans);
+    for(int i = 0; i < SOLVER_BOTTLENECK_BUCKETS; i++){
+        if(counters.bottleneck_histogram[i] != 0){
+            std::string name = "bottleneck_" + std::to_string(i);
+            visit(name.c_str(), (double)counters.bottleneck_histogram[i]);
+        }
+    }
+    for(int i = 0; i < SOLVER_PHASE_COUNT; i++){
+        std::string name = std::string(solverPhaseNames[i]) + "_seconds";
+        visit(name.c_str(), counters.phase_seconds[i]);
+    }
+}
+
+/* Write the counters as one JSON object, see forEachSolverCounter() */
+inline void writeSolverCountersJson(std::ostream& out, const solverCounters& counters){
+    bool first = true;
+    out<<"{";
+    forEachSolverCounter(counters, [&](const char* name, double value){
+        out<<(first ? "" : ", ")<<"\""<<name<<"\": ";
+        /* Counts are printed in full, the default precision would round them */
+        if(value == (double)(long long)value){
+            out<<(long long)value;
+        } else {
+            out<<value;
+        }
+        first = false;
+    });
+    out<<"}";
+}
+
+#endif
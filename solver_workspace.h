@@ -0,0 +1,152 @@
+#ifndef SOLVER_WORKSPACE_H
+#define SOLVER_WORKSPACE_H
+
+#include "residual_graph.h"
+#include "scratch_arena.h"
+
+/*
+ * @brief    Buffers of a graph search that outlive the search, so that
+ *          repeated searches and repeated solves allocate nothing.
+ *
+ *          Visited flags are epoch stamps: a node is visited if its stamp
+ *          equals the epoch of the current search, so starting a search is
+ *          one increment instead of clearing V flags. The stamps are only
+ *          cleared when the epoch counter wraps around. The queue is a node
+ *          sized ring buffer and the parent arrays keep the node and the
+ *          edge each visited node was reached from. A node sized path
+ *          buffer holds the edges of a path taken out of the parents. A
+ *          search from both ends uses a second queue, filled from the other
+ *          end of the same ring, and flags which end reached each node.
+ *
+ *          With a compile time node count every buffer is a plain array.
+ *          Otherwise the buffers grow to the largest graph searched and are
+ *          then reused, so one workspace can be kept for graphs of any size.
+ *          The workspace also carries a scratch arena for the engines that
+ *          need other per node buffers.
+ */
+template<int N = DYNAMIC_NODE_COUNT>
+class solverWorkspace{
+public:
+    /* @param[in] node_count  Nodes to make room for up front, it grows on demand. */
+    solverWorkspace(int node_count = N) :
+        node_count_(0),
+        epoch_(0),
+        visited_(0),
+        queue_(0),
+        parent_node_(0),
+        parent_edge_(0),
+        path_edges_(0),
+        from_target_(0)
+    {
+        reserve(node_count);
+    }
+
+    /* Make room for graphs with up to node_count nodes. */
+    void reserve(int node_count){
+        if(node_count <= node_count_){
+            return;
+        }
+        visited_.resize(node_count);
+        queue_.resize(node_count);
+        parent_node_.resize(node_count);
+        parent_edge_.resize(node_count);
+        path_edges_.resize(node_count);
+        from_target_.resize(node_count);
+        for(int i = 0; i < node_count; i++){
+            visited_[i] = 0;
+        }
+        node_count_ = node_count;
+        epoch_ = 0;
+    }
+
+    /*
+     * @brief   Start a new search on a graph with node_count nodes: nothing is
+     *          visited any more and the queue is empty. Parents are left as
+     *          they are, they are only meaningful for visited nodes.
+     */
+    void beginSearch(int node_count){
+        reserve(node_count);
+        epoch_++;
+        if(epoch_ == 0){
+            for(int i = 0; i < node_count_; i++){
+                visited_[i] = 0;
+            }
+            epoch_ = 1;
+        }
+        queue_head_ = 0;
+        queue_size_ = 0;
+        reverse_queue_head_ = 0;
+        reverse_queue_size_ = 0;
+    }
+
+    bool isVisited(int node_id){return visited_[node_id] == epoch_;}
+    void setVisited(int node_id){visited_[node_id] = epoch_;}
+
+    /* Ring buffer queue, it holds at most as many nodes as there are. */
+    bool isQueueEmpty(){return queue_size_ == 0;}
+    void push(int node_id){
+        int slot = queue_head_ + queue_size_;
+        queue_[slot < node_count_ ? slot : slot - node_count_] = node_id;
+        queue_size_++;
+    }
+    int pop(){
+        int node_id = queue_[queue_head_];
+        queue_head_ = queue_head_ + 1 < node_count_ ? queue_head_ + 1 : 0;
+        queue_size_--;
+        return node_id;
+    }
+    int getQueueSize(){return queue_size_;}
+
+    /*
+     * Second queue of a search from both ends. It fills the ring from the
+     * back, which never meets the first queue as long as every node is queued
+     * at most once per search.
+     */
+    bool isReverseQueueEmpty(){return reverse_queue_size_ == 0;}
+    void pushReverse(int node_id){
+        queue_[node_count_ - 1 - reverse_queue_head_ - reverse_queue_size_] = node_id;
+        reverse_queue_size_++;
+    }
+    int popReverse(){
+        int node_id = queue_[node_count_ - 1 - reverse_queue_head_];
+        reverse_queue_head_++;
+        reverse_queue_size_--;
+        return node_id;
+    }
+    int getReverseQueueSize(){return reverse_queue_size_;}
+
+    /* Which end of a search from both ends reached a visited node */
+    void setReachedFromTarget(int node_id, bool from_target){from_target_[node_id] = from_target;}
+    bool isReachedFromTarget(int node_id){return from_target_[node_id] != 0;}
+
+    void setParent(int node_id, int parent_node, int parent_edge){
+        parent_node_[node_id] = parent_node;
+        parent_edge_[node_id] = parent_edge;
+    }
+    int getParentNode(int node_id){return parent_node_[node_id];}
+    int getParentEdge(int node_id){return parent_edge_[node_id];}
+
+    /* Room for the edges of a simple path, which has less edges than there are nodes. */
+    int* getPathEdges(){return &path_edges_[0];}
+
+    scratchArena& getArena(){return arena_;}
+private:
+    solverWorkspace(const solverWorkspace&);
+    solverWorkspace& operator=(const solverWorkspace&);
+
+    int node_count_; /* Nodes the buffers have room for */
+    unsigned epoch_; /* Stamp of the current search */
+    int queue_head_;
+    int queue_size_;
+    int reverse_queue_head_; /* Nodes popped from the second queue */
+    int reverse_queue_size_;
+    nodeArray<unsigned, N> visited_; /* Epoch of the last search that visited the node */
+    nodeArray<int, N> queue_;
+    nodeArray<int, N> parent_node_; /* Node each visited node was reached from */
+    nodeArray<int, N> parent_edge_; /* Edge from the parent to each visited node */
+    nodeArray<int, N> path_edges_; /* Edges of the current path */
+    nodeArray<char, N> from_target_; /* 1 if the target end reached the node */
+    scratchArena arena_;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef SPIN_BARRIER_H
+#define SPIN_BARRIER_H
+
+#include<atomic>
+#include<thread>
+
+/*
+ * @brief    Reusable barrier for a fixed number of threads. Waiting threads
+ *          spin on a generation counter and yield, which is much cheaper
+ *          than a condition variable for the short phases of the parallel
+ *          engines. The last thread to arrive releases the others.
+ */
+class spinBarrier{
+public:
+    spinBarrier(int thread_count) : thread_count_(thread_count), waiting_(0), generation_(0){}
+
+    void wait(){
+        unsigned generation = generation_.load(std::memory_order_acquire);
+        if(waiting_.fetch_add(1, std::memory_order_acq_rel) + 1 == thread_count_){
+            waiting_.store(0, std::memory_order_relaxed);
+            generation_.fetch_add(1, std::memory_order_release);
+            return;
+        }
+        while(generation_.load(std::memory_order_acquire) == generation){
+            std::this_thread::yield();
+        }
+    }
+private:
+    int thread_count_; /* Threads that have to arrive before any is released */
+    std::atomic<int> waiting_; /* Threads that arrived in this generation */
+    std::atomic<unsigned> generation_; /* Bumped every time the barrier opens */
+};
+
+#endif